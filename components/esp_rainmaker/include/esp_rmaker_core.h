@@ -836,6 +836,21 @@ esp_err_t esp_rmaker_param_add_bounds(const esp_rmaker_param_t *param,
  */
 esp_err_t esp_rmaker_param_add_simple_time_series_ttl(const esp_rmaker_param_t *param, uint16_t ttl_days);
 
+/**
+ * Report a parameter without waiting for the coalescing window
+ *
+ * Reports of this parameter are published as soon as it is updated, even if
+ * CONFIG_ESP_RMAKER_PARAM_REPORT_COALESCE_MS or CONFIG_ESP_RMAKER_PARAM_NOTIFY_COALESCE_MS delays
+ * the others. Any changes still waiting for their window go out in the same publish.
+ * Meant for latency-critical parameters like an alarm or a power state.
+ *
+ * @param[in] param Parameter handle.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t esp_rmaker_param_add_report_immediate(const esp_rmaker_param_t *param);
+
 /**
  * Add a list of valid strings for a string parameter
  *
@@ -902,6 +917,10 @@ esp_err_t esp_rmaker_param_update(const esp_rmaker_param_t *param, esp_rmaker_pa
  * Calling this API will update the parameter and report it to ESP RainMaker cloud.
  * This should be used whenever there is any local change.
  *
+ * @note With CONFIG_ESP_RMAKER_PARAM_REPORT_COALESCE_MS set, the report goes out at the end of the
+ * coalescing window together with every other change made in it, unless the parameter was marked
+ * with esp_rmaker_param_add_report_immediate().
+ *
  * @param[in] param Parameter handle.
  * @param[in] val New value of the parameter.
  *
@@ -931,6 +950,50 @@ esp_err_t esp_rmaker_param_update_and_report(const esp_rmaker_param_t *param, es
  */
 esp_err_t esp_rmaker_param_update_and_notify(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val);
 
+/** Get the number of heap allocations made for remote parameter writes
+ *
+ * Set-params requests are decoded in a scratch arena that is allocated with the first request
+ * and reused after that. The count therefore stays flat in the steady state. It goes up only when
+ * the arena has to grow, or a request arrives while another one is being handled (e.g. a scene
+ * activated from a write callback), in which case that request uses the heap.
+ *
+ * @return Number of heap allocations since boot.
+ */
+uint32_t esp_rmaker_param_get_write_heap_allocs(void);
+
+/** Start a batch of parameter updates
+ *
+ * Until the matching esp_rmaker_param_batch_commit(), esp_rmaker_param_update_and_report() only updates
+ * the values and marks them as changed. The commit then reports all of them in a single params publish,
+ * which costs one MQTT message (and one unit of MQTT budget) instead of one per parameter.
+ * Batches can be nested; only the outermost commit reports.
+ *
+ * @note The batch is node wide, so updates made from other tasks while a batch is open are also deferred
+ * to the commit. Time series data and esp_rmaker_param_update_and_notify() are still reported immediately.
+ *
+ * Sample:
+ *
+ * esp_rmaker_param_batch_begin();
+ * esp_rmaker_param_update_and_report(water_power, esp_rmaker_bool(true));
+ * esp_rmaker_param_update_and_report(alarm_power, esp_rmaker_bool(true));
+ * esp_rmaker_param_batch_commit();
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t esp_rmaker_param_batch_begin(void);
+
+/** Commit a batch of parameter updates
+ *
+ * Ends the batch started with esp_rmaker_param_batch_begin() and, for the outermost batch,
+ * reports all parameters updated in the meantime in a single publish.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_STATE if no batch was in progress.
+ * @return error in case of failure.
+ */
+esp_err_t esp_rmaker_param_batch_commit(void);
+
 /** Trigger an alert on the phone app
  *
  * This API will trigger a notification alert on the phone apps (if enabled) using the formatted text
@@ -1113,6 +1176,51 @@ esp_err_t esp_rmaker_local_ctrl_disable(void);
  */
 esp_err_t esp_rmaker_param_report_simple_ts_data(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val, int timestamp, uint16_t ttl_days);
 
+/**
+ * Report simple time series data without reporting it as a parameter value
+ *
+ * Same as esp_rmaker_param_report_simple_ts_data(), except that the cached value is not marked
+ * as changed, so it is not sent again with the next report of other parameters. Local control
+ * queries still get it. Use this when the time series database is the only consumer, so that
+ * each value costs one message instead of two.
+ *
+ * @param[in] param Parameter handle, must have PROP_FLAG_SIMPLE_TIME_SERIES flag
+ * @param[in] val Value to report (can be any supported data type)
+ * @param[in] timestamp Epoch timestamp in seconds (0 to use current time)
+ * @param[in] ttl_days Time-to-live in days (0 to omit TTL field)
+ *
+ * @return ESP_OK on success
+ * @return error in case of failure
+ */
+esp_err_t esp_rmaker_param_report_simple_ts_data_only(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val, int timestamp, uint16_t ttl_days);
+
+/** One recorded value for esp_rmaker_param_report_time_series_records() */
+typedef struct {
+    /** Parameter the value belongs to. It must have been added to a device. */
+    const esp_rmaker_param_t *param;
+    /** Value, of the same type as the parameter */
+    esp_rmaker_param_val_t val;
+    /** Epoch timestamp in seconds */
+    int timestamp;
+} esp_rmaker_ts_record_t;
+
+/**
+ * Report several recorded values to time series in one MQTT message
+ *
+ * This is meant for values recorded while the node was offline. They go to the time series
+ * database with their own timestamps and do not change the current parameter values.
+ * Consecutive records of the same parameter share one entry in the payload, so sort them
+ * by parameter to keep the message small.
+ *
+ * @param[in] records Records to report
+ * @param[in] count Number of records
+ *
+ * @return ESP_OK on success
+ * @return ESP_ERR_INVALID_STATE if MQTT is not connected yet
+ * @return error in case of failure, including an exhausted MQTT budget
+ */
+esp_err_t esp_rmaker_param_report_time_series_records(const esp_rmaker_ts_record_t *records, size_t count);
+
 /** Publish command response payload to the cloud
  *
  * @param[in] output Pointer to the data to publish
@@ -794,6 +794,9 @@ esp_err_t esp_rmaker_start(void)
     if (esp_rmaker_priv_data->enable_time_sync) {
         esp_rmaker_time_sync_init(NULL);
     }
+    /* The devices are in place by now; services added later are found by walking the lists.
+     * Without memory for the index all lookups do that, so this is not fatal. */
+    esp_rmaker_index_build(esp_rmaker_get_node(), 0);
     ESP_LOGI(TAG, "Starting RainMaker Work Queue task");
     if (esp_rmaker_work_queue_start() != ESP_OK) {
         ESP_LOGE(TAG, "Couldn't create RainMaker Work Queue task");
@@ -164,6 +164,9 @@ esp_err_t esp_rmaker_device_add_param(const esp_rmaker_device_t *device, const e
         _device->params = _new_param;
     }
     _device->param_count++;
+    esp_rmaker_index_add_param(_new_param);
+    /* An update made before the param was added is still due */
+    esp_rmaker_param_dirty_attach(_new_param);
     /* We check the stored value here, and not during param creation, because a parameter
      * in itself isn't unique. However, it is unique within a given device and hence can
      * be uniquely represented in storage only when added to a device.
@@ -352,9 +355,13 @@ esp_rmaker_param_t *esp_rmaker_device_get_param_by_type(const esp_rmaker_device_
         ESP_LOGE(TAG, "Device handle or param type cannot be NULL");
         return NULL;
     }
-    _esp_rmaker_param_t *param = ((_esp_rmaker_device_t *)device)->params;
+    _esp_rmaker_param_t *param;
+    if (esp_rmaker_index_find_param_by_type((const _esp_rmaker_device_t *)device, param_type, strlen(param_type), &param)) {
+        return (esp_rmaker_param_t *)param;
+    }
+    param = ((_esp_rmaker_device_t *)device)->params;
     while(param) {
-        if (strcmp(param->type, param_type) == 0) {
+        if (param->type && strcmp(param->type, param_type) == 0) {
             break;
         }
         param = param->next;
@@ -362,18 +369,27 @@ esp_rmaker_param_t *esp_rmaker_device_get_param_by_type(const esp_rmaker_device_
     return (esp_rmaker_param_t *)param;
 }
 
-esp_rmaker_param_t *esp_rmaker_device_get_param_by_name(const esp_rmaker_device_t *device, const char *param_name)
+_esp_rmaker_param_t *esp_rmaker_device_find_param(const _esp_rmaker_device_t *device, const char *name, size_t len)
 {
-    if (!device || !param_name) {
-        ESP_LOGE(TAG, "Device handle or param name cannot be NULL");
-        return NULL;
+    _esp_rmaker_param_t *param;
+    if (esp_rmaker_index_find_param(device, name, len, &param)) {
+        return param;
     }
-    _esp_rmaker_param_t *param = ((_esp_rmaker_device_t *)device)->params;
+    param = device->params;
     while(param) {
-        if (strcmp(param->name, param_name) == 0) {
+        if (strncmp(param->name, name, len) == 0 && param->name[len] == '\0') {
             break;
         }
         param = param->next;
     }
-    return (esp_rmaker_param_t *)param;
+    return param;
+}
+
+esp_rmaker_param_t *esp_rmaker_device_get_param_by_name(const esp_rmaker_device_t *device, const char *param_name)
+{
+    if (!device || !param_name) {
+        ESP_LOGE(TAG, "Device handle or param name cannot be NULL");
+        return NULL;
+    }
+    return (esp_rmaker_param_t *)esp_rmaker_device_find_param((const _esp_rmaker_device_t *)device, param_name, strlen(param_name));
 }
@@ -0,0 +1,287 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Hash index over the node model.
+ *
+ * One open addressing table (linear probing, power of two size) holds three kinds of
+ * entries: devices by name, params by (device, name) and the first param of each type per
+ * device. An entry is just the 32 bit hash and the object; the low two bits of the hash
+ * carry the kind, so an equal hash always means the same kind of object and the object
+ * itself is compared to confirm a match.
+ *
+ * The index is built once by esp_rmaker_start() and frozen after that, since the MQTT task
+ * may be probing it at any time and it has no lock. The table is filled before it is
+ * published and never freed or rebuilt while the node lives. Objects added later are only
+ * in the lists: the index is then marked partial and a miss falls back to walking them.
+ * Removing a device overwrites its entries in place with a marker that never matches, so
+ * a concurrent lookup sees either the old entry or the marker, the same as a reader of the
+ * list it is unlinked from. Without memory for the table every lookup walks the lists. */
+
+#include <inttypes.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_rmaker_utils.h>
+
+#include "esp_rmaker_internal.h"
+
+static const char *TAG = "esp_rmaker_index";
+
+#define INDEX_MIN_SIZE      16
+#define INDEX_KIND_MASK     0x3
+#define FNV_OFFSET          2166136261UL
+#define FNV_PRIME           16777619UL
+
+typedef enum {
+    INDEX_KIND_DEVICE = 0,
+    INDEX_KIND_PARAM_NAME,
+    INDEX_KIND_PARAM_TYPE,
+} esp_rmaker_index_kind_t;
+
+typedef struct {
+    uint32_t hash;
+    void *obj;              /* NULL for a free slot, INDEX_REMOVED for a removed object */
+} esp_rmaker_index_entry_t;
+
+struct esp_rmaker_index {
+    uint32_t mask;          /* Size - 1 */
+    uint32_t count;
+    bool partial;           /* Objects were added after the build; a miss is not final */
+    esp_rmaker_index_entry_t entries[];
+};
+
+static const char s_removed;
+#define INDEX_REMOVED       ((void *)&s_removed)
+
+static void *entry_obj(const esp_rmaker_index_entry_t *e)
+{
+    return __atomic_load_n(&e->obj, __ATOMIC_ACQUIRE);
+}
+
+static uint32_t index_hash(esp_rmaker_index_kind_t kind, const void *scope, const char *key, size_t len)
+{
+    uint32_t h = FNV_OFFSET;
+    uintptr_t s = (uintptr_t)scope;
+    for (size_t i = 0; i < sizeof(s); i++) {
+        h = (h ^ (uint8_t)(s >> (i * 8))) * FNV_PRIME;
+    }
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)key[i]) * FNV_PRIME;
+    }
+    return (h & ~INDEX_KIND_MASK) | kind;
+}
+
+static bool key_equal(const char *str, const char *key, size_t len)
+{
+    return str && strncmp(str, key, len) == 0 && str[len] == '\0';
+}
+
+/* obj is the entry's object as loaded once by the caller */
+static bool entry_matches(const esp_rmaker_index_entry_t *e, const void *obj, uint32_t hash, const void *scope,
+        const char *key, size_t len)
+{
+    if (e->hash != hash || obj == INDEX_REMOVED) {
+        return false;
+    }
+    switch (hash & INDEX_KIND_MASK) {
+        case INDEX_KIND_DEVICE:
+            return key_equal(((const _esp_rmaker_device_t *)obj)->name, key, len);
+        case INDEX_KIND_PARAM_NAME: {
+            const _esp_rmaker_param_t *param = obj;
+            return param->parent == scope && key_equal(param->name, key, len);
+        }
+        case INDEX_KIND_PARAM_TYPE: {
+            const _esp_rmaker_param_t *param = obj;
+            return param->parent == scope && key_equal(param->type, key, len);
+        }
+        default:
+            return false;
+    }
+}
+
+static void *index_find(const struct esp_rmaker_index *index, esp_rmaker_index_kind_t kind, const void *scope,
+        const char *key, size_t len)
+{
+    uint32_t hash = index_hash(kind, scope, key, len);
+    void *obj;
+    for (uint32_t i = hash & index->mask; (obj = entry_obj(&index->entries[i])); i = (i + 1) & index->mask) {
+        if (entry_matches(&index->entries[i], obj, hash, scope, key, len)) {
+            return obj;
+        }
+    }
+    return NULL;
+}
+
+/* Only for a table that is not published yet. Type entries keep the first param of the type. */
+static void index_insert(struct esp_rmaker_index *index, esp_rmaker_index_kind_t kind, const void *scope,
+        const char *key, void *obj)
+{
+    size_t len = strlen(key);
+    uint32_t hash = index_hash(kind, scope, key, len);
+    uint32_t i = hash & index->mask;
+    for (; index->entries[i].obj; i = (i + 1) & index->mask) {
+        if (entry_matches(&index->entries[i], index->entries[i].obj, hash, scope, key, len)) {
+            return;
+        }
+    }
+    index->entries[i].hash = hash;
+    index->entries[i].obj = obj;
+    index->count++;
+}
+
+static uint32_t param_entries(const _esp_rmaker_param_t *param)
+{
+    return param->type ? 2 : 1;
+}
+
+static uint32_t device_entries(const _esp_rmaker_device_t *device)
+{
+    uint32_t n = 1;
+    for (_esp_rmaker_param_t *param = device->params; param; param = param->next) {
+        n += param_entries(param);
+    }
+    return n;
+}
+
+static void index_insert_param(struct esp_rmaker_index *index, _esp_rmaker_param_t *param)
+{
+    index_insert(index, INDEX_KIND_PARAM_NAME, param->parent, param->name, param);
+    if (param->type) {
+        index_insert(index, INDEX_KIND_PARAM_TYPE, param->parent, param->type, param);
+    }
+}
+
+static void index_insert_device(struct esp_rmaker_index *index, _esp_rmaker_device_t *device)
+{
+    index_insert(index, INDEX_KIND_DEVICE, NULL, device->name, device);
+    for (_esp_rmaker_param_t *param = device->params; param; param = param->next) {
+        index_insert_param(index, param);
+    }
+}
+
+/* Marks the entry of obj removed, in place, if there is one */
+static void index_remove(struct esp_rmaker_index *index, esp_rmaker_index_kind_t kind, const void *scope,
+        const char *key, const void *obj)
+{
+    uint32_t hash = index_hash(kind, scope, key, strlen(key));
+    void *e_obj;
+    for (uint32_t i = hash & index->mask; (e_obj = entry_obj(&index->entries[i])); i = (i + 1) & index->mask) {
+        if (e_obj == obj && index->entries[i].hash == hash) {
+            __atomic_store_n(&index->entries[i].obj, INDEX_REMOVED, __ATOMIC_RELEASE);
+            return;
+        }
+    }
+}
+
+esp_err_t esp_rmaker_index_build(const esp_rmaker_node_t *node, uint32_t extra)
+{
+    _esp_rmaker_node_t *_node = (_esp_rmaker_node_t *)node;
+    if (!_node) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (_node->index) {
+        /* Frozen: lookups may be using it */
+        return ESP_OK;
+    }
+    uint32_t needed = extra;
+    for (_esp_rmaker_device_t *device = _node->devices; device; device = device->next) {
+        needed += device_entries(device);
+    }
+    uint32_t size = INDEX_MIN_SIZE;
+    while (needed * 4 > size * 3) {
+        size <<= 1;
+    }
+    struct esp_rmaker_index *index = MEM_CALLOC_EXTRAM(1, sizeof(*index) + size * sizeof(index->entries[0]));
+    if (!index) {
+        ESP_LOGW(TAG, "No memory for a %"PRIu32" entry index, lookups will walk the node", size);
+        return ESP_ERR_NO_MEM;
+    }
+    index->mask = size - 1;
+    for (_esp_rmaker_device_t *device = _node->devices; device; device = device->next) {
+        index_insert_device(index, device);
+    }
+    /* Published only once it is complete */
+    __atomic_store_n(&_node->index, index, __ATOMIC_RELEASE);
+    ESP_LOGD(TAG, "Indexed %"PRIu32" entries in %"PRIu32" slots", index->count, size);
+    return ESP_OK;
+}
+
+void esp_rmaker_index_free(const esp_rmaker_node_t *node)
+{
+    _esp_rmaker_node_t *_node = (_esp_rmaker_node_t *)node;
+    if (_node && _node->index) {
+        free(_node->index);
+        _node->index = NULL;
+    }
+}
+
+void esp_rmaker_index_add_device(const esp_rmaker_node_t *node, _esp_rmaker_device_t *device)
+{
+    _esp_rmaker_node_t *_node = (_esp_rmaker_node_t *)node;
+    if (_node->index) {
+        _node->index->partial = true;
+    }
+}
+
+void esp_rmaker_index_remove_device(const esp_rmaker_node_t *node, _esp_rmaker_device_t *device)
+{
+    _esp_rmaker_node_t *_node = (_esp_rmaker_node_t *)node;
+    struct esp_rmaker_index *index = _node->index;
+    if (!index) {
+        return;
+    }
+    index_remove(index, INDEX_KIND_DEVICE, NULL, device->name, device);
+    for (_esp_rmaker_param_t *param = device->params; param; param = param->next) {
+        index_remove(index, INDEX_KIND_PARAM_NAME, device, param->name, param);
+        if (param->type) {
+            index_remove(index, INDEX_KIND_PARAM_TYPE, device, param->type, param);
+        }
+    }
+}
+
+void esp_rmaker_index_add_param(_esp_rmaker_param_t *param)
+{
+    const _esp_rmaker_device_t *device = param->parent;
+    _esp_rmaker_node_t *_node = device ? (_esp_rmaker_node_t *)device->parent : NULL;
+    if (_node && _node->index) {
+        _node->index->partial = true;
+    }
+}
+
+bool esp_rmaker_index_find_device(const esp_rmaker_node_t *node, const char *name, size_t len,
+        _esp_rmaker_device_t **device)
+{
+    const struct esp_rmaker_index *index = __atomic_load_n(&((const _esp_rmaker_node_t *)node)->index,
+            __ATOMIC_ACQUIRE);
+    if (!index) {
+        return false;
+    }
+    *device = index_find(index, INDEX_KIND_DEVICE, NULL, name, len);
+    return *device || !index->partial;
+}
+
+static bool index_find_param(const _esp_rmaker_device_t *device, esp_rmaker_index_kind_t kind,
+        const char *key, size_t len, _esp_rmaker_param_t **param)
+{
+    const _esp_rmaker_node_t *_node = (const _esp_rmaker_node_t *)device->parent;
+    const struct esp_rmaker_index *index = _node ? __atomic_load_n(&_node->index, __ATOMIC_ACQUIRE) : NULL;
+    if (!index) {
+        return false;
+    }
+    *param = index_find(index, kind, device, key, len);
+    return *param || !index->partial;
+}
+
+bool esp_rmaker_index_find_param(const _esp_rmaker_device_t *device, const char *name, size_t len,
+        _esp_rmaker_param_t **param)
+{
+    return index_find_param(device, INDEX_KIND_PARAM_NAME, name, len, param);
+}
+
+bool esp_rmaker_index_find_param_by_type(const _esp_rmaker_device_t *device, const char *type, size_t len,
+        _esp_rmaker_param_t **param)
+{
+    return index_find_param(device, INDEX_KIND_PARAM_TYPE, type, len, param);
+}
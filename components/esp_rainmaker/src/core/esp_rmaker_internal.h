@@ -22,14 +22,15 @@
 
 #define RMAKER_PARAM_FLAG_VALUE_CHANGE   (1 << 0)
 #define RMAKER_PARAM_FLAG_VALUE_NOTIFY   (1 << 1)
+#define RMAKER_PARAM_FLAGS_PENDING       (RMAKER_PARAM_FLAG_VALUE_CHANGE | RMAKER_PARAM_FLAG_VALUE_NOTIFY)
 #define ESP_RMAKER_NVS_PART_NAME            "nvs"
 
-/* Internal margin for parameter buffer allocation */
-#define RMAKER_PARAMS_SIZE_MARGIN       50 /* To accommodate for changes in param values while creating JSON */
-
 /* Minimum valid JSON params object size - length of '{"D":{"P":1}}' */
 #define RMAKER_MIN_VALID_PARAMS_SIZE    13
 
+/* Bytes the JSON generator writes before flushing them to an esp_rmaker_json_buf_t */
+#define RMAKER_JSON_BUF_CHUNK_SIZE      128
+
 typedef enum {
     ESP_RMAKER_STATE_DEINIT = 0,
     ESP_RMAKER_STATE_INIT_DONE,
@@ -61,6 +62,9 @@ struct esp_rmaker_param {
     struct esp_rmaker_device *parent;
     struct esp_rmaker_param * next;
     uint16_t ttl_days;  /* TTL in days for simple time series data */
+    bool report_immediate;  /* Skips the report coalescing window */
+    bool dirty_listed;  /* On the dirty list of its device */
+    struct esp_rmaker_param *dirty_next;
 };
 typedef struct esp_rmaker_param _esp_rmaker_param_t;
 
@@ -89,6 +93,11 @@ struct esp_rmaker_device {
     _esp_rmaker_param_t *primary;
     const esp_rmaker_node_t *parent;
     struct esp_rmaker_device *next;
+    /* Params with pending report flags, and the link in the dirty list of the node. A param
+     * may stay on the list after its flags are cleared until the next report prunes it. */
+    _esp_rmaker_param_t *dirty_params;
+    bool dirty_listed;
+    struct esp_rmaker_device *dirty_next;
 };
 typedef struct esp_rmaker_device _esp_rmaker_device_t;
 
@@ -97,8 +106,29 @@ typedef struct {
     esp_rmaker_node_info_t *info;
     esp_rmaker_attr_t *attributes;
     _esp_rmaker_device_t *devices;
+    struct esp_rmaker_index *index;     /* Hash index of devices and params, see esp_rmaker_index.c */
+    _esp_rmaker_device_t *dirty_devices;    /* Devices with params to report */
 } _esp_rmaker_node_t;
 
+/* JSON output of any size in one generator pass, see esp_rmaker_json_buf.c. data is NUL
+ * terminated and len bytes long once generation has ended. */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t size;
+    bool no_mem;
+    char chunk[RMAKER_JSON_BUF_CHUNK_SIZE];
+} esp_rmaker_json_buf_t;
+
+/* Starts jstr writing to jbuf. data/size may hand in an existing heap buffer, which is
+ * grown with realloc if the document does not fit; jbuf->data then holds the new one. */
+void esp_rmaker_json_buf_start(esp_rmaker_json_buf_t *jbuf, json_gen_str_t *jstr, char *data, size_t size);
+/* Ends jstr. Returns ESP_ERR_NO_MEM if the output could not grow; it is truncated then but
+ * still owned by jbuf->data. */
+esp_err_t esp_rmaker_json_buf_end(esp_rmaker_json_buf_t *jbuf, json_gen_str_t *jstr);
+/* Hands the output to the caller, who frees it, trimmed to its exact size */
+char *esp_rmaker_json_buf_release(esp_rmaker_json_buf_t *jbuf);
+
 esp_rmaker_node_t *esp_rmaker_node_create(const char *name, const char *type);
 esp_err_t esp_rmaker_change_node_id(char *node_id, size_t len);
 esp_err_t esp_rmaker_report_value(const esp_rmaker_param_val_t *val, char *key, json_gen_str_t *jptr);
@@ -106,6 +136,26 @@ esp_err_t esp_rmaker_report_data_type(esp_rmaker_val_type_t type, char *data_typ
 esp_err_t esp_rmaker_report_node_config(void);
 esp_err_t esp_rmaker_report_node_state(void);
 _esp_rmaker_device_t *esp_rmaker_node_get_first_device(const esp_rmaker_node_t *node);
+/* Builds the index with room for extra more entries, once; it is frozen after that. On
+ * failure the node has no index. */
+esp_err_t esp_rmaker_index_build(const esp_rmaker_node_t *node, uint32_t extra);
+/* Only when the node goes away and nothing can look it up any more */
+void esp_rmaker_index_free(const esp_rmaker_node_t *node);
+/* Keep an existing index correct; call after the lists have been changed */
+void esp_rmaker_index_add_device(const esp_rmaker_node_t *node, _esp_rmaker_device_t *device);
+void esp_rmaker_index_remove_device(const esp_rmaker_node_t *node, _esp_rmaker_device_t *device);
+void esp_rmaker_index_add_param(_esp_rmaker_param_t *param);
+/* Lookups by a key that need not be NUL terminated. They return false when the index cannot
+ * answer, because there is none or the object may have been added after it was built, and
+ * the caller has to walk the lists instead. */
+bool esp_rmaker_index_find_device(const esp_rmaker_node_t *node, const char *name, size_t len,
+        _esp_rmaker_device_t **device);
+bool esp_rmaker_index_find_param(const _esp_rmaker_device_t *device, const char *name, size_t len,
+        _esp_rmaker_param_t **param);
+bool esp_rmaker_index_find_param_by_type(const _esp_rmaker_device_t *device, const char *type, size_t len,
+        _esp_rmaker_param_t **param);
+_esp_rmaker_device_t *esp_rmaker_node_find_device(const esp_rmaker_node_t *node, const char *name, size_t len);
+_esp_rmaker_param_t *esp_rmaker_device_find_param(const _esp_rmaker_device_t *device, const char *name, size_t len);
 esp_rmaker_attr_t *esp_rmaker_node_get_first_attribute(const esp_rmaker_node_t *node);
 esp_err_t esp_rmaker_params_mqtt_init(void);
 esp_err_t esp_rmaker_param_get_stored_value(_esp_rmaker_param_t *param, esp_rmaker_param_val_t *val);
@@ -116,7 +166,13 @@ esp_err_t esp_rmaker_attribute_delete(esp_rmaker_attr_t *attr);
 char *esp_rmaker_get_node_config(void);
 char *esp_rmaker_get_node_params(void);
 esp_err_t esp_rmaker_handle_set_params(char *data, size_t data_len, esp_rmaker_req_src_t src);
-esp_err_t esp_rmaker_populate_params(char *buf, size_t *buf_len, uint8_t flags, bool reset_flags);
+/* Generates the params JSON in one pass into jbuf, started on data/size as for
+ * esp_rmaker_json_buf_start(). flags selects the params to report, 0 for all. */
+esp_err_t esp_rmaker_populate_params(esp_rmaker_json_buf_t *jbuf, char *data, size_t size, uint8_t flags, bool reset_flags);
+/* Keep the dirty lists in step with the node; each call is a no-op if nothing is pending */
+void esp_rmaker_param_dirty_attach(_esp_rmaker_param_t *param);
+void esp_rmaker_device_dirty_attach(_esp_rmaker_device_t *device);
+void esp_rmaker_device_dirty_detach(const esp_rmaker_node_t *node, _esp_rmaker_device_t *device);
 esp_err_t esp_rmaker_param_cmd_resp_enable(void);
 esp_err_t esp_rmaker_user_mapping_prov_init(void);
 esp_err_t esp_rmaker_user_mapping_prov_deinit(void);
@@ -0,0 +1,81 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Growable output for the JSON generator.
+ *
+ * The generator writes into a small chunk inside esp_rmaker_json_buf_t and hands every full
+ * chunk to the flush callback, which appends it to the output and grows that as needed. So
+ * a document of any size is generated in a single pass, with no size probe beforehand and
+ * no retry with a larger buffer. */
+
+#include <string.h>
+#include <esp_log.h>
+#include <esp_rmaker_utils.h>
+
+#include "esp_rmaker_internal.h"
+
+static const char *TAG = "esp_rmaker_json_buf";
+
+static void esp_rmaker_json_buf_flush(char *chunk, void *priv)
+{
+    esp_rmaker_json_buf_t *jbuf = (esp_rmaker_json_buf_t *)priv;
+    size_t len = strlen(chunk);
+    if (jbuf->no_mem) {
+        return;
+    }
+    size_t needed = jbuf->len + len + 1;
+    if (needed > jbuf->size) {
+        size_t size = jbuf->size ? jbuf->size * 2 : RMAKER_JSON_BUF_CHUNK_SIZE;
+        while (size < needed) {
+            size *= 2;
+        }
+        char *data = MEM_REALLOC_EXTRAM(jbuf->data, size);
+        if (!data) {
+            ESP_LOGE(TAG, "Failed to grow JSON buffer to %lu bytes.", (unsigned long) size);
+            jbuf->no_mem = true;
+            return;
+        }
+        jbuf->data = data;
+        jbuf->size = size;
+    }
+    memcpy(jbuf->data + jbuf->len, chunk, len + 1);
+    jbuf->len += len;
+}
+
+void esp_rmaker_json_buf_start(esp_rmaker_json_buf_t *jbuf, json_gen_str_t *jstr, char *data, size_t size)
+{
+    jbuf->data = data;
+    jbuf->size = data ? size : 0;
+    jbuf->len = 0;
+    jbuf->no_mem = false;
+    if (jbuf->data) {
+        jbuf->data[0] = '\0';
+    }
+    json_gen_str_start(jstr, jbuf->chunk, sizeof(jbuf->chunk), esp_rmaker_json_buf_flush, jbuf);
+}
+
+esp_err_t esp_rmaker_json_buf_end(esp_rmaker_json_buf_t *jbuf, json_gen_str_t *jstr)
+{
+    /* Flushes whatever is left in the chunk */
+    json_gen_str_end(jstr);
+    return jbuf->no_mem ? ESP_ERR_NO_MEM : ESP_OK;
+}
+
+char *esp_rmaker_json_buf_release(esp_rmaker_json_buf_t *jbuf)
+{
+    char *data = jbuf->data;
+    if (data && jbuf->size > jbuf->len + 1) {
+        /* Shrinking cannot really fail, but the larger block is just as good if it does */
+        char *exact = MEM_REALLOC_EXTRAM(data, jbuf->len + 1);
+        if (exact) {
+            data = exact;
+        }
+    }
+    jbuf->data = NULL;
+    jbuf->size = 0;
+    jbuf->len = 0;
+    return data;
+}
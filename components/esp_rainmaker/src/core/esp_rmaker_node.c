@@ -82,6 +82,7 @@ esp_err_t esp_rmaker_node_delete(const esp_rmaker_node_t *node)
             esp_rmaker_device_delete((esp_rmaker_device_t *)device);
             device = next_device;
         }
+        esp_rmaker_index_free(node);
         /* Node ID is created in the context of esp_rmaker_init and just assigned
          * here. So, we would not free it here.
          */
@@ -313,6 +314,8 @@ esp_err_t esp_rmaker_node_add_device(const esp_rmaker_node_t *node, const esp_rm
         _node->devices = _new_device;
     }
     _new_device->parent = node;
+    esp_rmaker_index_add_device(node, _new_device);
+    esp_rmaker_device_dirty_attach(_new_device);
     return ESP_OK;
 }
 
@@ -344,23 +347,34 @@ esp_err_t esp_rmaker_node_remove_device(const esp_rmaker_node_t *node, const esp
         prev_device->next = tmp_device->next;
     }
     tmp_device->parent = NULL;
+    esp_rmaker_device_dirty_detach(node, tmp_device);
+    esp_rmaker_index_remove_device(node, tmp_device);
     return ESP_OK;
 }
 
-esp_rmaker_device_t *esp_rmaker_node_get_device_by_name(const esp_rmaker_node_t *node, const char *device_name)
+_esp_rmaker_device_t *esp_rmaker_node_find_device(const esp_rmaker_node_t *node, const char *name, size_t len)
 {
-    if (!node || !device_name) {
-        ESP_LOGE(TAG, "Node handle or device name cannot be NULL");
-        return NULL;
+    _esp_rmaker_device_t *device;
+    if (esp_rmaker_index_find_device(node, name, len, &device)) {
+        return device;
     }
-    _esp_rmaker_device_t *device = ((_esp_rmaker_node_t *)node)->devices;
+    device = ((_esp_rmaker_node_t *)node)->devices;
     while(device) {
-        if (strcmp(device->name, device_name) == 0) {
+        if (strncmp(device->name, name, len) == 0 && device->name[len] == '\0') {
             break;
         }
         device = device->next;
     }
-    return (esp_rmaker_device_t *)device;
+    return device;
+}
+
+esp_rmaker_device_t *esp_rmaker_node_get_device_by_name(const esp_rmaker_node_t *node, const char *device_name)
+{
+    if (!node || !device_name) {
+        ESP_LOGE(TAG, "Node handle or device name cannot be NULL");
+        return NULL;
+    }
+    return (esp_rmaker_device_t *)esp_rmaker_node_find_device(node, device_name, strlen(device_name));
 }
 
 _esp_rmaker_device_t *esp_rmaker_node_get_first_device(const esp_rmaker_node_t *node)
@@ -248,41 +248,25 @@ static esp_err_t esp_rmaker_report_devices_or_services(json_gen_str_t *jptr, cha
     return ESP_OK;
 }
 
-int __esp_rmaker_get_node_config(char *buf, size_t buf_size)
+char *esp_rmaker_get_node_config(void)
 {
+    /* Generated in a single pass, the buffer growing as the JSON is written */
+    esp_rmaker_json_buf_t jbuf;
     json_gen_str_t jstr;
-    json_gen_str_start(&jstr, buf, buf_size, NULL, NULL);
+    esp_rmaker_json_buf_start(&jbuf, &jstr, NULL, 0);
     json_gen_start_object(&jstr);
     esp_rmaker_report_info(&jstr);
     esp_rmaker_report_node_attributes(&jstr);
     esp_rmaker_report_devices_or_services(&jstr, "devices");
     esp_rmaker_report_devices_or_services(&jstr, "services");
-    if (json_gen_end_object(&jstr) < 0) {
-        return -1;
-    }
-    return json_gen_str_end(&jstr);
-}
-
-char *esp_rmaker_get_node_config(void)
-{
-    /* Setting buffer to NULL and size to 0 just to get the required buffer size */
-    int req_size = __esp_rmaker_get_node_config(NULL, 0);
-    if (req_size < 0) {
-        ESP_LOGE(TAG, "Failed to get required size for Node config JSON.");
-        return NULL;
-    }
-    char *node_config = MEM_CALLOC_EXTRAM(1, req_size);
-    if (!node_config) {
-        ESP_LOGE(TAG, "Failed to allocate %d bytes for node config", req_size);
-        return NULL;
-    }
-    if (__esp_rmaker_get_node_config(node_config, req_size) < 0) {
-        free(node_config);
+    json_gen_end_object(&jstr);
+    if (esp_rmaker_json_buf_end(&jbuf, &jstr) != ESP_OK) {
+        free(jbuf.data);
         ESP_LOGE(TAG, "Failed to generate Node config JSON.");
         return NULL;
     }
-    ESP_LOGI(TAG, "Generated Node config of length %d", req_size);
-    return node_config;
+    ESP_LOGI(TAG, "Generated Node config of length %lu", (unsigned long) jbuf.len);
+    return esp_rmaker_json_buf_release(&jbuf);
 }
 
 esp_err_t esp_rmaker_report_node_config()
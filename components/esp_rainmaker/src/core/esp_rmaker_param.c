@@ -18,6 +18,8 @@
 #include <esp_log.h>
 #include <esp_err.h>
 #include <nvs.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
 
 #include <json_parser.h>
 #include <json_generator.h>
@@ -26,6 +28,7 @@
 #include <esp_rmaker_standard_types.h>
 #include <esp_rmaker_mqtt.h>
 #include <esp_rmaker_utils.h>
+#include <esp_rmaker_work_queue.h>
 #include "esp_rmaker_mqtt_topics.h"
 #include "esp_rmaker_internal.h"
 
@@ -42,6 +45,40 @@ static size_t max_node_params_size = CONFIG_ESP_RMAKER_MAX_PARAM_DATA_SIZE;
 
 static char publish_topic[MQTT_TOPIC_BUFFER_SIZE];
 static bool esp_rmaker_params_mqtt_init_done;
+/* Nesting depth of esp_rmaker_param_batch_begin(). Reports are deferred while non-zero */
+static uint8_t s_param_batch_depth;
+static portMUX_TYPE s_param_batch_lock = portMUX_INITIALIZER_UNLOCKED;
+/* Guards the dirty lists. They are only linked and pruned under it; reports walk them
+ * without it, the same way they walk the node. */
+static portMUX_TYPE s_dirty_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Coalescing window of a report class. The timer runs while reports of the class wait for it. */
+typedef struct {
+    uint8_t flags;
+    uint32_t window_ms;
+    TimerHandle_t timer;
+} esp_rmaker_report_window_t;
+
+/* Scratch memory of set-params requests: the write requests of a device and the copies of
+ * their string values. It is bump allocated and dropped as a whole after each request, and
+ * sized for the largest device and a full payload, so steady-state writes never touch the
+ * heap. A request finding it busy (nested or concurrent) falls back to the heap.
+ */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t used;
+    bool busy;
+} esp_rmaker_set_params_arena_t;
+
+static esp_rmaker_set_params_arena_t s_set_params_arena;
+static uint32_t s_set_params_heap_allocs;
+static portMUX_TYPE s_set_params_arena_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_rmaker_report_window_t s_report_windows[] = {
+    { RMAKER_PARAM_FLAG_VALUE_CHANGE, CONFIG_ESP_RMAKER_PARAM_REPORT_COALESCE_MS, NULL },
+    { RMAKER_PARAM_FLAG_VALUE_NOTIFY, CONFIG_ESP_RMAKER_PARAM_NOTIFY_COALESCE_MS, NULL },
+};
 
 static const char *TAG = "esp_rmaker_param";
 
@@ -119,52 +156,149 @@ esp_rmaker_param_val_t esp_rmaker_array(const char *val)
     return param_val;
 }
 
-esp_err_t esp_rmaker_populate_params(char *buf, size_t *buf_len, uint8_t flags, bool reset_flags)
+/* Call with s_dirty_lock held */
+static void esp_rmaker_device_dirty_link(_esp_rmaker_device_t *device)
+{
+    _esp_rmaker_node_t *node = (_esp_rmaker_node_t *)device->parent;
+    if (node && device->dirty_params && !device->dirty_listed) {
+        device->dirty_next = node->dirty_devices;
+        node->dirty_devices = device;
+        device->dirty_listed = true;
+    }
+}
+
+/* Call with s_dirty_lock held */
+static void esp_rmaker_param_dirty_link(_esp_rmaker_param_t *param)
+{
+    _esp_rmaker_device_t *device = param->parent;
+    if (device && (param->flags & RMAKER_PARAM_FLAGS_PENDING) && !param->dirty_listed) {
+        param->dirty_next = device->dirty_params;
+        device->dirty_params = param;
+        param->dirty_listed = true;
+        esp_rmaker_device_dirty_link(device);
+    }
+}
+
+static void esp_rmaker_param_mark(_esp_rmaker_param_t *param, uint8_t flags)
+{
+    portENTER_CRITICAL(&s_dirty_lock);
+    param->flags |= flags;
+    esp_rmaker_param_dirty_link(param);
+    portEXIT_CRITICAL(&s_dirty_lock);
+}
+
+void esp_rmaker_param_dirty_attach(_esp_rmaker_param_t *param)
+{
+    portENTER_CRITICAL(&s_dirty_lock);
+    esp_rmaker_param_dirty_link(param);
+    portEXIT_CRITICAL(&s_dirty_lock);
+}
+
+void esp_rmaker_device_dirty_attach(_esp_rmaker_device_t *device)
+{
+    portENTER_CRITICAL(&s_dirty_lock);
+    esp_rmaker_device_dirty_link(device);
+    portEXIT_CRITICAL(&s_dirty_lock);
+}
+
+/* The device keeps its own list, so its changes are reported if it is added back */
+void esp_rmaker_device_dirty_detach(const esp_rmaker_node_t *node, _esp_rmaker_device_t *device)
+{
+    _esp_rmaker_node_t *_node = (_esp_rmaker_node_t *)node;
+    portENTER_CRITICAL(&s_dirty_lock);
+    if (device->dirty_listed) {
+        _esp_rmaker_device_t **link = &_node->dirty_devices;
+        while (*link && *link != device) {
+            link = &(*link)->dirty_next;
+        }
+        if (*link) {
+            *link = device->dirty_next;
+        }
+        device->dirty_listed = false;
+    }
+    portEXIT_CRITICAL(&s_dirty_lock);
+}
+
+/* Clears flags on everything on the dirty lists and unlinks what has nothing pending any
+ * more. A removed entry keeps its next pointer, so a report walking the list past it
+ * carries on. */
+static void esp_rmaker_dirty_reset(uint8_t flags)
+{
+    _esp_rmaker_node_t *node = (_esp_rmaker_node_t *)esp_rmaker_get_node();
+    portENTER_CRITICAL(&s_dirty_lock);
+    _esp_rmaker_device_t **dlink = &node->dirty_devices;
+    while (*dlink) {
+        _esp_rmaker_device_t *device = *dlink;
+        _esp_rmaker_param_t **plink = &device->dirty_params;
+        while (*plink) {
+            _esp_rmaker_param_t *param = *plink;
+            param->flags &= ~flags;
+            if (param->flags & RMAKER_PARAM_FLAGS_PENDING) {
+                plink = &param->dirty_next;
+            } else {
+                *plink = param->dirty_next;
+                param->dirty_listed = false;
+            }
+        }
+        if (device->dirty_params) {
+            dlink = &device->dirty_next;
+        } else {
+            *dlink = device->dirty_next;
+            device->dirty_listed = false;
+        }
+    }
+    portEXIT_CRITICAL(&s_dirty_lock);
+}
+
+/* With flags, only the dirty lists are visited, so the cost follows the number of changes
+ * rather than the size of the node. Without, every param is reported. */
+esp_err_t esp_rmaker_populate_params(esp_rmaker_json_buf_t *jbuf, char *data, size_t size, uint8_t flags, bool reset_flags)
 {
-    esp_err_t err = ESP_OK;
     json_gen_str_t jstr;
-    json_gen_str_start(&jstr, buf, *buf_len, NULL, NULL);
+    esp_rmaker_json_buf_start(jbuf, &jstr, data, size);
     json_gen_start_object(&jstr);
-    _esp_rmaker_device_t *device = esp_rmaker_node_get_first_device(esp_rmaker_get_node());
-    while (device) {
-        bool device_added = false;
-        _esp_rmaker_param_t *param = device->params;
-        while (param) {
-            if (!flags || (param->flags & flags)) {
-                if (!device_added) {
-                    json_gen_push_object(&jstr, device->name);
-                    device_added = true;
+    if (flags) {
+        _esp_rmaker_node_t *node = (_esp_rmaker_node_t *)esp_rmaker_get_node();
+        for (_esp_rmaker_device_t *device = node->dirty_devices; device; device = device->dirty_next) {
+            bool device_added = false;
+            for (_esp_rmaker_param_t *param = device->dirty_params; param; param = param->dirty_next) {
+                if (param->flags & flags) {
+                    if (!device_added) {
+                        json_gen_push_object(&jstr, device->name);
+                        device_added = true;
+                    }
+                    esp_rmaker_report_value(&param->val, param->name, &jstr);
                 }
-                esp_rmaker_report_value(&param->val, param->name, &jstr);
             }
-            param = param->next;
-        }
-        if (device_added) {
-            json_gen_pop_object(&jstr);
+            if (device_added) {
+                json_gen_pop_object(&jstr);
+            }
         }
-        device = device->next;
-    }
-    if (json_gen_end_object(&jstr) < 0) {
-        err = ESP_ERR_NO_MEM;
-    }
-    /* Resetting the flags after creating the JSON in order to handle cases wherein
-     * memory has been insufficient and this same function would have to be called
-     * again with a larger buffer.
-     */
-    if (err == ESP_OK) {
-        device = esp_rmaker_node_get_first_device(esp_rmaker_get_node());
+    } else {
+        _esp_rmaker_device_t *device = esp_rmaker_node_get_first_device(esp_rmaker_get_node());
         while (device) {
+            bool device_added = false;
             _esp_rmaker_param_t *param = device->params;
             while (param) {
-                if (reset_flags) {
-                    param->flags &= ~flags;
+                if (!device_added) {
+                    json_gen_push_object(&jstr, device->name);
+                    device_added = true;
                 }
+                esp_rmaker_report_value(&param->val, param->name, &jstr);
                 param = param->next;
             }
+            if (device_added) {
+                json_gen_pop_object(&jstr);
+            }
             device = device->next;
         }
     }
-    *buf_len = json_gen_str_end(&jstr);
+    json_gen_end_object(&jstr);
+    esp_err_t err = esp_rmaker_json_buf_end(jbuf, &jstr);
+    /* Flags are reset only once the JSON is complete, so nothing is lost if it is not */
+    if (err == ESP_OK && flags && reset_flags) {
+        esp_rmaker_dirty_reset(flags);
+    }
     return err;
 }
 
@@ -174,33 +308,20 @@ esp_err_t esp_rmaker_populate_params(char *buf, size_t *buf_len, uint8_t flags,
  */
 char *esp_rmaker_get_node_params(void)
 {
-    size_t req_size = 0;
-    /* Passing NULL pointer to find the required buffer size */
-    esp_err_t err = esp_rmaker_populate_params(NULL, &req_size, 0, false);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to get required size for Node params JSON.");
-        return NULL;
-    }
-    /* Keeping some margin just in case some param value changes in between */
-    req_size += RMAKER_PARAMS_SIZE_MARGIN;
-    char *node_params = MEM_CALLOC_EXTRAM(1, req_size);
-    if (!node_params) {
-        ESP_LOGE(TAG, "Failed to allocate %lu bytes for Node params.", (unsigned long) req_size);
-        return NULL;
-    }
-    err = esp_rmaker_populate_params(node_params, &req_size, 0, false);
-    if (err != ESP_OK) {
+    esp_rmaker_json_buf_t jbuf;
+    if (esp_rmaker_populate_params(&jbuf, NULL, 0, 0, false) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to generate Node params JSON.");
-        free(node_params);
+        free(jbuf.data);
         return NULL;
     }
-    return node_params;
+    return esp_rmaker_json_buf_release(&jbuf);
 }
 
+static char *s_node_params_buf;
+static size_t s_param_buf_size;
+
 static char * esp_rmaker_param_get_buf(size_t size)
 {
-    static char *s_node_params_buf;
-    static size_t s_param_buf_size;
     /* If received size is 0, we will just return the pointer to the buffer */
     if (size == 0) {
         return s_node_params_buf;
@@ -233,23 +354,20 @@ static esp_err_t esp_rmaker_allocate_and_populate_params(uint8_t flags, bool res
     if (!node_params_buf) {
         return ESP_ERR_NO_MEM;
     }
-    /* Typically, max_node_params_size should be sufficient for the parameters */
-    size_t req_size = max_node_params_size;
-    esp_err_t err = esp_rmaker_populate_params(node_params_buf, &req_size, flags, reset_flags);
-    /* If the max_node_params_size was insufficient, we will re-allocate new buffer */
-    if (err == ESP_ERR_NO_MEM) {
-        ESP_LOGW(TAG, "%lu bytes not sufficient for Node params. Reallocating %lu bytes.",
-                (unsigned long) max_node_params_size, (unsigned long) req_size + RMAKER_PARAMS_SIZE_MARGIN);
-        max_node_params_size = req_size + RMAKER_PARAMS_SIZE_MARGIN; /* Keeping some margin since paramater value size can change */
-        node_params_buf = esp_rmaker_param_get_buf(max_node_params_size);
-        if (!node_params_buf) {
-            return ESP_ERR_NO_MEM;
-        }
-        req_size = max_node_params_size;
-        err = esp_rmaker_populate_params(node_params_buf, &req_size, flags, reset_flags);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to populate node parameters.");
-        }
+    /* Typically, max_node_params_size is sufficient. If not, the buffer grows while the
+     * params are written and is kept at the new size.
+     */
+    esp_rmaker_json_buf_t jbuf;
+    esp_err_t err = esp_rmaker_populate_params(&jbuf, node_params_buf, max_node_params_size, flags, reset_flags);
+    if (jbuf.size != max_node_params_size) {
+        ESP_LOGW(TAG, "%lu bytes not sufficient for Node params. Grown to %lu bytes.",
+                (unsigned long) max_node_params_size, (unsigned long) jbuf.size);
+        max_node_params_size = jbuf.size;
+    }
+    s_node_params_buf = jbuf.data;
+    s_param_buf_size = jbuf.size;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to populate node parameters.");
     }
     return err;
 }
@@ -288,96 +406,327 @@ static esp_err_t esp_rmaker_report_updated_params(void)
     return esp_rmaker_report_param_internal(RMAKER_PARAM_FLAG_VALUE_CHANGE);
 }
 
+static void esp_rmaker_report_window_work_cb(void *priv_data)
+{
+    esp_rmaker_report_window_t *window = (esp_rmaker_report_window_t *)priv_data;
+    if (esp_rmaker_get_state() == ESP_RMAKER_STATE_STARTED) {
+        esp_rmaker_report_param_internal(window->flags);
+    }
+}
+
+static void esp_rmaker_report_window_timer_cb(TimerHandle_t xTimer)
+{
+    /* Reports publish over MQTT, which is not for the timer task */
+    esp_rmaker_report_window_t *window = (esp_rmaker_report_window_t *)pvTimerGetTimerID(xTimer);
+    if (esp_rmaker_work_queue_add_task(esp_rmaker_report_window_work_cb, window) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to queue coalesced params report, reporting with the next change.");
+    }
+}
+
+static void esp_rmaker_report_windows_init(void)
+{
+    for (size_t i = 0; i < sizeof(s_report_windows) / sizeof(s_report_windows[0]); i++) {
+        esp_rmaker_report_window_t *window = &s_report_windows[i];
+        if (window->window_ms == 0 || window->timer) {
+            continue;
+        }
+        window->timer = xTimerCreate("rmaker_report", pdMS_TO_TICKS(window->window_ms), pdFALSE,
+                window, esp_rmaker_report_window_timer_cb);
+        if (!window->timer) {
+            ESP_LOGW(TAG, "Failed to create the report coalescing timer, reporting changes immediately.");
+        }
+    }
+}
+
+static bool esp_rmaker_dirty_has_immediate(uint8_t flags)
+{
+    _esp_rmaker_node_t *node = (_esp_rmaker_node_t *)esp_rmaker_get_node();
+    for (_esp_rmaker_device_t *device = node->dirty_devices; device; device = device->dirty_next) {
+        for (_esp_rmaker_param_t *param = device->dirty_params; param; param = param->dirty_next) {
+            if ((param->flags & flags) && param->report_immediate) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Reports the params pending for the class in flags right away if immediate, else at the end
+ * of the coalescing window of the class, along with everything else changed until then.
+ */
+static esp_err_t esp_rmaker_report_params_coalesced(uint8_t flags, bool immediate)
+{
+    esp_rmaker_report_window_t *window = NULL;
+    for (size_t i = 0; i < sizeof(s_report_windows) / sizeof(s_report_windows[0]); i++) {
+        if (s_report_windows[i].flags == flags) {
+            window = &s_report_windows[i];
+            break;
+        }
+    }
+    if (!immediate && window && window->timer) {
+        /* A running timer will pick this change up as well */
+        if (xTimerIsTimerActive(window->timer) || xTimerStart(window->timer, 0) == pdPASS) {
+            return ESP_OK;
+        }
+    }
+    return esp_rmaker_report_param_internal(flags);
+}
+
+/* json_parser cannot list the members of an object, so they are found from the token
+ * spans: a value covers every token nested in it, and the next key follows. Returns the
+ * key after `key` in `obj`, or the first one for NULL. */
+static json_tok_t *json_obj_next_key(const jparse_ctx_t *jctx, const json_tok_t *obj, const json_tok_t *key)
+{
+    const json_tok_t *end = jctx->tokens + jctx->num_tokens;
+    const json_tok_t *next = obj + 1;
+    if (obj->type != JSMN_OBJECT) {
+        return NULL;
+    }
+    if (key) {
+        const json_tok_t *val = key + 1;
+        next = val + 1;
+        while (next < end && next->start < val->end) {
+            next++;
+        }
+    }
+    if (next >= end || next->start >= obj->end || next->type != JSMN_STRING) {
+        return NULL;
+    }
+    return (json_tok_t *)next;
+}
+
+/* Whether an earlier key of obj has the same name; only the first one counts, as with
+ * json_obj_get_*(). Used for the devices of a request, which are few. */
+static bool json_obj_key_repeated(const jparse_ctx_t *jctx, const json_tok_t *obj, const json_tok_t *key)
+{
+    int len = key->end - key->start;
+    for (json_tok_t *k = json_obj_next_key(jctx, obj, NULL); k && k != key; k = json_obj_next_key(jctx, obj, k)) {
+        if (k->end - k->start == len && strncmp(jctx->js + k->start, jctx->js + key->start, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Read the value token that follows a key the way json_obj_get_*() read it after looking the
+ * key up by name. Return 0 on success. */
+static int json_tok_get_bool(const jparse_ctx_t *jctx, const json_tok_t *val, bool *b)
+{
+    const char *js = jctx->js + val->start;
+    int len = val->end - val->start;
+    if (val->type != JSMN_PRIMITIVE) {
+        return -1;
+    }
+    if ((len == 4 && strncmp(js, "true", 4) == 0) || (len == 1 && *js == '1')) {
+        *b = true;
+    } else if ((len == 5 && strncmp(js, "false", 5) == 0) || (len == 1 && *js == '0')) {
+        *b = false;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static int json_tok_get_int(const jparse_ctx_t *jctx, const json_tok_t *val, int *i)
+{
+    char *end;
+    if (val->type != JSMN_PRIMITIVE) {
+        return -1;
+    }
+    long l = strtol(jctx->js + val->start, &end, 10);
+    if (end != jctx->js + val->end) {
+        return -1;
+    }
+    *i = (int) l;
+    return 0;
+}
+
+static int json_tok_get_float(const jparse_ctx_t *jctx, const json_tok_t *val, float *f)
+{
+    char *end;
+    if (val->type != JSMN_PRIMITIVE) {
+        return -1;
+    }
+    float v = strtof(jctx->js + val->start, &end);
+    if (end != jctx->js + val->end) {
+        return -1;
+    }
+    *f = v;
+    return 0;
+}
+
+/* Strings, objects and arrays are passed on as their JSON text, as json_obj_get_*_str() do */
+static int json_tok_get_strlen(const json_tok_t *val, jsmntype_t type, int *len)
+{
+    if (val->type != type) {
+        return -1;
+    }
+    *len = val->end - val->start;
+    return 0;
+}
+
+/* Arena bytes taken by one write request: its slot, and its string value padded for alignment */
+#define SET_PARAMS_ARENA_PER_PARAM  (sizeof(esp_rmaker_param_write_req_t) + sizeof(void *))
+#define SET_PARAMS_ARENA_ALIGN(x)   (((x) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+static void esp_rmaker_set_params_arena_release(void)
+{
+    portENTER_CRITICAL(&s_set_params_arena_lock);
+    s_set_params_arena.busy = false;
+    portEXIT_CRITICAL(&s_set_params_arena_lock);
+}
+
+/* Takes the arena for one device's request, growing it if the request could not fit.
+ * Returns false if it is busy or cannot grow, in which case the request uses the heap.
+ */
+static bool esp_rmaker_set_params_arena_acquire(size_t needed)
+{
+    portENTER_CRITICAL(&s_set_params_arena_lock);
+    bool busy = s_set_params_arena.busy;
+    s_set_params_arena.busy = true;
+    portEXIT_CRITICAL(&s_set_params_arena_lock);
+    if (busy) {
+        return false;
+    }
+    if (needed > s_set_params_arena.size) {
+        /* Sized once for the largest device of the node and a full payload */
+        size_t size = CONFIG_ESP_RMAKER_MAX_PARAM_DATA_SIZE;
+        uint8_t max_params = 0;
+        for (_esp_rmaker_device_t *device = esp_rmaker_node_get_first_device(esp_rmaker_get_node());
+                device; device = device->next) {
+            if (device->param_count > max_params) {
+                max_params = device->param_count;
+            }
+        }
+        size += max_params * SET_PARAMS_ARENA_PER_PARAM;
+        if (size < needed) {
+            size = needed;
+        }
+        free(s_set_params_arena.buf);
+        s_set_params_arena.size = 0;
+        s_set_params_heap_allocs++;
+        s_set_params_arena.buf = MEM_CALLOC_EXTRAM(1, size);
+        if (!s_set_params_arena.buf) {
+            ESP_LOGE(TAG, "Could not allocate %lu bytes for set params.", (unsigned long) size);
+            esp_rmaker_set_params_arena_release();
+            return false;
+        }
+        s_set_params_arena.size = size;
+        ESP_LOGD(TAG, "Set params arena of %lu bytes.", (unsigned long) size);
+    }
+    s_set_params_arena.used = 0;
+    return true;
+}
+
+/* Zeroed memory from the arena if the request holds it, else from the heap */
+static void *esp_rmaker_set_params_alloc(bool arena, size_t size)
+{
+    if (arena) {
+        size_t aligned = SET_PARAMS_ARENA_ALIGN(size);
+        if (aligned <= s_set_params_arena.size - s_set_params_arena.used) {
+            void *ptr = s_set_params_arena.buf + s_set_params_arena.used;
+            s_set_params_arena.used += aligned;
+            memset(ptr, 0, size);
+            return ptr;
+        }
+    }
+    s_set_params_heap_allocs++;
+    return MEM_CALLOC_EXTRAM(1, size);
+}
+
+static void esp_rmaker_set_params_free(void *ptr)
+{
+    char *p = ptr;
+    if (p && !(p >= s_set_params_arena.buf && p < s_set_params_arena.buf + s_set_params_arena.size)) {
+        free(p);
+    }
+}
+
+uint32_t esp_rmaker_param_get_write_heap_allocs(void)
+{
+    return s_set_params_heap_allocs;
+}
+
+/* Goes by the keys of the request rather than by the params of the device, so the cost
+ * follows the size of the request and not that of the device. */
 static esp_err_t esp_rmaker_device_set_params(_esp_rmaker_device_t *device, jparse_ctx_t *jptr, esp_rmaker_req_src_t src)
 {
-    _esp_rmaker_param_t *param = device->params;
-    esp_rmaker_param_write_req_t *write_req = MEM_CALLOC_EXTRAM(device->param_count, sizeof(esp_rmaker_param_write_req_t));
+    const json_tok_t *obj = jptr->cur;
+    /* String values are copied out of the device's object, so they fit in its span */
+    bool arena = esp_rmaker_set_params_arena_acquire(device->param_count * SET_PARAMS_ARENA_PER_PARAM +
+            SET_PARAMS_ARENA_ALIGN(obj->end - obj->start));
+    esp_rmaker_param_write_req_t *write_req = esp_rmaker_set_params_alloc(arena,
+            device->param_count * sizeof(esp_rmaker_param_write_req_t));
     if (!write_req) {
         ESP_LOGE(TAG, "Could not allocate memory for set params.");
+        if (arena) {
+            esp_rmaker_set_params_arena_release();
+        }
         return ESP_ERR_NO_MEM;
     }
     esp_err_t err = ESP_OK;
 
-    uint8_t num_param = 0;
-    while (param) {
+    /* Values go to the front of write_req. A param whose first key had a value of the wrong
+     * type is parked at the back, so that its repeated keys are skipped all the same. Each
+     * param takes one slot, so the two never meet. */
+    uint8_t num_param = 0, num_refused = 0;
+    for (json_tok_t *key = json_obj_next_key(jptr, obj, NULL); key && num_param + num_refused < device->param_count;
+            key = json_obj_next_key(jptr, obj, key)) {
+        _esp_rmaker_param_t *param = esp_rmaker_device_find_param(device, jptr->js + key->start,
+                key->end - key->start);
+        if (!param) {
+            continue;
+        }
+        bool repeated = false;
+        for (int i = 0; i < num_param + num_refused && !repeated; i++) {
+            int slot = i < num_param ? i : device->param_count - 1 - (i - num_param);
+            repeated = write_req[slot].param == (esp_rmaker_param_t *)param;
+        }
+        if (repeated) {
+            continue;
+        }
+        const json_tok_t *val = key + 1;
+        esp_rmaker_param_write_req_t *req = &write_req[num_param];
         bool param_found = false;
+        int val_size = 0;
         switch(param->val.type) {
             case RMAKER_VAL_TYPE_BOOLEAN:
-                if (json_obj_get_bool(jptr, param->name, &write_req[num_param].val.val.b) == 0) {
-                    write_req[num_param].param = (esp_rmaker_param_t *)param;
-                    write_req[num_param].val.type = RMAKER_VAL_TYPE_BOOLEAN;
-                    param_found = true;
-                }
+                param_found = json_tok_get_bool(jptr, val, &req->val.val.b) == 0;
                 break;
             case RMAKER_VAL_TYPE_INTEGER:
-                if (json_obj_get_int(jptr, param->name, &write_req[num_param].val.val.i) == 0) {
-                    write_req[num_param].param = (esp_rmaker_param_t *)param;
-                    write_req[num_param].val.type = RMAKER_VAL_TYPE_INTEGER;
-                    param_found = true;
-                }
+                param_found = json_tok_get_int(jptr, val, &req->val.val.i) == 0;
                 break;
             case RMAKER_VAL_TYPE_FLOAT:
-                if (json_obj_get_float(jptr, param->name, &write_req[num_param].val.val.f) == 0) {
-                    write_req[num_param].param = (esp_rmaker_param_t *)param;
-                    write_req[num_param].val.type = RMAKER_VAL_TYPE_FLOAT;
-                    param_found = true;
-                }
+                param_found = json_tok_get_float(jptr, val, &req->val.val.f) == 0;
                 break;
-            case RMAKER_VAL_TYPE_STRING: {
-                int val_size = 0;
-                if (json_obj_get_strlen(jptr, param->name, &val_size) == 0) {
-                    val_size++; /* For NULL termination */
-                    write_req[num_param].val.val.s = MEM_CALLOC_EXTRAM(1, val_size);
-                    if (!write_req[num_param].val.val.s) {
-                        err = ESP_ERR_NO_MEM;
-                        goto set_params_free;
-                    }
-                    json_obj_get_string(jptr, param->name, write_req[num_param].val.val.s, val_size);
-                    write_req[num_param].param = (esp_rmaker_param_t *)param;
-                    write_req[num_param].val.type = RMAKER_VAL_TYPE_STRING;
-                    param_found = true;
-                }
+            case RMAKER_VAL_TYPE_STRING:
+                param_found = json_tok_get_strlen(val, JSMN_STRING, &val_size) == 0;
                 break;
-            }
-            case RMAKER_VAL_TYPE_OBJECT: {
-                int val_size = 0;
-                if (json_obj_get_object_strlen(jptr, param->name, &val_size) == 0) {
-                    val_size++; /* For NULL termination */
-                    write_req[num_param].val.val.s = MEM_CALLOC_EXTRAM(1, val_size);
-                    if (!write_req[num_param].val.val.s) {
-                        err = ESP_ERR_NO_MEM;
-                        goto set_params_free;
-                    }
-                    json_obj_get_object_str(jptr, param->name, write_req[num_param].val.val.s, val_size);
-                    write_req[num_param].param = (esp_rmaker_param_t *)param;
-                    write_req[num_param].val.type = RMAKER_VAL_TYPE_OBJECT;
-                    param_found = true;
-                }
+            case RMAKER_VAL_TYPE_OBJECT:
+                param_found = json_tok_get_strlen(val, JSMN_OBJECT, &val_size) == 0;
                 break;
-            }
-            case RMAKER_VAL_TYPE_ARRAY: {
-                int val_size = 0;
-                if (json_obj_get_array_strlen(jptr, param->name, &val_size) == 0) {
-                    val_size++; /* For NULL termination */
-                    write_req[num_param].val.val.s = MEM_CALLOC_EXTRAM(1, val_size);
-                    if (!write_req[num_param].val.val.s) {
-                        err = ESP_ERR_NO_MEM;
-                        goto set_params_free;
-                    }
-                    json_obj_get_array_str(jptr, param->name, write_req[num_param].val.val.s, val_size);
-                    write_req[num_param].param = (esp_rmaker_param_t *)param;
-                    write_req[num_param].val.type = RMAKER_VAL_TYPE_ARRAY;
-                    param_found = true;
-                }
+            case RMAKER_VAL_TYPE_ARRAY:
+                param_found = json_tok_get_strlen(val, JSMN_ARRAY, &val_size) == 0;
                 break;
-            }
             default:
                 break;
         }
-        if (param_found) {
-            num_param++;
+        if (!param_found) {
+            write_req[device->param_count - 1 - num_refused++].param = (esp_rmaker_param_t *)param;
+            continue;
         }
-        param = param->next;
+        if (param->val.type == RMAKER_VAL_TYPE_STRING || param->val.type == RMAKER_VAL_TYPE_OBJECT ||
+                param->val.type == RMAKER_VAL_TYPE_ARRAY) {
+            req->val.val.s = esp_rmaker_set_params_alloc(arena, val_size + 1); /* For NULL termination */
+            if (!req->val.val.s) {
+                err = ESP_ERR_NO_MEM;
+                goto set_params_free;
+            }
+            memcpy(req->val.val.s, jptr->js + val->start, val_size);
+        }
+        req->param = (esp_rmaker_param_t *)param;
+        req->val.type = param->val.type;
+        num_param++;
     }
     ESP_LOGI(TAG, "Found %d params in write request for %s", num_param, device->name);
     if (device->bulk_write_cb) {
@@ -395,17 +744,16 @@ static esp_err_t esp_rmaker_device_set_params(_esp_rmaker_device_t *device, jpar
         }
     }
 set_params_free:
-    /* Free all values which are allocated on heap */
+    /* Free the values that did not fit in the arena, or all of them if it was busy */
     for (int i = 0; i < num_param; i++) {
         if ((write_req[i].val.type == RMAKER_VAL_TYPE_STRING) || (write_req[i].val.type == RMAKER_VAL_TYPE_OBJECT ||
                     (write_req[i].val.type == RMAKER_VAL_TYPE_ARRAY))) {
-            if (write_req[i].val.val.s) {
-                free(write_req[i].val.val.s);
-            }
+            esp_rmaker_set_params_free(write_req[i].val.val.s);
         }
     }
-    if (write_req) {
-        free(write_req);
+    esp_rmaker_set_params_free(write_req);
+    if (arena) {
+        esp_rmaker_set_params_arena_release();
     }
     return err;
 }
@@ -417,13 +765,21 @@ esp_err_t esp_rmaker_handle_set_params(char *data, size_t data_len, esp_rmaker_r
     if (json_parse_start(&jctx, data, data_len) != 0) {
         return ESP_FAIL;
     }
-    _esp_rmaker_device_t *device = esp_rmaker_node_get_first_device(esp_rmaker_get_node());
-    while (device) {
-        if (json_obj_get_object(&jctx, device->name) == 0) {
+    /* One index lookup per device in the request instead of a search of the request per
+     * device of the node */
+    json_tok_t *root = jctx.cur;
+    for (json_tok_t *key = json_obj_next_key(&jctx, root, NULL); key; key = json_obj_next_key(&jctx, root, key)) {
+        json_tok_t *val = key + 1;
+        if (val->type != JSMN_OBJECT || json_obj_key_repeated(&jctx, root, key)) {
+            continue;
+        }
+        _esp_rmaker_device_t *device = esp_rmaker_node_find_device(esp_rmaker_get_node(), jctx.js + key->start,
+                key->end - key->start);
+        if (device) {
+            jctx.cur = val;
             esp_rmaker_device_set_params(device, &jctx, src);
-            json_obj_leave_object(&jctx);
+            jctx.cur = root;
         }
-        device = device->next;
     }
     json_parse_end(&jctx);
     return ESP_OK;
@@ -660,6 +1016,16 @@ esp_err_t esp_rmaker_param_add_simple_time_series_ttl(const esp_rmaker_param_t *
     return ESP_OK;
 }
 
+esp_err_t esp_rmaker_param_add_report_immediate(const esp_rmaker_param_t *param)
+{
+    if (!param) {
+        ESP_LOGE(TAG, "Param handle cannot be NULL.");
+        return ESP_ERR_INVALID_ARG;
+    }
+    ((_esp_rmaker_param_t *)param)->report_immediate = true;
+    return ESP_OK;
+}
+
 esp_err_t esp_rmaker_param_add_valid_str_list(const esp_rmaker_param_t *param, const char *strs[], uint8_t count)
 {
     if (!param) {
@@ -762,7 +1128,7 @@ esp_err_t esp_rmaker_param_update(const esp_rmaker_param_t *param, esp_rmaker_pa
         default:
             return ESP_ERR_INVALID_ARG;
     }
-    _param->flags |= RMAKER_PARAM_FLAG_VALUE_CHANGE;
+    esp_rmaker_param_mark(_param, RMAKER_PARAM_FLAG_VALUE_CHANGE);
     if (_param->prop_flags & PROP_FLAG_PERSIST) {
         esp_rmaker_param_store_value(_param);
     }
@@ -854,7 +1220,8 @@ static esp_err_t esp_rmaker_simple_ts_data_report_internal(
     const esp_rmaker_param_val_t *val,  /* Optional (NULL to use param's current value) */
     int timestamp,                      /* 0 to use current time */
     uint16_t ttl_days,                  /* 0 to omit TTL field */
-    bool update_param)                  /* Whether to update param value with val */
+    bool update_param,                  /* Whether to update param value with val */
+    bool cache_only)                    /* Keep the updated value out of the next params report */
 {
     if (!param) {
         ESP_LOGE(TAG, "Param handle cannot be NULL.");
@@ -868,11 +1235,17 @@ static esp_err_t esp_rmaker_simple_ts_data_report_internal(
     }
     /* Update param value if requested */
     if (update_param && val) {
+        bool was_changed = _param->flags & RMAKER_PARAM_FLAG_VALUE_CHANGE;
         esp_err_t err = esp_rmaker_param_update(param, *val);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "Failed to update parameter value locally.");
             return err;
         }
+        if (cache_only && !was_changed) {
+            portENTER_CRITICAL(&s_dirty_lock);
+            _param->flags &= ~RMAKER_PARAM_FLAG_VALUE_CHANGE;
+            portEXIT_CRITICAL(&s_dirty_lock);
+        }
     }
     /* Check that time is available if needed */
     if (timestamp == 0 && esp_rmaker_time_check() != true) {
@@ -944,7 +1317,7 @@ static esp_err_t esp_rmaker_param_report_simple_time_series(const esp_rmaker_par
         return ESP_ERR_INVALID_ARG;
     }
     /* Use common implementation with no custom value, timestamp, or TTL */
-    return esp_rmaker_simple_ts_data_report_internal(param, NULL, 0, 0, false);
+    return esp_rmaker_simple_ts_data_report_internal(param, NULL, 0, 0, false, false);
 }
 
 esp_err_t esp_rmaker_param_notify(const esp_rmaker_param_t *param)
@@ -953,12 +1326,61 @@ esp_err_t esp_rmaker_param_notify(const esp_rmaker_param_t *param)
         ESP_LOGE(TAG, "Param handle cannot be NULL.");
         return ESP_ERR_INVALID_ARG;
     }
-    ((_esp_rmaker_param_t *)param)->flags |= (RMAKER_PARAM_FLAG_VALUE_CHANGE | RMAKER_PARAM_FLAG_VALUE_NOTIFY);
-    esp_err_t err = esp_rmaker_report_param_internal(RMAKER_PARAM_FLAG_VALUE_NOTIFY);
+    esp_rmaker_param_mark((_esp_rmaker_param_t *)param, RMAKER_PARAM_FLAG_VALUE_CHANGE | RMAKER_PARAM_FLAG_VALUE_NOTIFY);
+    bool immediate = ((_esp_rmaker_param_t *)param)->report_immediate;
+    esp_err_t err = esp_rmaker_report_params_coalesced(RMAKER_PARAM_FLAG_VALUE_NOTIFY, immediate);
     if (err != ESP_OK) {
         ESP_LOGW(TAG, "Failed to report parameter");
     }
-    return esp_rmaker_report_param_internal(RMAKER_PARAM_FLAG_VALUE_CHANGE);
+    return esp_rmaker_report_params_coalesced(RMAKER_PARAM_FLAG_VALUE_CHANGE, immediate);
+}
+
+static bool esp_rmaker_param_batch_in_progress(void)
+{
+    portENTER_CRITICAL(&s_param_batch_lock);
+    bool in_progress = (s_param_batch_depth > 0);
+    portEXIT_CRITICAL(&s_param_batch_lock);
+    return in_progress;
+}
+
+esp_err_t esp_rmaker_param_batch_begin(void)
+{
+    esp_err_t err = ESP_OK;
+    portENTER_CRITICAL(&s_param_batch_lock);
+    if (s_param_batch_depth == UINT8_MAX) {
+        err = ESP_ERR_INVALID_STATE;
+    } else {
+        s_param_batch_depth++;
+    }
+    portEXIT_CRITICAL(&s_param_batch_lock);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Too many nested param batches.");
+    }
+    return err;
+}
+
+esp_err_t esp_rmaker_param_batch_commit(void)
+{
+    esp_err_t err = ESP_OK;
+    bool report = false;
+    portENTER_CRITICAL(&s_param_batch_lock);
+    if (s_param_batch_depth == 0) {
+        err = ESP_ERR_INVALID_STATE;
+    } else {
+        s_param_batch_depth--;
+        /* Only the outermost commit reports */
+        report = (s_param_batch_depth == 0);
+    }
+    portEXIT_CRITICAL(&s_param_batch_lock);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No param batch in progress.");
+        return err;
+    }
+    if (report && (esp_rmaker_get_state() == ESP_RMAKER_STATE_STARTED)) {
+        err = esp_rmaker_report_params_coalesced(RMAKER_PARAM_FLAG_VALUE_CHANGE,
+                esp_rmaker_dirty_has_immediate(RMAKER_PARAM_FLAG_VALUE_CHANGE));
+    }
+    return err;
 }
 
 esp_err_t esp_rmaker_param_update_and_report(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
@@ -971,7 +1393,12 @@ esp_err_t esp_rmaker_param_update_and_report(const esp_rmaker_param_t *param, es
         } else if (((_esp_rmaker_param_t *)param)->prop_flags & PROP_FLAG_SIMPLE_TIME_SERIES) {
             esp_rmaker_param_report_simple_time_series(param);
         }
-        err = esp_rmaker_report_updated_params();
+        /* Inside a batch, the value change flag stays set and esp_rmaker_param_batch_commit() reports it */
+        if (esp_rmaker_param_batch_in_progress()) {
+            return ESP_OK;
+        }
+        err = esp_rmaker_report_params_coalesced(RMAKER_PARAM_FLAG_VALUE_CHANGE,
+                ((_esp_rmaker_param_t *)param)->report_immediate);
     }
     return err;
 }
@@ -1039,6 +1466,7 @@ esp_err_t esp_rmaker_params_mqtt_init(void)
     esp_err_t err = esp_rmaker_register_for_set_params();
     if (err == ESP_OK) {
         ESP_LOGI(TAG, "Params MQTT Init done.");
+        esp_rmaker_report_windows_init();
         esp_rmaker_params_mqtt_init_done = true;
         /* Report the current node state i.e. values of all the node parameters */
         esp_rmaker_report_node_state();
@@ -1075,7 +1503,8 @@ esp_err_t esp_rmaker_raise_alert(const char *alert_str)
     return esp_rmaker_mqtt_publish(publish_topic, buf, strlen(buf), RMAKER_MQTT_QOS1, NULL);
 }
 
-esp_err_t esp_rmaker_param_report_simple_ts_data(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val, int timestamp, uint16_t ttl_days)
+static esp_err_t esp_rmaker_param_report_simple_ts_data_internal(const esp_rmaker_param_t *param,
+        esp_rmaker_param_val_t val, int timestamp, uint16_t ttl_days, bool cache_only)
 {
     if (!param) {
         ESP_LOGE(TAG, "Param handle cannot be NULL.");
@@ -1088,7 +1517,88 @@ esp_err_t esp_rmaker_param_report_simple_ts_data(const esp_rmaker_param_t *param
         return ESP_ERR_INVALID_ARG;
     }
     /* Use common implementation with custom value, timestamp, and TTL */
-    return esp_rmaker_simple_ts_data_report_internal(param, &val, timestamp, ttl_days, true);
+    return esp_rmaker_simple_ts_data_report_internal(param, &val, timestamp, ttl_days, true, cache_only);
+}
+
+esp_err_t esp_rmaker_param_report_simple_ts_data(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val, int timestamp, uint16_t ttl_days)
+{
+    return esp_rmaker_param_report_simple_ts_data_internal(param, val, timestamp, ttl_days, false);
+}
+
+esp_err_t esp_rmaker_param_report_simple_ts_data_only(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val, int timestamp, uint16_t ttl_days)
+{
+    return esp_rmaker_param_report_simple_ts_data_internal(param, val, timestamp, ttl_days, true);
+}
+
+/* Same payload as esp_rmaker_param_report_time_series(), with one "ts_data" entry per run of
+ * records for the same param.
+ */
+static esp_err_t esp_rmaker_populate_ts_records(esp_rmaker_json_buf_t *jbuf,
+                                                const esp_rmaker_ts_record_t *records, size_t count)
+{
+    json_gen_str_t jstr;
+    char param_name[MAX_TS_DATA_PARAM_NAME];
+    esp_rmaker_json_buf_start(jbuf, &jstr, NULL, 0);
+    json_gen_start_object(&jstr);
+    json_gen_obj_set_string(&jstr, "ts_data_version", TS_DATA_VERSION);
+    json_gen_push_array(&jstr, "ts_data");
+    for (size_t i = 0; i < count; i++) {
+        const _esp_rmaker_param_t *_param = (const _esp_rmaker_param_t *)records[i].param;
+        if (i == 0 || records[i - 1].param != records[i].param) {
+            if (i > 0) {
+                json_gen_pop_array(&jstr);
+                json_gen_end_object(&jstr);
+            }
+            json_gen_start_object(&jstr);
+            snprintf(param_name, sizeof(param_name), "%s.%s", _param->parent->name, _param->name);
+            json_gen_obj_set_string(&jstr, "name", param_name);
+            if (_param->type) {
+                json_gen_obj_set_string(&jstr, "type", _param->type);
+            }
+            esp_rmaker_report_data_type(_param->val.type, "dt", &jstr);
+            json_gen_push_array(&jstr, "records");
+        }
+        json_gen_start_object(&jstr);
+        json_gen_obj_set_int(&jstr, "t", records[i].timestamp);
+        esp_rmaker_report_value(&records[i].val, "v", &jstr);
+        json_gen_end_object(&jstr);
+    }
+    if (count) {
+        json_gen_pop_array(&jstr);
+        json_gen_end_object(&jstr);
+    }
+    json_gen_pop_array(&jstr);
+    json_gen_end_object(&jstr);
+    return esp_rmaker_json_buf_end(jbuf, &jstr);
+}
+
+esp_err_t esp_rmaker_param_report_time_series_records(const esp_rmaker_ts_record_t *records, size_t count)
+{
+    if (!records || !count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const _esp_rmaker_param_t *_param = (const _esp_rmaker_param_t *)records[i].param;
+        if (!_param || !_param->parent || records[i].val.type != _param->val.type) {
+            ESP_LOGE(TAG, "Time series record %u has no valid param or a mismatched type.", (unsigned)i);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (!esp_rmaker_params_mqtt_init_done) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_rmaker_json_buf_t jbuf;
+    esp_err_t err = esp_rmaker_populate_ts_records(&jbuf, records, count);
+    if (err == ESP_OK) {
+        esp_rmaker_create_mqtt_topic(publish_topic, sizeof(publish_topic),
+                                     TIME_SERIES_DATA_TOPIC_SUFFIX, TIME_SERIES_DATA_TOPIC_RULE);
+        ESP_LOGI(TAG, "Reporting %u time series records (%lu bytes)", (unsigned)count, (unsigned long)jbuf.len);
+        err = esp_rmaker_mqtt_publish(publish_topic, jbuf.data, jbuf.len, RMAKER_MQTT_QOS1, NULL);
+    } else {
+        ESP_LOGE(TAG, "Failed to generate time series records JSON.");
+    }
+    free(jbuf.data);
+    return err;
 }
 
 
@@ -28,26 +28,13 @@ static char *esp_rmaker_get_changed_params(void)
         return NULL;
     }
 
-    size_t req_size = 0;
-    /* Get size for changed parameters only */
-    esp_err_t err = esp_rmaker_populate_params(NULL, &req_size, RMAKER_PARAM_FLAG_VALUE_CHANGE, false);
-    if (err != ESP_OK || req_size < RMAKER_MIN_VALID_PARAMS_SIZE) {
+    esp_rmaker_json_buf_t jbuf;
+    esp_err_t err = esp_rmaker_populate_params(&jbuf, NULL, 0, RMAKER_PARAM_FLAG_VALUE_CHANGE, true);
+    if (err != ESP_OK || jbuf.len < RMAKER_MIN_VALID_PARAMS_SIZE) {
+        free(jbuf.data);
         return NULL; /* No changed parameters */
     }
-
-    req_size += RMAKER_PARAMS_SIZE_MARGIN;
-    char *changed_params = MEM_CALLOC_EXTRAM(1, req_size);
-    if (!changed_params) {
-        return NULL;
-    }
-
-    err = esp_rmaker_populate_params(changed_params, &req_size, RMAKER_PARAM_FLAG_VALUE_CHANGE, true);
-    if (err != ESP_OK) {
-        free(changed_params);
-        return NULL;
-    }
-
-    return changed_params;
+    return esp_rmaker_json_buf_release(&jbuf);
 }
 
 /* Command handler for ESP_RMAKER_CMD_TYPE_SET_PARAMS (id=1)
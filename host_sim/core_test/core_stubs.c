@@ -0,0 +1,540 @@
+/* core_stubs.c - Platform stand-ins for the RainMaker core sources that core_test.c builds.
+ * Everything runs on the calling thread: software timers fire and queued work runs only
+ * when the test asks, MQTT publishes are kept in memory, and NVS holds nothing. The JSON
+ * generator and parser cover the calls that the core makes, with the buffering and token
+ * layout of the espressif components. */
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_app_desc.h"
+#include "esp_log.h"
+#include "esp_rmaker_mqtt.h"
+#include "esp_rmaker_work_queue.h"
+#include "esp_secure_boot.h"
+#include "freertos/timers.h"
+#include "json_generator.h"
+#include "json_parser.h"
+#include "nvs.h"
+#include "esp_rmaker_internal.h"
+#include "core_test.h"
+
+#define CORE_TEST_MAX_TIMERS    4
+#define CORE_TEST_MAX_WORK      8
+#define CORE_TEST_MAX_PUBLISHES 16
+#define CORE_TEST_MAX_TOKENS    256
+
+/* --- Node and state --- */
+static const esp_rmaker_node_t *s_node;
+static bool s_started;
+
+void core_test_set_node(const esp_rmaker_node_t *node) {
+    s_node = node;
+}
+
+void core_test_set_started(bool started) {
+    s_started = started;
+}
+
+const esp_rmaker_node_t *esp_rmaker_get_node(void) {
+    return s_node;
+}
+
+esp_rmaker_state_t esp_rmaker_get_state(void) {
+    return s_started ? ESP_RMAKER_STATE_STARTED : ESP_RMAKER_STATE_INIT_DONE;
+}
+
+char *esp_rmaker_get_node_id(void) {
+    return strdup("core-test");
+}
+
+const esp_app_desc_t *esp_app_get_description(void) {
+    static const esp_app_desc_t desc = { .version = "1.0", .project_name = "core_test" };
+    return &desc;
+}
+
+bool esp_secure_boot_enabled(void) {
+    return false;
+}
+
+char **esp_rmaker_get_secure_boot_digest(void) {
+    return NULL;
+}
+
+esp_err_t esp_rmaker_secure_boot_digest_free(char **digest) {
+    return ESP_OK;
+}
+
+bool esp_rmaker_time_check(void) {
+    return false;
+}
+
+esp_err_t esp_rmaker_time_sync_init(void *config) {
+    return ESP_OK;
+}
+
+#if CORE_TEST_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+/* --- Logging --- */
+void sim_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+    if (level > ESP_LOG_WARN && !getenv("CORE_TEST_VERBOSE")) return;
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c %s: ", letters[level], tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    return code == ESP_OK ? "ESP_OK" : "ESP_ERR";
+}
+
+/* --- Critical sections --- */
+static int s_critical_depth;
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+    s_critical_depth++;
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+    if (--s_critical_depth < 0) abort();
+}
+
+int core_test_critical_depth(void) {
+    return s_critical_depth;
+}
+
+/* --- Software timers --- */
+struct core_test_timer {
+    void *id;
+    TimerCallbackFunction_t callback;
+    bool active;
+};
+
+static struct core_test_timer s_timers[CORE_TEST_MAX_TIMERS];
+static size_t s_timer_count;
+
+TimerHandle_t xTimerCreate(const char *pcTimerName, TickType_t xTimerPeriodInTicks, UBaseType_t uxAutoReload,
+                           void *pvTimerID, TimerCallbackFunction_t pxCallbackFunction) {
+    if (s_timer_count == CORE_TEST_MAX_TIMERS || uxAutoReload) return NULL;
+    struct core_test_timer *t = &s_timers[s_timer_count++];
+    t->id = pvTimerID;
+    t->callback = pxCallbackFunction;
+    return t;
+}
+
+BaseType_t xTimerStart(TimerHandle_t xTimer, TickType_t xTicksToWait) {
+    xTimer->active = true;
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t xTimer, TickType_t xTicksToWait) {
+    xTimer->active = false;
+    return pdPASS;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t xTimer, TickType_t xTicksToWait) {
+    xTimer->active = false;
+    xTimer->callback = NULL;
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer) {
+    return xTimer->active;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t xTimer) {
+    return xTimer->id;
+}
+
+int core_test_fire_timers(void) {
+    int fired = 0;
+    for (size_t i = 0; i < s_timer_count; i++) {
+        struct core_test_timer *t = &s_timers[i];
+        if (!t->active || !t->callback) continue;
+        /* One-shot: no longer active when the callback runs */
+        t->active = false;
+        t->callback(t);
+        fired++;
+    }
+    return fired;
+}
+
+/* --- Work queue --- */
+typedef struct {
+    esp_rmaker_work_fn_t fn;
+    void *priv;
+} core_test_work_t;
+
+static core_test_work_t s_work[CORE_TEST_MAX_WORK];
+static size_t s_work_count;
+
+esp_err_t esp_rmaker_work_queue_add_task(esp_rmaker_work_fn_t work_fn, void *priv_data) {
+    if (s_work_count == CORE_TEST_MAX_WORK) return ESP_FAIL;
+    s_work[s_work_count++] = (core_test_work_t) { work_fn, priv_data };
+    return ESP_OK;
+}
+
+int core_test_run_work(void) {
+    int ran = 0;
+    /* Work may queue more work, which runs in the same call */
+    for (size_t i = 0; i < s_work_count; i++, ran++) {
+        s_work[i].fn(s_work[i].priv);
+    }
+    s_work_count = 0;
+    return ran;
+}
+
+/* --- MQTT --- */
+typedef struct {
+    char *topic;
+    char *payload;
+} core_test_publish_t;
+
+static core_test_publish_t s_publishes[CORE_TEST_MAX_PUBLISHES];
+static size_t s_publish_count;
+
+esp_err_t esp_rmaker_mqtt_publish(const char *topic, void *data, size_t data_len, uint8_t qos, int *msg_id) {
+    if (s_publish_count == CORE_TEST_MAX_PUBLISHES) return ESP_FAIL;
+    core_test_publish_t *p = &s_publishes[s_publish_count++];
+    p->topic = strdup(topic);
+    p->payload = strndup(data, data_len);
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_mqtt_subscribe(const char *topic, esp_rmaker_mqtt_subscribe_cb_t cb, uint8_t qos, void *priv_data) {
+    return ESP_OK;
+}
+
+void esp_rmaker_create_mqtt_topic(char *buf, size_t buf_size, const char *topic_suffix, const char *rule) {
+    snprintf(buf, buf_size, "node/core-test/%s", topic_suffix);
+}
+
+size_t core_test_publish_count(void) {
+    return s_publish_count;
+}
+
+const char *core_test_publish_topic(size_t i) {
+    return i < s_publish_count ? s_publishes[i].topic : "";
+}
+
+const char *core_test_publish_payload(size_t i) {
+    return i < s_publish_count ? s_publishes[i].payload : "";
+}
+
+void core_test_clear_publishes(void) {
+    for (size_t i = 0; i < s_publish_count; i++) {
+        free(s_publishes[i].topic);
+        free(s_publishes[i].payload);
+    }
+    s_publish_count = 0;
+}
+
+/* --- NVS --- */
+esp_err_t nvs_open_from_partition(const char *part_name, const char *namespace_name, nvs_open_mode_t open_mode,
+                                  nvs_handle_t *out_handle) {
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length) {
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+/* --- JSON generator --- */
+static int json_gen_add(json_gen_str_t *jstr, const char *str) {
+    size_t len = strlen(str);
+    jstr->total_len += len;
+    if (!jstr->buf) return 0;
+    while (len) {
+        size_t room = jstr->buf_size - (jstr->free_ptr - jstr->buf) - 1;
+        if (!room) {
+            if (!jstr->flush_cb) return -1;
+            jstr->flush_cb(jstr->buf, jstr->priv);
+            jstr->free_ptr = jstr->buf;
+            continue;
+        }
+        size_t n = len < room ? len : room;
+        memcpy(jstr->free_ptr, str, n);
+        jstr->free_ptr += n;
+        *jstr->free_ptr = '\0';
+        str += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Separator and key of the next member; name NULL for an array element */
+static int json_gen_member(json_gen_str_t *jstr, const char *name) {
+    if (jstr->comma_req) json_gen_add(jstr, ",");
+    jstr->comma_req = true;
+    if (!name) return 0;
+    json_gen_add(jstr, "\"");
+    json_gen_add(jstr, name);
+    return json_gen_add(jstr, "\":");
+}
+
+static int json_gen_open(json_gen_str_t *jstr, const char *name, const char *bracket) {
+    json_gen_member(jstr, name);
+    jstr->comma_req = false;
+    return json_gen_add(jstr, bracket);
+}
+
+static int json_gen_close(json_gen_str_t *jstr, const char *bracket) {
+    jstr->comma_req = true;
+    return json_gen_add(jstr, bracket);
+}
+
+void json_gen_str_start(json_gen_str_t *jstr, char *buf, int buf_size, json_gen_flush_cb_t flush_cb, void *priv) {
+    memset(jstr, 0, sizeof(*jstr));
+    jstr->buf = buf;
+    jstr->buf_size = buf_size;
+    jstr->flush_cb = flush_cb;
+    jstr->priv = priv;
+    jstr->free_ptr = buf;
+    jstr->start = buf;
+    if (buf && buf_size) *buf = '\0';
+}
+
+int json_gen_str_end(json_gen_str_t *jstr) {
+    if (jstr->buf && jstr->flush_cb) jstr->flush_cb(jstr->buf, jstr->priv);
+    int len = jstr->total_len + 1;
+    memset(jstr, 0, sizeof(*jstr));
+    return len;
+}
+
+int json_gen_start_object(json_gen_str_t *jstr) {
+    return json_gen_open(jstr, NULL, "{");
+}
+
+int json_gen_end_object(json_gen_str_t *jstr) {
+    return json_gen_close(jstr, "}");
+}
+
+int json_gen_push_object(json_gen_str_t *jstr, const char *name) {
+    return json_gen_open(jstr, name, "{");
+}
+
+int json_gen_pop_object(json_gen_str_t *jstr) {
+    return json_gen_close(jstr, "}");
+}
+
+int json_gen_push_array(json_gen_str_t *jstr, const char *name) {
+    return json_gen_open(jstr, name, "[");
+}
+
+int json_gen_pop_array(json_gen_str_t *jstr) {
+    return json_gen_close(jstr, "]");
+}
+
+int json_gen_push_object_str(json_gen_str_t *jstr, const char *name, const char *object_str) {
+    json_gen_member(jstr, name);
+    return json_gen_add(jstr, object_str);
+}
+
+int json_gen_push_array_str(json_gen_str_t *jstr, const char *name, const char *array_str) {
+    json_gen_member(jstr, name);
+    return json_gen_add(jstr, array_str);
+}
+
+int json_gen_obj_set_bool(json_gen_str_t *jstr, const char *name, bool val) {
+    json_gen_member(jstr, name);
+    return json_gen_add(jstr, val ? "true" : "false");
+}
+
+int json_gen_obj_set_int(json_gen_str_t *jstr, const char *name, int val) {
+    char num[16];
+    snprintf(num, sizeof(num), "%d", val);
+    json_gen_member(jstr, name);
+    return json_gen_add(jstr, num);
+}
+
+int json_gen_obj_set_float(json_gen_str_t *jstr, const char *name, float val) {
+    char num[32];
+    snprintf(num, sizeof(num), "%.*f", 5, val);
+    json_gen_member(jstr, name);
+    return json_gen_add(jstr, num);
+}
+
+int json_gen_obj_set_string(json_gen_str_t *jstr, const char *name, const char *val) {
+    json_gen_member(jstr, name);
+    json_gen_add(jstr, "\"");
+    json_gen_add(jstr, val);
+    return json_gen_add(jstr, "\"");
+}
+
+int json_gen_obj_set_null(json_gen_str_t *jstr, const char *name) {
+    json_gen_member(jstr, name);
+    return json_gen_add(jstr, "null");
+}
+
+int json_gen_arr_set_string(json_gen_str_t *jstr, const char *val) {
+    json_gen_member(jstr, NULL);
+    json_gen_add(jstr, "\"");
+    json_gen_add(jstr, val);
+    return json_gen_add(jstr, "\"");
+}
+
+/* --- JSON parser --- */
+static json_tok_t s_tokens[CORE_TEST_MAX_TOKENS];
+
+static void json_skip(const char *js, int len, int *pos, const char *chars) {
+    while (*pos < len && (isspace((unsigned char)js[*pos]) || strchr(chars, js[*pos]))) (*pos)++;
+}
+
+/* Tokenizes the value at *pos and everything in it; returns its token or -1 */
+static int json_tokenize(const char *js, int len, int *pos, int *count, int parent) {
+    json_skip(js, len, pos, "");
+    if (*pos >= len || *count == CORE_TEST_MAX_TOKENS) return -1;
+    int me = (*count)++;
+    json_tok_t *t = &s_tokens[me];
+    *t = (json_tok_t) { .start = *pos, .parent = parent };
+    char c = js[*pos];
+    if (c == '{' || c == '[') {
+        char close = c == '{' ? '}' : ']';
+        t->type = c == '{' ? JSMN_OBJECT : JSMN_ARRAY;
+        (*pos)++;
+        while (1) {
+            json_skip(js, len, pos, ",");
+            if (*pos >= len) return -1;
+            if (js[*pos] == close) break;
+            int child = json_tokenize(js, len, pos, count, me);
+            if (child < 0) return -1;
+            s_tokens[me].size++;
+            if (s_tokens[me].type == JSMN_OBJECT) {
+                /* A key has its value as its one child */
+                json_skip(js, len, pos, ":");
+                if (json_tokenize(js, len, pos, count, child) < 0) return -1;
+                s_tokens[child].size = 1;
+            }
+        }
+        (*pos)++;
+        s_tokens[me].end = *pos;
+    } else if (c == '"') {
+        t->type = JSMN_STRING;
+        t->start = ++(*pos);
+        while (*pos < len && js[*pos] != '"') *pos += js[*pos] == '\\' ? 2 : 1;
+        if (*pos >= len) return -1;
+        t->end = (*pos)++;
+    } else {
+        t->type = JSMN_PRIMITIVE;
+        while (*pos < len && !strchr(",:}] \t\r\n", js[*pos])) (*pos)++;
+        t->end = *pos;
+    }
+    return me;
+}
+
+int json_parse_start(jparse_ctx_t *jctx, const char *js, int len) {
+    int pos = 0, count = 0;
+    if (json_tokenize(js, len, &pos, &count, -1) < 0 || s_tokens[0].type != JSMN_OBJECT) return -1;
+    jctx->tokens = s_tokens;
+    jctx->num_tokens = count;
+    jctx->cur = s_tokens;
+    jctx->js = js;
+    return 0;
+}
+
+int json_parse_end(jparse_ctx_t *jctx) {
+    memset(jctx, 0, sizeof(*jctx));
+    return 0;
+}
+
+/* The value of the first key `name` of jctx->cur */
+static json_tok_t *json_obj_value(jparse_ctx_t *jctx, const char *name, jsmntype_t type) {
+    int obj = jctx->cur - jctx->tokens;
+    int len = strlen(name);
+    for (int i = obj + 1; i < jctx->num_tokens - 1; i++) {
+        json_tok_t *key = &jctx->tokens[i];
+        if (key->parent == obj && key->end - key->start == len && !strncmp(jctx->js + key->start, name, len)) {
+            return key[1].type == type ? &key[1] : NULL;
+        }
+    }
+    return NULL;
+}
+
+static int json_obj_value_len(jparse_ctx_t *jctx, const char *name, jsmntype_t type, int *len) {
+    json_tok_t *t = json_obj_value(jctx, name, type);
+    if (!t) return -1;
+    *len = t->end - t->start;
+    return 0;
+}
+
+static int json_obj_value_str(jparse_ctx_t *jctx, const char *name, jsmntype_t type, char *val, int size) {
+    json_tok_t *t = json_obj_value(jctx, name, type);
+    if (!t || t->end - t->start >= size) return -1;
+    memcpy(val, jctx->js + t->start, t->end - t->start);
+    val[t->end - t->start] = '\0';
+    return 0;
+}
+
+int json_obj_get_bool(jparse_ctx_t *jctx, const char *name, bool *val) {
+    json_tok_t *t = json_obj_value(jctx, name, JSMN_PRIMITIVE);
+    if (!t || (jctx->js[t->start] != 't' && jctx->js[t->start] != 'f')) return -1;
+    *val = jctx->js[t->start] == 't';
+    return 0;
+}
+
+int json_obj_get_int(jparse_ctx_t *jctx, const char *name, int *val) {
+    json_tok_t *t = json_obj_value(jctx, name, JSMN_PRIMITIVE);
+    if (!t) return -1;
+    *val = (int)strtol(jctx->js + t->start, NULL, 10);
+    return 0;
+}
+
+int json_obj_get_float(jparse_ctx_t *jctx, const char *name, float *val) {
+    json_tok_t *t = json_obj_value(jctx, name, JSMN_PRIMITIVE);
+    if (!t) return -1;
+    *val = strtof(jctx->js + t->start, NULL);
+    return 0;
+}
+
+int json_obj_get_string(jparse_ctx_t *jctx, const char *name, char *val, int size) {
+    return json_obj_value_str(jctx, name, JSMN_STRING, val, size);
+}
+
+int json_obj_get_strlen(jparse_ctx_t *jctx, const char *name, int *strlen) {
+    return json_obj_value_len(jctx, name, JSMN_STRING, strlen);
+}
+
+int json_obj_get_object_str(jparse_ctx_t *jctx, const char *name, char *val, int size) {
+    return json_obj_value_str(jctx, name, JSMN_OBJECT, val, size);
+}
+
+int json_obj_get_object_strlen(jparse_ctx_t *jctx, const char *name, int *strlen) {
+    return json_obj_value_len(jctx, name, JSMN_OBJECT, strlen);
+}
+
+int json_obj_get_array_str(jparse_ctx_t *jctx, const char *name, char *val, int size) {
+    return json_obj_value_str(jctx, name, JSMN_ARRAY, val, size);
+}
+
+int json_obj_get_array_strlen(jparse_ctx_t *jctx, const char *name, int *strlen) {
+    return json_obj_value_len(jctx, name, JSMN_ARRAY, strlen);
+}
@@ -0,0 +1,302 @@
+/* core_test.c - Checks of the RainMaker core sources on the host.
+ * Unlike smart_home_sim, which runs the application against a stand-in for RainMaker, this
+ * builds the core's own param, device, node, index and JSON buffer code (see core_stubs.c
+ * for what they run on) and checks:
+ *   - device and param lookups through the index, before and after devices and params are
+ *     added or removed once the index is built
+ *   - params reports carrying only the params changed since the last one
+ *   - changes coalesced by the report timer, and params that skip it
+ *   - set params requests with unknown and repeated keys
+ *   - the set params arena being reused from one write request to the next
+ *   - JSON output larger than the initial params buffer
+ * Exits with status 1 if any check fails:
+ *   cmake -S host_sim -B build_sim && cmake --build build_sim && ./build_sim/rmaker_core_test */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_rmaker_core.h"
+#include "esp_rmaker_standard_types.h"
+#include "esp_rmaker_internal.h"
+#include "core_test.h"
+
+static int failures;
+
+#define CHECK(cond) do {                                                        \
+        if (!(cond)) {                                                          \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);              \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+static esp_rmaker_node_t *node;
+static esp_rmaker_device_t *light, *fan, *sensor, *socket;
+static esp_rmaker_param_t *light_power, *brightness, *light_name, *fan_power, *speed, *temperature;
+
+/* Values of the last write request, as "Name=value;" per param */
+static char written[4096];
+
+static esp_err_t bulk_write_cb(const esp_rmaker_device_t *device, const esp_rmaker_param_write_req_t write_req[],
+        uint8_t count, void *priv_data, esp_rmaker_write_ctx_t *ctx) {
+    size_t n = 0;
+    written[0] = '\0';
+    for (uint8_t i = 0; i < count; i++) {
+        const esp_rmaker_param_val_t *val = &write_req[i].val;
+        const char *name = esp_rmaker_param_get_name(write_req[i].param);
+        if (val->type == RMAKER_VAL_TYPE_STRING) {
+            n += snprintf(written + n, sizeof(written) - n, "%s=%s;", name, val->val.s);
+        } else {
+            n += snprintf(written + n, sizeof(written) - n, "%s=%d;", name, val->val.i);
+        }
+        esp_rmaker_param_update(write_req[i].param, *val);
+        if (n >= sizeof(written)) break;
+    }
+    return ESP_OK;
+}
+
+static esp_rmaker_param_t *add_param(esp_rmaker_device_t *device, const char *name, const char *type,
+        esp_rmaker_param_val_t val) {
+    esp_rmaker_param_t *param = esp_rmaker_param_create(name, type, val, PROP_FLAG_READ | PROP_FLAG_WRITE);
+    CHECK(param && esp_rmaker_device_add_param(device, param) == ESP_OK);
+    return param;
+}
+
+static esp_rmaker_device_t *add_device(const char *name) {
+    esp_rmaker_device_t *device = esp_rmaker_device_create(name, NULL, NULL);
+    CHECK(device && esp_rmaker_device_add_bulk_cb(device, bulk_write_cb, NULL) == ESP_OK);
+    return device;
+}
+
+static void build_node(void) {
+    node = esp_rmaker_node_create("Core test", "Test");
+    CHECK(node);
+    core_test_set_node(node);
+    light = add_device("Light");
+    light_power = add_param(light, "Power", ESP_RMAKER_PARAM_POWER, esp_rmaker_bool(false));
+    brightness = add_param(light, "Brightness", ESP_RMAKER_PARAM_BRIGHTNESS, esp_rmaker_int(50));
+    light_name = add_param(light, "Name", ESP_RMAKER_PARAM_NAME, esp_rmaker_str("Light"));
+    fan = add_device("Fan");
+    fan_power = add_param(fan, "Power", ESP_RMAKER_PARAM_POWER, esp_rmaker_bool(false));
+    speed = add_param(fan, "Speed", ESP_RMAKER_PARAM_SPEED, esp_rmaker_int(1));
+    sensor = add_device("Sensor");
+    temperature = add_param(sensor, "Temperature", ESP_RMAKER_PARAM_TEMPERATURE, esp_rmaker_float(20));
+    socket = add_device("Socket");
+    add_param(socket, "Power", ESP_RMAKER_PARAM_POWER, esp_rmaker_bool(false));
+    CHECK(esp_rmaker_node_add_device(node, light) == ESP_OK);
+    CHECK(esp_rmaker_node_add_device(node, socket) == ESP_OK);
+    CHECK(esp_rmaker_node_add_device(node, fan) == ESP_OK);
+    CHECK(esp_rmaker_node_add_device(node, sensor) == ESP_OK);
+}
+
+static bool published(size_t i, const char *topic_suffix, const char *fragment) {
+    const char *topic = core_test_publish_topic(i);
+    size_t len = strlen(topic), suffix_len = strlen(topic_suffix);
+    return len >= suffix_len && strcmp(topic + len - suffix_len, topic_suffix) == 0 &&
+            strstr(core_test_publish_payload(i), fragment);
+}
+
+static void test_index(void) {
+    _esp_rmaker_node_t *_node = (_esp_rmaker_node_t *)node;
+    /* Before esp_rmaker_start() the lists are walked */
+    CHECK(!_node->index);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Fan") == fan);
+
+    CHECK(esp_rmaker_index_build(node, 0) == ESP_OK);
+    struct esp_rmaker_index *index = _node->index;
+    CHECK(index);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Light") == light);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Fan") == fan);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Lamp") == NULL);
+    /* Keys from a request are not terminated */
+    CHECK((esp_rmaker_device_t *)esp_rmaker_node_find_device(node, "Fanfare", 3) == fan);
+    CHECK(esp_rmaker_node_find_device(node, "Fa", 2) == NULL);
+    CHECK(esp_rmaker_device_get_param_by_name(light, "Brightness") == brightness);
+    CHECK(esp_rmaker_device_get_param_by_name(fan, "Brightness") == NULL);
+    CHECK(esp_rmaker_device_get_param_by_type(fan, ESP_RMAKER_PARAM_POWER) == fan_power);
+    CHECK(esp_rmaker_device_get_param_by_type(light, ESP_RMAKER_PARAM_POWER) == light_power);
+
+    /* Removed: its entries stay in the table but no longer match, and the others still do */
+    CHECK(esp_rmaker_node_remove_device(node, socket) == ESP_OK);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Socket") == NULL);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Fan") == fan);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Sensor") == sensor);
+    CHECK(esp_rmaker_device_get_param_by_type(light, ESP_RMAKER_PARAM_POWER) == light_power);
+    CHECK(esp_rmaker_device_get_param_by_name(fan, "Power") == fan_power);
+    CHECK(_node->index == index);
+
+    /* Added after the build: found in the lists, and the table stays as it is */
+    esp_rmaker_device_t *heater = add_device("Heater");
+    CHECK(esp_rmaker_node_add_device(node, heater) == ESP_OK);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Heater") == heater);
+    esp_rmaker_param_t *mode = add_param(fan, "Mode", ESP_RMAKER_PARAM_MODE, esp_rmaker_int(0));
+    CHECK(esp_rmaker_device_get_param_by_name(fan, "Mode") == mode);
+    CHECK(esp_rmaker_device_get_param_by_type(fan, ESP_RMAKER_PARAM_MODE) == mode);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Sensor") == sensor);
+    CHECK(_node->index == index);
+    CHECK(esp_rmaker_node_remove_device(node, heater) == ESP_OK);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Heater") == NULL);
+    esp_rmaker_device_delete(heater);
+
+    /* A new device by the name of a removed one is found, not the old one */
+    esp_rmaker_device_t *new_socket = add_device("Socket");
+    CHECK(esp_rmaker_node_add_device(node, new_socket) == ESP_OK);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Socket") == new_socket);
+    CHECK(esp_rmaker_node_remove_device(node, new_socket) == ESP_OK);
+    esp_rmaker_device_delete(new_socket);
+    esp_rmaker_device_delete(socket);
+
+    /* A second build does not replace the table that lookups may be using */
+    CHECK(esp_rmaker_index_build(node, 0) == ESP_OK);
+    CHECK(_node->index == index);
+    CHECK(esp_rmaker_node_get_device_by_name(node, "Light") == light);
+}
+
+static void test_reports(void) {
+    core_test_set_started(true);
+    CHECK(esp_rmaker_params_mqtt_init() == ESP_OK);
+    /* The initial report carries every param */
+    CHECK(core_test_publish_count() == 1);
+    CHECK(published(0, "params/local/init", "\"Light\":{\"Power\":false,\"Brightness\":50"));
+    CHECK(published(0, "params/local/init", "\"Sensor\":{\"Temperature\":20"));
+    core_test_clear_publishes();
+
+    /* Two changes in one window go out in one report with only those params */
+    CHECK(esp_rmaker_param_update_and_report(brightness, esp_rmaker_int(10)) == ESP_OK);
+    CHECK(esp_rmaker_param_update_and_report(speed, esp_rmaker_int(3)) == ESP_OK);
+    CHECK(core_test_publish_count() == 0);
+    CHECK(core_test_fire_timers() == 1);
+    CHECK(core_test_run_work() == 1);
+    CHECK(core_test_publish_count() == 1);
+    CHECK(published(0, "params/local", "\"Light\":{\"Brightness\":10}"));
+    CHECK(published(0, "params/local", "\"Fan\":{\"Speed\":3}"));
+    CHECK(!strstr(core_test_publish_payload(0), "Power"));
+    CHECK(!strstr(core_test_publish_payload(0), "Sensor"));
+    core_test_clear_publishes();
+
+    /* Nothing changed since, so nothing to report or to wait for */
+    CHECK(core_test_fire_timers() == 0);
+    CHECK(core_test_run_work() == 0);
+    CHECK(core_test_publish_count() == 0);
+
+    /* A param changed twice in a window is reported once, with its last value */
+    esp_rmaker_param_update_and_report(brightness, esp_rmaker_int(20));
+    esp_rmaker_param_update_and_report(brightness, esp_rmaker_int(30));
+    core_test_fire_timers();
+    core_test_run_work();
+    CHECK(core_test_publish_count() == 1);
+    CHECK(published(0, "params/local", "{\"Light\":{\"Brightness\":30}}"));
+    core_test_clear_publishes();
+
+    /* An immediate param goes out at once, along with what was waiting for the window */
+    CHECK(esp_rmaker_param_add_report_immediate(light_power) == ESP_OK);
+    esp_rmaker_param_update_and_report(brightness, esp_rmaker_int(40));
+    CHECK(core_test_publish_count() == 0);
+    esp_rmaker_param_update_and_report(light_power, esp_rmaker_bool(true));
+    CHECK(core_test_publish_count() == 1);
+    CHECK(published(0, "params/local", "\"Power\":true"));
+    CHECK(published(0, "params/local", "\"Brightness\":40"));
+    /* The window still ends, with nothing left to report */
+    core_test_fire_timers();
+    core_test_run_work();
+    CHECK(core_test_publish_count() == 1);
+    core_test_clear_publishes();
+
+    /* A batch commits as one report */
+    CHECK(esp_rmaker_param_batch_begin() == ESP_OK);
+    esp_rmaker_param_update_and_report(speed, esp_rmaker_int(4));
+    esp_rmaker_param_update_and_report(fan_power, esp_rmaker_bool(true));
+    CHECK(esp_rmaker_param_batch_commit() == ESP_OK);
+    core_test_fire_timers();
+    core_test_run_work();
+    CHECK(core_test_publish_count() == 1);
+    CHECK(published(0, "params/local", "\"Power\":true"));
+    CHECK(published(0, "params/local", "\"Speed\":4"));
+    CHECK(!strstr(core_test_publish_payload(0), "Light"));
+    core_test_clear_publishes();
+
+    /* Notifications have no window by default */
+    esp_rmaker_param_update_and_notify(temperature, esp_rmaker_float(45));
+    CHECK(core_test_publish_count() == 1);
+    CHECK(published(0, "alert", "\"Sensor\":{\"Temperature\":45"));
+    core_test_fire_timers();
+    core_test_run_work();
+    core_test_clear_publishes();
+}
+
+static void set_params(const char *request) {
+    char *data = strdup(request);
+    CHECK(esp_rmaker_handle_set_params(data, strlen(data), ESP_RMAKER_REQ_SRC_CLOUD) == ESP_OK);
+    free(data);
+}
+
+static void test_set_params(void) {
+    set_params("{\"Light\":{\"Brightness\":5,\"Name\":\"Desk\"},\"Lamp\":{\"Power\":true}}");
+    CHECK(strcmp(written, "Brightness=5;Name=Desk;") == 0);
+    /* Applied by the callback, then reported right away */
+    CHECK(core_test_publish_count() == 1);
+    CHECK(published(0, "params/local", "\"Brightness\":5"));
+    CHECK(published(0, "params/local", "\"Name\":\"Desk\""));
+    CHECK(!strstr(core_test_publish_payload(0), "Power"));
+    core_test_clear_publishes();
+
+    /* Unknown and repeated keys are skipped, the first of the repeated ones counts */
+    set_params("{\"Light\":{\"Colour\":1,\"Brightness\":6,\"Brightness\":7}}");
+    CHECK(strcmp(written, "Brightness=6;") == 0);
+    core_test_clear_publishes();
+    /* Even when the first has a value of the wrong type */
+    set_params("{\"Light\":{\"Brightness\":\"6\",\"Brightness\":7,\"Name\":\"Hall\"}}");
+    CHECK(strcmp(written, "Name=Hall;") == 0);
+    core_test_clear_publishes();
+
+    /* The arena is allocated by the first request and reused by every one after it */
+    uint32_t allocs = esp_rmaker_param_get_write_heap_allocs();
+    for (int i = 0; i < 100; i++) {
+        char request[128];
+        snprintf(request, sizeof(request), "{\"Light\":{\"Brightness\":%d,\"Name\":\"Room %d\"},"
+                "\"Fan\":{\"Speed\":%d}}", i, i, i % 5);
+        set_params(request);
+        core_test_clear_publishes();
+    }
+    CHECK(strcmp(written, "Speed=4;") == 0);
+    CHECK(esp_rmaker_param_get_write_heap_allocs() == allocs);
+
+    /* A request larger than the arena grows it once */
+    size_t name_len = CONFIG_ESP_RMAKER_MAX_PARAM_DATA_SIZE * 2;
+    char *request = malloc(name_len + 64);
+    int n = snprintf(request, name_len + 64, "{\"Light\":{\"Name\":\"");
+    memset(request + n, 'x', name_len);
+    strcpy(request + n + name_len, "\"}}");
+    set_params(request);
+    CHECK(strlen(written) == strlen("Name=;") + name_len);
+    CHECK(esp_rmaker_param_get_write_heap_allocs() == allocs + 1);
+    set_params(request);
+    set_params("{\"Light\":{\"Brightness\":8}}");
+    CHECK(esp_rmaker_param_get_write_heap_allocs() == allocs + 1);
+    free(request);
+    core_test_clear_publishes();
+}
+
+static void test_json_buf(void) {
+    /* The Name set above is twice the initial params buffer */
+    char *params = esp_rmaker_get_node_params();
+    CHECK(params);
+    size_t len = params ? strlen(params) : 0;
+    CHECK(len > CONFIG_ESP_RMAKER_MAX_PARAM_DATA_SIZE * 2);
+    CHECK(params && strncmp(params, "{\"Light\":{\"Power\":true,", 23) == 0);
+    CHECK(params && strcmp(params + len - 2, "}}") == 0);
+    CHECK(esp_rmaker_report_node_state() == ESP_OK);
+    CHECK(core_test_publish_count() == 1);
+    CHECK(params && strcmp(core_test_publish_payload(0), params) == 0);
+    free(params);
+    core_test_clear_publishes();
+}
+
+int main(void) {
+    build_node();
+    test_index();
+    test_reports();
+    test_set_params();
+    test_json_buf();
+    CHECK(core_test_critical_depth() == 0);
+    printf("%s: %d failed checks\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
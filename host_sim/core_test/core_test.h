@@ -0,0 +1,23 @@
+/* core_test.h - Controls of the platform stand-ins that core_test.c runs the RainMaker core on */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_rmaker_core.h"
+
+/* What esp_rmaker_get_node() and esp_rmaker_get_state() return */
+void core_test_set_node(const esp_rmaker_node_t *node);
+void core_test_set_started(bool started);
+
+/* Fires every running software timer, as if all their periods had passed; returns how many fired */
+int core_test_fire_timers(void);
+/* Runs the work queued with esp_rmaker_work_queue_add_task(); returns how many items ran */
+int core_test_run_work(void);
+
+/* MQTT publishes since the last core_test_clear_publishes(), oldest first */
+size_t core_test_publish_count(void);
+const char *core_test_publish_topic(size_t i);
+const char *core_test_publish_payload(size_t i);
+void core_test_clear_publishes(void);
+
+/* Depth of the critical sections entered and not left yet */
+int core_test_critical_depth(void);
@@ -0,0 +1,2 @@
+/* esp_efuse.h - Included by the secure boot digest header; no eFuses on the host */
+#pragma once
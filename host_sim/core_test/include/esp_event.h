@@ -0,0 +1,8 @@
+/* esp_event.h - The simulation's declarations plus esp_event_post(), which the core's
+ * internal header calls; the core test posts no events */
+#pragma once
+#include_next <esp_event.h>
+#include "freertos/FreeRTOS.h"
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data,
+                         size_t event_data_size, TickType_t ticks_to_wait);
@@ -0,0 +1,3 @@
+/* esp_rmaker_cmd_resp.h - Included by the core's internal header; nothing of it is used by the core test */
+#pragma once
+#include "esp_err.h"
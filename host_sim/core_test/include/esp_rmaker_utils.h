@@ -0,0 +1,6 @@
+/* esp_rmaker_utils.h - The simulation's subset of the rmaker_common utilities plus the time
+ * sync call that the core makes */
+#pragma once
+#include_next <esp_rmaker_utils.h>
+
+esp_err_t esp_rmaker_time_sync_init(void *config);
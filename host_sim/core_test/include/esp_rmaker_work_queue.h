@@ -0,0 +1,7 @@
+/* esp_rmaker_work_queue.h - RainMaker work queue; the core test runs the queued work by hand */
+#pragma once
+#include "esp_err.h"
+
+typedef void (*esp_rmaker_work_fn_t)(void *priv_data);
+
+esp_err_t esp_rmaker_work_queue_add_task(esp_rmaker_work_fn_t work_fn, void *priv_data);
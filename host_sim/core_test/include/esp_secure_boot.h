@@ -0,0 +1,5 @@
+/* esp_secure_boot.h - Secure boot is never enabled on the host */
+#pragma once
+#include <stdbool.h>
+
+bool esp_secure_boot_enabled(void);
@@ -0,0 +1,38 @@
+/* json_generator.h - The API of the espressif/json_generator component, implemented in
+ * core_stubs.c with the same buffering: output goes into buf and every time it fills up
+ * it is handed to flush_cb. With no buf only the length is counted. Only the calls that
+ * the core makes are there. */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef void (*json_gen_flush_cb_t)(char *buf, void *priv);
+
+typedef struct {
+    char *buf;
+    int buf_size;
+    json_gen_flush_cb_t flush_cb;
+    void *priv;
+    char *free_ptr;
+    bool comma_req;
+    char *start;
+    int total_len;
+} json_gen_str_t;
+
+void json_gen_str_start(json_gen_str_t *jstr, char *buf, int buf_size, json_gen_flush_cb_t flush_cb, void *priv);
+/* Returns the length of the whole document, including the terminator */
+int json_gen_str_end(json_gen_str_t *jstr);
+int json_gen_start_object(json_gen_str_t *jstr);
+int json_gen_end_object(json_gen_str_t *jstr);
+int json_gen_push_object(json_gen_str_t *jstr, const char *name);
+int json_gen_pop_object(json_gen_str_t *jstr);
+int json_gen_push_object_str(json_gen_str_t *jstr, const char *name, const char *object_str);
+int json_gen_push_array(json_gen_str_t *jstr, const char *name);
+int json_gen_pop_array(json_gen_str_t *jstr);
+int json_gen_push_array_str(json_gen_str_t *jstr, const char *name, const char *array_str);
+int json_gen_obj_set_bool(json_gen_str_t *jstr, const char *name, bool val);
+int json_gen_obj_set_int(json_gen_str_t *jstr, const char *name, int val);
+int json_gen_obj_set_float(json_gen_str_t *jstr, const char *name, float val);
+int json_gen_obj_set_string(json_gen_str_t *jstr, const char *name, const char *val);
+int json_gen_obj_set_null(json_gen_str_t *jstr, const char *name);
+int json_gen_arr_set_string(json_gen_str_t *jstr, const char *val);
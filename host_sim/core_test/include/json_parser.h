@@ -0,0 +1,45 @@
+/* json_parser.h - The API of the espressif/json_parser component, implemented in
+ * core_stubs.c. Tokens are laid out as by jsmn with parent links, which the core walks
+ * directly when it goes through the keys of an object. */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    JSMN_UNDEFINED = 0,
+    JSMN_OBJECT = 1,
+    JSMN_ARRAY = 2,
+    JSMN_STRING = 3,
+    JSMN_PRIMITIVE = 4,
+} jsmntype_t;
+
+typedef struct {
+    jsmntype_t type;
+    int start;
+    int end;
+    int size;
+    int parent;
+} jsmntok_t;
+
+typedef jsmntok_t json_tok_t;
+
+typedef struct {
+    json_tok_t *cur;
+    int num_tokens;
+    json_tok_t *tokens;
+    const char *js;
+} jparse_ctx_t;
+
+int json_parse_start(jparse_ctx_t *jctx, const char *js, int len);
+int json_parse_end(jparse_ctx_t *jctx);
+/* The getters look up name among the keys of jctx->cur and return 0 if it is there with a
+ * value of the right type */
+int json_obj_get_bool(jparse_ctx_t *jctx, const char *name, bool *val);
+int json_obj_get_int(jparse_ctx_t *jctx, const char *name, int *val);
+int json_obj_get_float(jparse_ctx_t *jctx, const char *name, float *val);
+int json_obj_get_string(jparse_ctx_t *jctx, const char *name, char *val, int size);
+int json_obj_get_strlen(jparse_ctx_t *jctx, const char *name, int *strlen);
+int json_obj_get_object_str(jparse_ctx_t *jctx, const char *name, char *val, int size);
+int json_obj_get_object_strlen(jparse_ctx_t *jctx, const char *name, int *strlen);
+int json_obj_get_array_str(jparse_ctx_t *jctx, const char *name, char *val, int size);
+int json_obj_get_array_strlen(jparse_ctx_t *jctx, const char *name, int *strlen);
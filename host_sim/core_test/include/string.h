@@ -0,0 +1,8 @@
+/* string.h - The host C library's, plus strlcpy(), which newlib has and glibc only has from 2.38 */
+#pragma once
+#include_next <string.h>
+
+#if defined(__GLIBC__) && !(__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 38))
+#define CORE_TEST_STRLCPY 1
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
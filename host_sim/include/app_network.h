@@ -0,0 +1,12 @@
+/* app_network.h - Provisioning stand-in; the simulated node is always online */
+#pragma once
+#include "esp_err.h"
+
+typedef enum {
+    POP_TYPE_NONE,
+    POP_TYPE_MAC,
+    POP_TYPE_RANDOM,
+} app_network_pop_type_t;
+
+void app_network_init(void);
+esp_err_t app_network_start(app_network_pop_type_t pop_type);
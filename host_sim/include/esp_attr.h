@@ -0,0 +1,6 @@
+/* esp_attr.h - Placement attributes have no meaning on the host */
+#pragma once
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define EXT_RAM_BSS_ATTR
@@ -0,0 +1,16 @@
+/* esp_rmaker_mqtt_glue.h - Just enough of the rmaker_common MQTT types for esp_rmaker_mqtt.h */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+#define RMAKER_MQTT_QOS0    0
+#define RMAKER_MQTT_QOS1    1
+
+/* Only ever handled by pointer in the simulation */
+typedef struct esp_rmaker_mqtt_conn_params esp_rmaker_mqtt_conn_params_t;
+
+typedef void (*esp_rmaker_mqtt_subscribe_cb_t)(const char *topic, void *payload, size_t payload_len, void *priv_data);
+
+typedef struct {
+    bool setup_done;
+} esp_rmaker_mqtt_config_t;
@@ -0,0 +1,11 @@
+/* esp_rmaker_utils.h - Subset of the rmaker_common utilities used by the application */
+#pragma once
+#include <stdlib.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define MEM_ALLOC_EXTRAM(size)          malloc(size)
+#define MEM_CALLOC_EXTRAM(num, size)    calloc(num, size)
+#define MEM_REALLOC_EXTRAM(ptr, size)   realloc(ptr, size)
+
+bool esp_rmaker_time_check(void);
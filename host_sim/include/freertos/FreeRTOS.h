@@ -0,0 +1,45 @@
+/* FreeRTOS.h - Host simulation of the FreeRTOS kernel on POSIX threads.
+ * Tasks are threads, ticks are 1 ms of simulated time and critical sections take one
+ * recursive lock shared with the simulated interrupts. Priorities are not modelled. */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+#define errQUEUE_FULL           0
+#define errQUEUE_EMPTY          0
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ      CONFIG_FREERTOS_HZ
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES
+#define portTICK_PERIOD_MS      ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((uint64_t)(xTimeInMs) * configTICK_RATE_HZ) / 1000U))
+#define pdTICKS_TO_MS(xTicks)   ((uint32_t)(((uint64_t)(xTicks) * 1000U) / configTICK_RATE_HZ))
+#define configASSERT(x)         do { if (!(x)) abort(); } while (0)
+
+typedef struct {
+    int owner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+#define portMUX_INITIALIZE(mux)         ((mux)->owner = 0)
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+#define portENTER_CRITICAL(mux)         vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)          vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)      vPortExitCritical(mux)
+#define portENTER_CRITICAL_SAFE(mux)    vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_SAFE(mux)     vPortExitCritical(mux)
+#define portYIELD_FROM_ISR(woken)       ((void)(woken))
+
+#include <stdlib.h>
@@ -0,0 +1,19 @@
+/* nvs.h - Key-value API of the NVS library, backed by memory in the simulation */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value);
+/* With out_value NULL only the length, including the terminator, is returned */
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length);
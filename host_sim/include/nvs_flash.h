@@ -0,0 +1,6 @@
+/* nvs_flash.h - The simulated NVS partition lives in memory; see src/sim_nvs.c */
+#pragma once
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
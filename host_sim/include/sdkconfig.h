@@ -0,0 +1,10 @@
+/* sdkconfig.h - Configuration of the host simulation build */
+#pragma once
+#define CONFIG_IDF_TARGET                       "linux"
+#define CONFIG_IDF_TARGET_LINUX                 1
+#define CONFIG_FREERTOS_HZ                      1000
+#define CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES 2
+#define CONFIG_ESP_RMAKER_MAX_PARAM_DATA_SIZE   1024
+#define CONFIG_ESP_RMAKER_PARAM_REPORT_COALESCE_MS 50
+#define CONFIG_ESP_RMAKER_PARAM_NOTIFY_COALESCE_MS 0
+#define CONFIG_APP_LATENCY_BUDGET_MS            250
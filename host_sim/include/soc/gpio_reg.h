@@ -0,0 +1,13 @@
+/* gpio_reg.h - GPIO output registers of the ESP32-C3, routed to the simulated GPIO matrix */
+#pragma once
+#include <stdint.h>
+
+#define DR_REG_GPIO_BASE        0x60004000
+#define GPIO_OUT_REG            (DR_REG_GPIO_BASE + 0x0004)
+#define GPIO_OUT_W1TS_REG       (DR_REG_GPIO_BASE + 0x0008)
+#define GPIO_OUT_W1TC_REG       (DR_REG_GPIO_BASE + 0x000c)
+
+void sim_reg_write(uint32_t reg, uint32_t val);
+uint32_t sim_reg_read(uint32_t reg);
+#define REG_WRITE(reg, val)     sim_reg_write((uint32_t)(reg), (uint32_t)(val))
+#define REG_READ(reg)           sim_reg_read((uint32_t)(reg))
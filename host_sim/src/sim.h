@@ -0,0 +1,96 @@
+/* sim.h - Internal interfaces of the host simulation */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include "esp_rmaker_core.h"
+
+/* Pins the trace drives; they match DHT11_GPIO and BTN_EMERGENCY_GPIO in app_main.c */
+#define SIM_DHT_GPIO            2
+#define SIM_BUTTON_GPIO         10
+#define SIM_BUTTON_HOLD_US      200000
+
+/* --- Clock --- */
+/* Simulated time runs `speed` times faster than the host clock and starts at zero */
+void sim_clock_init(double speed);
+int64_t sim_now_us(void);
+/* Host time in microseconds, unaffected by the speed factor; used for latency figures */
+int64_t sim_wall_us(void);
+/* Absolute CLOCK_MONOTONIC deadline `delta_us` of simulated time from now */
+struct timespec sim_deadline(int64_t delta_us);
+void sim_sleep_until(int64_t sim_us);
+/* Pins esp_timer_get_time() of the calling thread to `sim_us`, for edges generated inside
+ * one simulated interrupt burst. A negative value releases it. */
+void sim_clock_pin(int64_t sim_us);
+
+/* Condition variables that wait on CLOCK_MONOTONIC */
+void sim_cond_init(pthread_cond_t *cond);
+/* Deadline `ticks` FreeRTOS ticks from now; portMAX_DELAY gives no deadline */
+typedef struct {
+    bool forever;
+    struct timespec at;
+} sim_deadline_t;
+sim_deadline_t sim_deadline_ticks(uint32_t ticks);
+/* Returns false once the deadline has passed */
+bool sim_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, const sim_deadline_t *deadline);
+
+/* --- Critical sections and simulated interrupts --- */
+/* Recursive; leaving the outermost section commits pending output register writes */
+void sim_critical_enter(void);
+void sim_critical_exit(void);
+
+/* --- GPIO --- */
+void sim_gpio_button(bool pressed);
+/* Corrupts the next DHT11 frame: "crc", "timeout" or "none" to clear */
+void sim_gpio_dht_fault(const char *fault);
+uint32_t sim_gpio_outputs(void);
+/* Publishes output register writes made since the last call; see sim_critical_exit() */
+void sim_gpio_commit(void);
+
+/* --- I2C --- */
+void sim_i2c_stats(uint32_t *transactions, uint32_t *bytes);
+
+/* --- Trace --- */
+esp_err_t sim_trace_load(const char *path);
+/* Linearly interpolated temperature and humidity at simulated time `sim_us` */
+void sim_trace_sample(int64_t sim_us, float *temp, float *hum);
+/* Replays the trace events in real time; returns the number of failed expectations */
+int sim_trace_run(void);
+
+/* --- RainMaker stand-in --- */
+/* Applies a cloud write the way esp_rmaker_device_set_params() does */
+esp_err_t sim_rmaker_write(const char *device, const char *param, const char *value);
+/* Compares the last value published for device/param with `value` */
+bool sim_rmaker_expect(const char *device, const char *param, const char *value);
+void sim_rmaker_stats(uint32_t *publishes, uint32_t *alerts, uint32_t *bytes);
+/* Time-series publishes, which bypass the params report, and the records they carried */
+void sim_rmaker_ts_stats(uint32_t *publishes, uint32_t *records, uint32_t *bytes);
+/* Publishes lost to a disconnected MQTT link or an exhausted MQTT budget */
+uint32_t sim_rmaker_dropped(void);
+/* Takes the MQTT link down or brings it back */
+void sim_rmaker_mqtt(bool connected);
+/* The MQTT budget follows the simulated clock; benchmarks that do not advance it turn it off */
+void sim_rmaker_budget_enable(bool enable);
+/* Runs a command registered with esp_console_cmd_register(); argv[0] is its name */
+int sim_console_run(int argc, char **argv);
+
+/* --- Flash --- */
+void sim_flash_stats(uint32_t *erases, uint32_t *bytes_written);
+
+/* --- Benchmarks --- */
+/* Runs the zone scaling benchmark for 1, 2, 4, ... max_zones zones; returns the exit code */
+int sim_bench_zones(size_t max_zones);
+
+/* --- Latency bookkeeping --- */
+typedef enum {
+    SIM_STIMULUS_SENSOR,        /* DHT11 frame decoded */
+    SIM_STIMULUS_BUTTON,        /* Emergency button pressed */
+    SIM_STIMULUS_CLOUD,         /* Cloud write delivered */
+    SIM_STIMULUS_MAX,
+} sim_stimulus_t;
+
+/* Remembers the stimulus that the next output change will be attributed to */
+void sim_stimulus(sim_stimulus_t kind);
+/* Prints stimulus-to-output latencies in host microseconds */
+void sim_gpio_report(void);
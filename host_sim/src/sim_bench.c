@@ -0,0 +1,122 @@
+/* sim_bench.c - Zone scaling benchmark.
+ *
+ * Builds 1, 2, 4, ... zones on the RainMaker stand-in, each with two sensors and no local
+ * outputs, and replays an hour of samples through app_zones_sample() and app_zones_tick()
+ * the way the controller task does. Every zone count runs in a child process so that the
+ * heap figure starts from a clean process. Loop times are host times: they show how the
+ * tick scales with the zone count, not what it costs on the ESP32-C3. */
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "app_control.h"
+#include "app_zone.h"
+#include "app_rules.h"
+#include "nvs_flash.h"
+#include "sim.h"
+
+#define BENCH_SENSORS_PER_ZONE  2
+#define BENCH_TICKS             360         /* One hour of 10 s samples */
+#define BENCH_TICK_US           10000000LL
+#define BENCH_SETTLE_US         200         /* Host time left to the control task between ticks */
+#define BENCH_RULES             "temp>=27/1:ac; maxtemp>=30/1:emergency; rise>=8/7:emergency"
+
+static int cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Every fourth zone runs through a fire and back; the others idle around 25 C */
+static float bench_temp(size_t zone, size_t sensor, int tick) {
+    float noise = (float)((tick * 7 + zone * 3 + sensor) % 5) * 0.1f;
+    if (zone % 4) return 25.0f + noise;
+    int t = tick % 120;
+    float base = t < 60 ? 24.0f + t * 0.15f : 33.0f - (t - 60) * 0.15f;
+    return base + noise;
+}
+
+static size_t heap_in_use(void) {
+    return mallinfo2().uordblks;
+}
+
+static void bench_run(size_t count) {
+    static char names[APP_ZONE_MAX][16];
+    static app_zone_config_t cfg[APP_ZONE_MAX];
+    static int64_t tick_us[BENCH_TICKS];
+
+    sim_clock_init(1.0);
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    for (size_t i = 0; i < count; i++) {
+        snprintf(names[i], sizeof(names[i]), "Zone %u", (unsigned)(i + 1));
+        cfg[i] = (app_zone_config_t){
+            .name = names[i],
+            .first_sensor = (uint8_t)(i * BENCH_SENSORS_PER_ZONE),
+            .sensor_count = BENCH_SENSORS_PER_ZONE,
+            .stale_ms = 30000,
+        };
+    }
+
+    /* Ticks come faster than the simulated clock that revives the budget */
+    sim_rmaker_budget_enable(false);
+    esp_rmaker_config_t rmaker_cfg = { 0 };
+    esp_rmaker_node_t *node = esp_rmaker_node_init(&rmaker_cfg, "Bench", "Bench");
+    size_t heap_before = heap_in_use();
+    if (app_zones_create(node, cfg, count, NULL) != ESP_OK) exit(1);
+    size_t heap_zones = heap_in_use() - heap_before;
+    nvs_flash_init();
+    if (app_rules_init(node, count, BENCH_RULES) != ESP_OK) exit(1);
+    if (app_control_start() != ESP_OK) exit(1);
+    esp_rmaker_start();
+
+    for (int t = 0; t < BENCH_TICKS; t++) {
+        int64_t now_us = (t + 1) * BENCH_TICK_US;
+        int64_t start = sim_wall_us();
+        for (size_t z = 0; z < count; z++) {
+            for (size_t s = 0; s < BENCH_SENSORS_PER_ZONE; s++) {
+                sensor_sample_t sample = {
+                    .temp = bench_temp(z, s, t), .hum = 45.0f, .timestamp_us = now_us,
+                    .sensor = (uint8_t)(z * BENCH_SENSORS_PER_ZONE + s),
+                };
+                app_zones_sample(&sample);
+            }
+        }
+        app_zones_tick(now_us);
+        tick_us[t] = sim_wall_us() - start;
+        usleep(BENCH_SETTLE_US);
+    }
+
+    int64_t sum = 0;
+    for (int t = 0; t < BENCH_TICKS; t++) sum += tick_us[t];
+    qsort(tick_us, BENCH_TICKS, sizeof(tick_us[0]), cmp_i64);
+    uint32_t publishes, alerts, bytes;
+    sim_rmaker_stats(&publishes, &alerts, &bytes);
+    printf("%5u %11u %10u %9.1f %8lld %8lld %10lu %7lu\n", (unsigned)count, (unsigned)heap_zones,
+           (unsigned)(heap_zones / count), (double)sum / BENCH_TICKS, (long long)tick_us[BENCH_TICKS * 99 / 100],
+           (long long)tick_us[BENCH_TICKS - 1], (unsigned long)publishes, (unsigned long)alerts);
+    fflush(stdout);
+    exit(0);
+}
+
+int sim_bench_zones(size_t max_zones) {
+    if (max_zones < 1 || max_zones > APP_ZONE_MAX) {
+        fprintf(stderr, "Zone count must be 1..%d\n", APP_ZONE_MAX);
+        return 2;
+    }
+    printf("Zone benchmark: %d ticks, %d sensors per zone\n", BENCH_TICKS, BENCH_SENSORS_PER_ZONE);
+    printf("zones  heap_bytes  per_zone  tick_mean_us  p99_us  max_us  publishes  alerts\n");
+    fflush(stdout);
+    for (size_t n = 1;; n = n * 2 < max_zones ? n * 2 : max_zones) {
+        pid_t pid = fork();
+        if (pid < 0) return 1;
+        if (pid == 0) bench_run(n);
+        int status;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            fprintf(stderr, "Benchmark with %u zones failed\n", (unsigned)n);
+            return 1;
+        }
+        if (n == max_zones) break;
+    }
+    return 0;
+}
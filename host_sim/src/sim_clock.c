@@ -0,0 +1,135 @@
+/* sim_clock.c - Simulated clock, critical sections and logging */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "sim.h"
+
+static struct timespec clock_start;
+static double clock_speed = 1.0;
+static __thread int64_t clock_pinned_us = -1;
+static pthread_mutex_t critical_lock;
+static __thread int critical_depth;
+static esp_log_level_t log_level = ESP_LOG_INFO;
+
+static int64_t timespec_us(const struct timespec *ts) {
+    return (int64_t)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+void sim_clock_init(double speed) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    clock_speed = speed > 0 ? speed : 1.0;
+    clock_gettime(CLOCK_MONOTONIC, &clock_start);
+}
+
+int64_t sim_wall_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespec_us(&now) - timespec_us(&clock_start);
+}
+
+int64_t sim_now_us(void) {
+    if (clock_pinned_us >= 0) return clock_pinned_us;
+    return (int64_t)((double)sim_wall_us() * clock_speed);
+}
+
+void sim_clock_pin(int64_t sim_us) {
+    clock_pinned_us = sim_us;
+}
+
+struct timespec sim_deadline(int64_t delta_us) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    if (delta_us < 0) delta_us = 0;
+    int64_t ns = ts.tv_nsec + (int64_t)((double)delta_us * 1000.0 / clock_speed);
+    ts.tv_sec += ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    return ts;
+}
+
+void sim_sleep_until(int64_t sim_us) {
+    struct timespec ts = sim_deadline(sim_us - sim_now_us());
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+void sim_cond_init(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+sim_deadline_t sim_deadline_ticks(uint32_t ticks) {
+    sim_deadline_t d = { .forever = (ticks == portMAX_DELAY) };
+    if (!d.forever) d.at = sim_deadline((int64_t)pdTICKS_TO_MS(ticks) * 1000);
+    return d;
+}
+
+bool sim_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, const sim_deadline_t *deadline) {
+    if (deadline->forever) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, &deadline->at) != ETIMEDOUT;
+}
+
+/* Every portMUX shares one lock, which also serialises the simulated interrupts */
+void sim_critical_enter(void) {
+    pthread_mutex_lock(&critical_lock);
+    critical_depth++;
+}
+
+/* Output register writes made inside the section become visible together */
+void sim_critical_exit(void) {
+    if (--critical_depth == 0) sim_gpio_commit();
+    pthread_mutex_unlock(&critical_lock);
+}
+
+int64_t esp_timer_get_time(void) {
+    return sim_now_us();
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    if (tag && strcmp(tag, "*") == 0) log_level = level;
+}
+
+void sim_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+    if (level > log_level) return;
+    char line[512];
+    int n = snprintf(line, sizeof(line), "%c (%lld) %s: ", letters[level], (long long)(sim_now_us() / 1000), tag);
+    va_list args;
+    va_start(args, format);
+    if (n >= 0 && n < (int)sizeof(line)) vsnprintf(line + n, sizeof(line) - n, format, args);
+    va_end(args);
+    /* One write per line keeps output from concurrent tasks readable */
+    fprintf(level <= ESP_LOG_WARN ? stderr : stdout, "%s\n", line);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_NOT_FINISHED: return "ESP_ERR_NOT_FINISHED";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    default: return "UNKNOWN ERROR";
+    }
+}
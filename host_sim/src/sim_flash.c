@@ -0,0 +1,77 @@
+/* sim_flash.c - The history data partition, in memory and lost when the process exits.
+ * Writes AND into the existing contents and only an erase sets bits again, as on the NOR
+ * flash of the ESP32-C3, so code that relies on clearing bits in place is exercised. */
+#include <pthread.h>
+#include <string.h>
+#include "esp_partition.h"
+#include "sim.h"
+
+#define SIM_FLASH_SECTOR    4096
+#define SIM_FLASH_SIZE      0x1a000     /* Matches the history row of partitions.csv */
+
+static pthread_mutex_t flash_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t flash[SIM_FLASH_SIZE];
+static bool flash_blank;
+static uint32_t erase_count;
+static uint32_t write_bytes;
+
+static const esp_partition_t history = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = 0x40,
+    .address = 0x3e0000,
+    .size = SIM_FLASH_SIZE,
+    .erase_size = SIM_FLASH_SECTOR,
+    .label = "history",
+};
+
+static bool range_valid(const esp_partition_t *partition, size_t offset, size_t size) {
+    return partition == &history && offset <= SIM_FLASH_SIZE && size <= SIM_FLASH_SIZE - offset;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    if (type != history.type || subtype != history.subtype) return NULL;
+    if (label && strcmp(label, history.label) != 0) return NULL;
+    pthread_mutex_lock(&flash_lock);
+    if (!flash_blank) {
+        memset(flash, 0xff, sizeof(flash));
+        flash_blank = true;
+    }
+    pthread_mutex_unlock(&flash_lock);
+    return &history;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    if (!range_valid(partition, src_offset, size)) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&flash_lock);
+    memcpy(dst, flash + src_offset, size);
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+    if (!range_valid(partition, dst_offset, size)) return ESP_ERR_INVALID_ARG;
+    const uint8_t *bytes = src;
+    pthread_mutex_lock(&flash_lock);
+    for (size_t i = 0; i < size; i++) flash[dst_offset + i] &= bytes[i];
+    write_bytes += size;
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    if (!range_valid(partition, offset, size)) return ESP_ERR_INVALID_ARG;
+    if (offset % SIM_FLASH_SECTOR || size % SIM_FLASH_SECTOR) return ESP_ERR_INVALID_SIZE;
+    pthread_mutex_lock(&flash_lock);
+    memset(flash + offset, 0xff, size);
+    erase_count += size / SIM_FLASH_SECTOR;
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
+
+void sim_flash_stats(uint32_t *erases, uint32_t *bytes_written) {
+    pthread_mutex_lock(&flash_lock);
+    *erases = erase_count;
+    *bytes_written = write_bytes;
+    pthread_mutex_unlock(&flash_lock);
+}
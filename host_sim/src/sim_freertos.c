@@ -0,0 +1,311 @@
+/* sim_freertos.c - FreeRTOS tasks, notifications and queues on POSIX threads */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "sim.h"
+
+static const char *TAG = "sim_rtos";
+
+struct sim_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify[configTASK_NOTIFICATION_ARRAY_ENTRIES];
+    bool notify_pending[configTASK_NOTIFICATION_ARRAY_ENTRIES];
+};
+
+struct sim_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t can_send;
+    pthread_cond_t can_recv;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t *storage;
+};
+
+static struct sim_task main_task;
+static pthread_once_t main_task_once = PTHREAD_ONCE_INIT;
+static __thread struct sim_task *current_task;
+
+static void task_init(struct sim_task *t, const char *name) {
+    snprintf(t->name, sizeof(t->name), "%s", name ? name : "");
+    pthread_mutex_init(&t->lock, NULL);
+    sim_cond_init(&t->cond);
+}
+
+static void main_task_init(void) {
+    task_init(&main_task, "main");
+}
+
+static void *task_entry(void *param) {
+    struct sim_task *t = param;
+    current_task = t;
+    t->fn(t->arg);
+    ESP_LOGE(TAG, "Task %s returned; FreeRTOS tasks must delete themselves", t->name);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask) {
+    struct sim_task *t = calloc(1, sizeof(*t));
+    if (!t) return pdFAIL;
+    task_init(t, pcName);
+    t->fn = pxTaskCode;
+    t->arg = pvParameters;
+    /* The handle must be valid before the task can run and be notified */
+    if (pxCreatedTask) *pxCreatedTask = t;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&t->thread, &attr, task_entry, t);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        if (pxCreatedTask) *pxCreatedTask = NULL;
+        free(t);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+    if (xTaskToDelete == NULL || xTaskToDelete == current_task) pthread_exit(NULL);
+    ESP_LOGE(TAG, "Deleting another task is not supported");
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+    sim_sleep_until(sim_now_us() + (int64_t)pdTICKS_TO_MS(xTicksToDelay) * 1000);
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement) {
+    TickType_t wake = *pxPreviousWakeTime + xTimeIncrement;
+    TickType_t now = xTaskGetTickCount();
+    *pxPreviousWakeTime = wake;
+    if ((int32_t)(wake - now) <= 0) return pdFALSE;
+    sim_sleep_until((int64_t)pdTICKS_TO_MS(wake) * 1000);
+    return pdTRUE;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(sim_now_us() / (1000 * portTICK_PERIOD_MS));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    /* Threads not created through xTaskCreate() act as the main task */
+    if (!current_task) {
+        pthread_once(&main_task_once, main_task_init);
+        current_task = &main_task;
+    }
+    return current_task;
+}
+
+const char *pcTaskGetName(TaskHandle_t xTaskToQuery) {
+    TaskHandle_t t = xTaskToQuery ? xTaskToQuery : xTaskGetCurrentTaskHandle();
+    return t->name;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+    struct sim_task *t = xTaskGetCurrentTaskHandle();
+    sim_deadline_t deadline = sim_deadline_ticks(xTicksToWait);
+    pthread_mutex_lock(&t->lock);
+    while (t->notify[0] == 0) {
+        if (xTicksToWait == 0 || !sim_cond_wait(&t->cond, &t->lock, &deadline)) break;
+    }
+    uint32_t value = t->notify[0];
+    if (value) t->notify[0] = xClearCountOnExit ? 0 : value - 1;
+    t->notify_pending[0] = false;
+    pthread_mutex_unlock(&t->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+    return xTaskNotifyIndexed(xTaskToNotify, 0, 0, eIncrement);
+}
+
+BaseType_t xTaskNotifyIndexed(TaskHandle_t xTaskToNotify, UBaseType_t uxIndexToNotify, uint32_t ulValue,
+                              eNotifyAction eAction) {
+    configASSERT(uxIndexToNotify < configTASK_NOTIFICATION_ARRAY_ENTRIES);
+    BaseType_t ret = pdPASS;
+    pthread_mutex_lock(&xTaskToNotify->lock);
+    uint32_t *value = &xTaskToNotify->notify[uxIndexToNotify];
+    bool *pending = &xTaskToNotify->notify_pending[uxIndexToNotify];
+    switch (eAction) {
+    case eNoAction:
+        break;
+    case eSetBits:
+        *value |= ulValue;
+        break;
+    case eIncrement:
+        (*value)++;
+        break;
+    case eSetValueWithOverwrite:
+        *value = ulValue;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (*pending) ret = pdFAIL;
+        else *value = ulValue;
+        break;
+    }
+    if (ret == pdPASS) {
+        *pending = true;
+        pthread_cond_broadcast(&xTaskToNotify->cond);
+    }
+    pthread_mutex_unlock(&xTaskToNotify->lock);
+    return ret;
+}
+
+BaseType_t xTaskNotifyWaitIndexed(UBaseType_t uxIndexToWaitOn, uint32_t ulBitsToClearOnEntry,
+                                  uint32_t ulBitsToClearOnExit, uint32_t *pulNotificationValue,
+                                  TickType_t xTicksToWait) {
+    configASSERT(uxIndexToWaitOn < configTASK_NOTIFICATION_ARRAY_ENTRIES);
+    struct sim_task *t = xTaskGetCurrentTaskHandle();
+    sim_deadline_t deadline = sim_deadline_ticks(xTicksToWait);
+    pthread_mutex_lock(&t->lock);
+    uint32_t *value = &t->notify[uxIndexToWaitOn];
+    bool *pending = &t->notify_pending[uxIndexToWaitOn];
+    if (!*pending) *value &= ~ulBitsToClearOnEntry;
+    while (!*pending) {
+        if (xTicksToWait == 0 || !sim_cond_wait(&t->cond, &t->lock, &deadline)) break;
+    }
+    BaseType_t ret = *pending ? pdTRUE : pdFALSE;
+    if (pulNotificationValue) *pulNotificationValue = *value;
+    if (ret) *value &= ~ulBitsToClearOnExit;
+    *pending = false;
+    pthread_mutex_unlock(&t->lock);
+    return ret;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken) {
+    xTaskNotifyGive(xTaskToNotify);
+    if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdTRUE;
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+    (void)mux;
+    sim_critical_enter();
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+    (void)mux;
+    sim_critical_exit();
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize) {
+    if (uxQueueLength == 0) return NULL;
+    struct sim_queue *q = calloc(1, sizeof(*q));
+    if (!q) return NULL;
+    q->storage = calloc(uxQueueLength, uxItemSize ? uxItemSize : 1);
+    if (!q->storage) {
+        free(q);
+        return NULL;
+    }
+    q->length = uxQueueLength;
+    q->item_size = uxItemSize;
+    pthread_mutex_init(&q->lock, NULL);
+    sim_cond_init(&q->can_send);
+    sim_cond_init(&q->can_recv);
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t xQueue) {
+    if (!xQueue) return;
+    free(xQueue->storage);
+    free(xQueue);
+}
+
+static void queue_push(struct sim_queue *q, const void *item) {
+    UBaseType_t tail = (q->head + q->count) % q->length;
+    memcpy(q->storage + tail * q->item_size, item, q->item_size);
+    q->count++;
+    pthread_cond_signal(&q->can_recv);
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait) {
+    sim_deadline_t deadline = sim_deadline_ticks(xTicksToWait);
+    pthread_mutex_lock(&xQueue->lock);
+    while (xQueue->count == xQueue->length) {
+        if (xTicksToWait == 0 || !sim_cond_wait(&xQueue->can_send, &xQueue->lock, &deadline)) {
+            pthread_mutex_unlock(&xQueue->lock);
+            return errQUEUE_FULL;
+        }
+    }
+    queue_push(xQueue, pvItemToQueue);
+    pthread_mutex_unlock(&xQueue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue, BaseType_t *pxHigherPriorityTaskWoken) {
+    if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdFALSE;
+    return xQueueSend(xQueue, pvItemToQueue, 0);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue) {
+    pthread_mutex_lock(&xQueue->lock);
+    if (xQueue->count == xQueue->length) {
+        xQueue->head = (xQueue->head + 1) % xQueue->length;
+        xQueue->count--;
+    }
+    queue_push(xQueue, pvItemToQueue);
+    pthread_mutex_unlock(&xQueue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueOverwriteFromISR(QueueHandle_t xQueue, const void *pvItemToQueue, BaseType_t *pxHigherPriorityTaskWoken) {
+    if (pxHigherPriorityTaskWoken) *pxHigherPriorityTaskWoken = pdFALSE;
+    return xQueueOverwrite(xQueue, pvItemToQueue);
+}
+
+static BaseType_t queue_take(QueueHandle_t q, void *buffer, TickType_t ticks, bool remove) {
+    sim_deadline_t deadline = sim_deadline_ticks(ticks);
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0) {
+        if (ticks == 0 || !sim_cond_wait(&q->can_recv, &q->lock, &deadline)) {
+            pthread_mutex_unlock(&q->lock);
+            return errQUEUE_EMPTY;
+        }
+    }
+    memcpy(buffer, q->storage + q->head * q->item_size, q->item_size);
+    if (remove) {
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+        pthread_cond_signal(&q->can_send);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait) {
+    return queue_take(xQueue, pvBuffer, xTicksToWait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait) {
+    return queue_take(xQueue, pvBuffer, xTicksToWait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue) {
+    pthread_mutex_lock(&xQueue->lock);
+    xQueue->head = 0;
+    xQueue->count = 0;
+    pthread_cond_broadcast(&xQueue->can_send);
+    pthread_mutex_unlock(&xQueue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue) {
+    pthread_mutex_lock(&xQueue->lock);
+    UBaseType_t count = xQueue->count;
+    pthread_mutex_unlock(&xQueue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue) {
+    return xQueue->length - uxQueueMessagesWaiting(xQueue);
+}
@@ -0,0 +1,297 @@
+/* sim_gpio.c - Simulated GPIO matrix, DHT11 line model and emergency button */
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "driver/gpio.h"
+#include "soc/gpio_reg.h"
+#include "esp_log.h"
+#include "sim.h"
+
+static const char *TAG = "sim_gpio";
+
+#define DHT_START_MIN_US        18000   /* Shortest start pulse the sensor answers */
+#define DHT_RESPONSE_DELAY_US   30
+#define DHT_RESPONSE_US         80
+#define DHT_BIT_LOW_US          50
+#define DHT_BIT_ZERO_HIGH_US    27
+#define DHT_BIT_ONE_HIGH_US     70
+
+typedef enum {
+    DHT_FAULT_NONE,
+    DHT_FAULT_CRC,
+    DHT_FAULT_TIMEOUT,
+} dht_fault_t;
+
+typedef struct {
+    int level;
+    gpio_mode_t mode;
+    gpio_int_type_t intr_type;
+    bool intr_enabled;
+    gpio_isr_t isr;
+    void *isr_arg;
+} sim_pin_t;
+
+typedef struct {
+    uint32_t count;
+    int64_t min_us;
+    int64_t max_us;
+    int64_t total_us;
+} sim_latency_t;
+
+static sim_pin_t pins[GPIO_NUM_MAX];
+static uint32_t out_reg;            /* Output register as written */
+static uint32_t out_published;      /* Outputs as last reported by sim_gpio_commit() */
+static uint32_t output_mask;        /* Pins configured as push-pull outputs */
+static uint32_t transitions;
+
+static int64_t dht_low_since = -1;
+static bool dht_start_seen;
+static bool dht_frame_sent;
+static dht_fault_t dht_fault;
+
+static bool stimulus_pending;
+static sim_stimulus_t stimulus_kind;
+static int64_t stimulus_wall_us;
+static sim_latency_t latency[SIM_STIMULUS_MAX];
+static const char *const stimulus_names[SIM_STIMULUS_MAX] = { "sensor", "button", "cloud" };
+
+static bool pin_valid(gpio_num_t gpio_num) {
+    return gpio_num >= 0 && gpio_num < GPIO_NUM_MAX;
+}
+
+/* Runs the pin's handler as an interrupt would: nothing else holds the critical lock */
+static void pin_dispatch(sim_pin_t *p, int old_level) {
+    if (!p->isr || !p->intr_enabled) return;
+    bool rising = old_level == 0 && p->level == 1;
+    bool falling = old_level == 1 && p->level == 0;
+    switch (p->intr_type) {
+    case GPIO_INTR_POSEDGE: if (!rising) return; break;
+    case GPIO_INTR_NEGEDGE: if (!falling) return; break;
+    case GPIO_INTR_ANYEDGE: if (!rising && !falling) return; break;
+    default: return;
+    }
+    p->isr(p->isr_arg);
+}
+
+static void dht_emit(int level, int64_t t_us) {
+    sim_pin_t *p = &pins[SIM_DHT_GPIO];
+    int old = p->level;
+    p->level = level;
+    sim_clock_pin(t_us);
+    pin_dispatch(p, old);
+}
+
+/* Replays one 40-bit frame as the sensor would after its start pulse, each edge timestamped
+ * where it would fall on the wire */
+static void dht_send_frame(void) {
+    int64_t t = sim_now_us();
+    dht_frame_sent = true;
+    if (dht_fault == DHT_FAULT_TIMEOUT) {
+        dht_fault = DHT_FAULT_NONE;
+        return;
+    }
+    float temp, hum;
+    sim_trace_sample(t, &temp, &hum);
+    int t10 = (int)lroundf(fmaxf(temp, 0.0f) * 10.0f);
+    int h10 = (int)lroundf(fmaxf(hum, 0.0f) * 10.0f);
+    uint8_t data[5] = { h10 / 10, h10 % 10, t10 / 10, t10 % 10, 0 };
+    data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+    if (dht_fault == DHT_FAULT_CRC) data[4] ^= 0x5A;
+    dht_fault = DHT_FAULT_NONE;
+
+    t += DHT_RESPONSE_DELAY_US;
+    dht_emit(0, t);
+    dht_emit(1, t += DHT_RESPONSE_US);
+    dht_emit(0, t += DHT_RESPONSE_US);
+    for (int bit = 0; bit < 40; bit++) {
+        bool one = data[bit / 8] & (0x80 >> (bit % 8));
+        dht_emit(1, t += DHT_BIT_LOW_US);
+        dht_emit(0, t += one ? DHT_BIT_ONE_HIGH_US : DHT_BIT_ZERO_HIGH_US);
+    }
+    dht_emit(1, t += DHT_BIT_LOW_US);
+    sim_clock_pin(-1);
+}
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig) {
+    if (!pGPIOConfig) return ESP_ERR_INVALID_ARG;
+    sim_critical_enter();
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        if (!(pGPIOConfig->pin_bit_mask & (1ULL << i))) continue;
+        sim_pin_t *p = &pins[i];
+        p->mode = pGPIOConfig->mode;
+        p->intr_type = pGPIOConfig->intr_type;
+        p->intr_enabled = pGPIOConfig->intr_type != GPIO_INTR_DISABLE;
+        if (p->mode == GPIO_MODE_OUTPUT) output_mask |= 1UL << i;
+        else output_mask &= ~(1UL << i);
+        if (p->mode == GPIO_MODE_INPUT && pGPIOConfig->pull_up_en) p->level = 1;
+    }
+    sim_critical_exit();
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num) {
+    if (!pin_valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    sim_critical_enter();
+    pins[gpio_num].mode = GPIO_MODE_DISABLE;
+    pins[gpio_num].intr_enabled = false;
+    output_mask &= ~(1UL << gpio_num);
+    sim_critical_exit();
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (!pin_valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    sim_critical_enter();
+    if (gpio_num == SIM_DHT_GPIO) {
+        int64_t now = sim_now_us();
+        if (!level) {
+            dht_low_since = now;
+        } else if (dht_low_since >= 0) {
+            dht_start_seen = now - dht_low_since >= DHT_START_MIN_US;
+            dht_low_since = -1;
+        }
+    }
+    pins[gpio_num].level = level ? 1 : 0;
+    if (level) out_reg |= 1UL << gpio_num;
+    else out_reg &= ~(1UL << gpio_num);
+    sim_critical_exit();
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    return pin_valid(gpio_num) ? pins[gpio_num].level : 0;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num) {
+    if (!pin_valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    sim_critical_enter();
+    pins[gpio_num].intr_enabled = true;
+    /* The sensor answers once the host has released the line and is listening for edges */
+    if (gpio_num == SIM_DHT_GPIO && dht_start_seen) {
+        dht_start_seen = false;
+        dht_send_frame();
+    }
+    sim_critical_exit();
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num) {
+    if (!pin_valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    sim_critical_enter();
+    pins[gpio_num].intr_enabled = false;
+    /* The DHT11 driver masks the pin as the first step of decoding a frame */
+    if (gpio_num == SIM_DHT_GPIO && dht_frame_sent) {
+        dht_frame_sent = false;
+        sim_stimulus(SIM_STIMULUS_SENSOR);
+    }
+    sim_critical_exit();
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
+    static bool installed;
+    if (installed) return ESP_ERR_INVALID_STATE;
+    installed = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args) {
+    if (!pin_valid(gpio_num)) return ESP_ERR_INVALID_ARG;
+    sim_critical_enter();
+    pins[gpio_num].isr = isr_handler;
+    pins[gpio_num].isr_arg = args;
+    sim_critical_exit();
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num) {
+    return gpio_isr_handler_add(gpio_num, NULL, NULL);
+}
+
+void sim_reg_write(uint32_t reg, uint32_t val) {
+    sim_critical_enter();
+    switch (reg) {
+    case GPIO_OUT_REG: out_reg = val; break;
+    case GPIO_OUT_W1TS_REG: out_reg |= val; break;
+    case GPIO_OUT_W1TC_REG: out_reg &= ~val; break;
+    default:
+        ESP_LOGE(TAG, "Write to unmodelled register 0x%08lx", (unsigned long)reg);
+        break;
+    }
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        if (output_mask & (1UL << i)) pins[i].level = (out_reg >> i) & 1;
+    }
+    sim_critical_exit();
+}
+
+uint32_t sim_reg_read(uint32_t reg) {
+    return reg == GPIO_OUT_REG ? out_reg : 0;
+}
+
+void sim_gpio_commit(void) {
+    uint32_t outputs = out_reg & output_mask;
+    if (outputs == out_published) return;
+    int64_t wall = sim_wall_us();
+    transitions++;
+    if (stimulus_pending) {
+        int64_t us = wall - stimulus_wall_us;
+        sim_latency_t *l = &latency[stimulus_kind];
+        if (l->count == 0 || us < l->min_us) l->min_us = us;
+        if (us > l->max_us) l->max_us = us;
+        l->total_us += us;
+        l->count++;
+        stimulus_pending = false;
+        ESP_LOGI(TAG, "Outputs 0x%02lx -> 0x%02lx, %lld us after %s", (unsigned long)out_published,
+                 (unsigned long)outputs, (long long)us, stimulus_names[stimulus_kind]);
+    } else {
+        ESP_LOGI(TAG, "Outputs 0x%02lx -> 0x%02lx", (unsigned long)out_published, (unsigned long)outputs);
+    }
+    out_published = outputs;
+}
+
+uint32_t sim_gpio_outputs(void) {
+    sim_critical_enter();
+    uint32_t outputs = out_published;
+    sim_critical_exit();
+    return outputs;
+}
+
+void sim_stimulus(sim_stimulus_t kind) {
+    sim_critical_enter();
+    stimulus_pending = true;
+    stimulus_kind = kind;
+    stimulus_wall_us = sim_wall_us();
+    sim_critical_exit();
+}
+
+void sim_gpio_button(bool pressed) {
+    sim_critical_enter();
+    sim_pin_t *p = &pins[SIM_BUTTON_GPIO];
+    int old = p->level;
+    p->level = pressed ? 0 : 1;
+    if (pressed) sim_stimulus(SIM_STIMULUS_BUTTON);
+    pin_dispatch(p, old);
+    sim_critical_exit();
+}
+
+void sim_gpio_dht_fault(const char *fault) {
+    sim_critical_enter();
+    if (strcmp(fault, "crc") == 0) dht_fault = DHT_FAULT_CRC;
+    else if (strcmp(fault, "timeout") == 0) dht_fault = DHT_FAULT_TIMEOUT;
+    else dht_fault = DHT_FAULT_NONE;
+    sim_critical_exit();
+}
+
+void sim_gpio_report(void) {
+    printf("Output transitions: %lu\n", (unsigned long)transitions);
+    printf("Stimulus-to-output latency (host us):\n");
+    for (int i = 0; i < SIM_STIMULUS_MAX; i++) {
+        const sim_latency_t *l = &latency[i];
+        if (!l->count) {
+            printf("  %-7s   none\n", stimulus_names[i]);
+            continue;
+        }
+        printf("  %-7s n=%-4lu min=%-8lld mean=%-8lld max=%lld\n", stimulus_names[i], (unsigned long)l->count,
+               (long long)l->min_us, (long long)(l->total_us / l->count), (long long)l->max_us);
+    }
+}
@@ -0,0 +1,142 @@
+/* sim_i2c.c - I2C master bus that completes every transaction immediately.
+ * Two parts answer on it: the SSD1306, which only ever receives, and an SHT3x whose
+ * measurements follow the trace's temperature and humidity. */
+#include <math.h>
+#include <stdlib.h>
+#include "driver/i2c_master.h"
+#include "sim.h"
+
+#define SIM_SSD1306_ADDR        0x3C
+#define SIM_SHT3X_ADDR          0x44
+#define SHT3X_MEASURE_US        15500
+
+struct i2c_master_bus_t {
+    i2c_master_bus_config_t config;
+};
+
+struct i2c_master_dev_t {
+    i2c_master_bus_handle_t bus;
+    i2c_device_config_t config;
+    i2c_master_callback_t on_trans_done;
+    void *user_data;
+};
+
+static pthread_mutex_t i2c_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t i2c_transactions;
+static uint32_t i2c_bytes;
+static int64_t sht3x_measure_us = -1;      /* Start of the pending single-shot measurement */
+
+static bool addr_present(uint16_t addr) {
+    return addr == SIM_SSD1306_ADDR || addr == SIM_SHT3X_ADDR;
+}
+
+static void trans_done(i2c_master_dev_handle_t i2c_dev, i2c_master_event_t event) {
+    if (i2c_dev->on_trans_done) {
+        i2c_master_event_data_t evt = { .event = event };
+        i2c_dev->on_trans_done(i2c_dev, &evt, i2c_dev->user_data);
+    }
+}
+
+static uint8_t sht3x_crc(const uint8_t *data) {
+    uint8_t crc = 0xFF;
+    for (int i = 0; i < 2; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+/* The SHT3x NACKs a read until the measurement is complete */
+static bool sht3x_read(uint8_t *buf, size_t len) {
+    if (sht3x_measure_us < 0 || sim_now_us() - sht3x_measure_us < SHT3X_MEASURE_US || len != 6) return false;
+    float temp, hum;
+    sim_trace_sample(sht3x_measure_us, &temp, &hum);
+    sht3x_measure_us = -1;
+    long raw_t = lroundf((temp + 45.0f) / 175.0f * 65535.0f);
+    long raw_rh = lroundf(hum / 100.0f * 65535.0f);
+    raw_t = raw_t < 0 ? 0 : raw_t > 65535 ? 65535 : raw_t;
+    raw_rh = raw_rh < 0 ? 0 : raw_rh > 65535 ? 65535 : raw_rh;
+    buf[0] = (uint8_t)(raw_t >> 8);
+    buf[1] = (uint8_t)raw_t;
+    buf[2] = sht3x_crc(&buf[0]);
+    buf[3] = (uint8_t)(raw_rh >> 8);
+    buf[4] = (uint8_t)raw_rh;
+    buf[5] = sht3x_crc(&buf[3]);
+    return true;
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle) {
+    if (!bus_config || !ret_bus_handle) return ESP_ERR_INVALID_ARG;
+    struct i2c_master_bus_t *bus = calloc(1, sizeof(*bus));
+    if (!bus) return ESP_ERR_NO_MEM;
+    bus->config = *bus_config;
+    *ret_bus_handle = bus;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t *dev_config,
+                                    i2c_master_dev_handle_t *ret_handle) {
+    if (!bus_handle || !dev_config || !ret_handle) return ESP_ERR_INVALID_ARG;
+    struct i2c_master_dev_t *dev = calloc(1, sizeof(*dev));
+    if (!dev) return ESP_ERR_NO_MEM;
+    dev->bus = bus_handle;
+    dev->config = *dev_config;
+    *ret_handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_register_event_callbacks(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_callbacks_t *cbs,
+                                              void *user_data) {
+    if (!i2c_dev || !cbs) return ESP_ERR_INVALID_ARG;
+    if (!i2c_dev->bus->config.trans_queue_depth) return ESP_ERR_INVALID_STATE;
+    i2c_dev->on_trans_done = cbs->on_trans_done;
+    i2c_dev->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size,
+                              int xfer_timeout_ms) {
+    if (!i2c_dev || !write_buffer || !write_size) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&i2c_lock);
+    i2c_transactions++;
+    i2c_bytes += write_size;
+    if (i2c_dev->config.device_address == SIM_SHT3X_ADDR && write_size == 2 &&
+        write_buffer[0] == 0x24 && write_buffer[1] == 0x00) {
+        sht3x_measure_us = sim_now_us();
+    }
+    pthread_mutex_unlock(&i2c_lock);
+    trans_done(i2c_dev, I2C_EVENT_DONE);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t i2c_dev, uint8_t *read_buffer, size_t read_size,
+                             int xfer_timeout_ms) {
+    if (!i2c_dev || !read_buffer || !read_size) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&i2c_lock);
+    i2c_transactions++;
+    i2c_bytes += read_size;
+    bool ack = i2c_dev->config.device_address == SIM_SHT3X_ADDR && sht3x_read(read_buffer, read_size);
+    pthread_mutex_unlock(&i2c_lock);
+    /* Like the real driver, an asynchronous bus reports the NACK through the callback */
+    if (i2c_dev->bus->config.trans_queue_depth) {
+        trans_done(i2c_dev, ack ? I2C_EVENT_DONE : I2C_EVENT_NACK);
+        return ESP_OK;
+    }
+    return ack ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus_handle, uint16_t address, int xfer_timeout_ms) {
+    if (!bus_handle) return ESP_ERR_INVALID_ARG;
+    return addr_present(address) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t bus_handle, int timeout_ms) {
+    return bus_handle ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void sim_i2c_stats(uint32_t *transactions, uint32_t *bytes) {
+    pthread_mutex_lock(&i2c_lock);
+    *transactions = i2c_transactions;
+    *bytes = i2c_bytes;
+    pthread_mutex_unlock(&i2c_lock);
+}
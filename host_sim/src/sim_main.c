@@ -0,0 +1,70 @@
+/* sim_main.c - Runs the firmware's app_main() against the simulated peripherals and
+ * replays a trace. Exits non-zero if any `expect` in the trace failed. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "sim.h"
+
+void app_main(void);
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--speed N] [--quiet] TRACE.csv\n"
+                    "       %s --bench-zones N\n"
+                    "  --speed N        run simulated time N times faster than real time (default 1)\n"
+                    "  --quiet          only log warnings and errors\n"
+                    "  --bench-zones N  measure heap and controller tick time for 1, 2, 4, ... N zones\n", prog, prog);
+}
+
+int main(int argc, char **argv) {
+    double speed = 1.0;
+    bool quiet = false;
+    const char *trace = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--bench-zones") == 0 && i + 1 < argc) {
+            setvbuf(stdout, NULL, _IOLBF, 0);
+            return sim_bench_zones(strtoul(argv[++i], NULL, 10));
+        } else if (argv[i][0] != '-' && !trace) {
+            trace = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!trace || speed <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    sim_clock_init(speed);
+    if (quiet) esp_log_level_set("*", ESP_LOG_WARN);
+    if (sim_trace_load(trace) != ESP_OK) return 2;
+
+    app_main();
+    int failures = sim_trace_run();
+
+    uint32_t publishes, alerts, publish_bytes, ts_publishes, ts_records, ts_bytes, i2c_transactions, i2c_bytes;
+    uint32_t flash_erases, flash_bytes;
+    sim_rmaker_stats(&publishes, &alerts, &publish_bytes);
+    sim_rmaker_ts_stats(&ts_publishes, &ts_records, &ts_bytes);
+    sim_flash_stats(&flash_erases, &flash_bytes);
+    sim_i2c_stats(&i2c_transactions, &i2c_bytes);
+    printf("\n--- Simulation summary (%.1f s simulated) ---\n", (double)sim_now_us() / 1e6);
+    sim_gpio_report();
+    printf("Cloud publishes: %lu (%lu bytes), alerts: %lu\n", (unsigned long)publishes,
+           (unsigned long)publish_bytes, (unsigned long)alerts);
+    printf("Time-series publishes: %lu (%lu records, %lu bytes)\n", (unsigned long)ts_publishes,
+           (unsigned long)ts_records, (unsigned long)ts_bytes);
+    printf("Publishes dropped: %lu\n", (unsigned long)sim_rmaker_dropped());
+    printf("History flash: %lu sector erases, %lu bytes written\n", (unsigned long)flash_erases,
+           (unsigned long)flash_bytes);
+    printf("I2C transactions: %lu (%lu bytes)\n", (unsigned long)i2c_transactions, (unsigned long)i2c_bytes);
+    printf("Expectations failed: %d\n", failures);
+    fflush(stdout);
+    exit(failures ? 1 : 0);
+}
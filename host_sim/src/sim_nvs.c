@@ -0,0 +1,130 @@
+/* sim_nvs.c - NVS stand-in: namespaces and keys in memory, lost when the process exits */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#define SIM_NVS_NAMESPACES  8
+
+typedef struct sim_nvs_entry {
+    char *key;
+    char *value;
+    struct sim_nvs_entry *next;
+} sim_nvs_entry_t;
+
+typedef struct {
+    char name[16];
+    bool writable;
+    sim_nvs_entry_t *entries;
+} sim_nvs_ns_t;
+
+static pthread_mutex_t nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_nvs_ns_t namespaces[SIM_NVS_NAMESPACES];
+static bool initialised;
+
+static sim_nvs_entry_t *find_entry(nvs_handle_t handle, const char *key) {
+    for (sim_nvs_entry_t *e = namespaces[handle - 1].entries; e; e = e->next) {
+        if (strcmp(e->key, key) == 0) return e;
+    }
+    return NULL;
+}
+
+static bool handle_valid(nvs_handle_t handle) {
+    return handle >= 1 && handle <= SIM_NVS_NAMESPACES && namespaces[handle - 1].name[0];
+}
+
+esp_err_t nvs_flash_init(void) {
+    initialised = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    pthread_mutex_lock(&nvs_lock);
+    for (int i = 0; i < SIM_NVS_NAMESPACES; i++) {
+        for (sim_nvs_entry_t *e = namespaces[i].entries, *next; e; e = next) {
+            next = e->next;
+            free(e->key);
+            free(e->value);
+            free(e);
+        }
+        namespaces[i].entries = NULL;
+        namespaces[i].name[0] = '\0';
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+/* One handle per namespace; a read-only open of a namespace never written reports
+ * ESP_ERR_NVS_NOT_FOUND, like the real library */
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    if (!initialised) return ESP_ERR_INVALID_STATE;
+    if (!namespace_name || strlen(namespace_name) >= sizeof(namespaces[0].name)) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&nvs_lock);
+    int free_slot = -1;
+    for (int i = 0; i < SIM_NVS_NAMESPACES; i++) {
+        if (namespaces[i].name[0] && strcmp(namespaces[i].name, namespace_name) == 0) {
+            *out_handle = i + 1;
+            err = ESP_OK;
+            break;
+        }
+        if (!namespaces[i].name[0] && free_slot < 0) free_slot = i;
+    }
+    if (err != ESP_OK && open_mode == NVS_READWRITE) {
+        if (free_slot < 0) {
+            err = ESP_ERR_NO_MEM;
+        } else {
+            strcpy(namespaces[free_slot].name, namespace_name);
+            *out_handle = free_slot + 1;
+            err = ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return handle_valid(handle) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    if (!handle_valid(handle) || !key || !value) return ESP_ERR_INVALID_ARG;
+    char *copy = strdup(value);
+    if (!copy) return ESP_ERR_NO_MEM;
+    pthread_mutex_lock(&nvs_lock);
+    sim_nvs_entry_t *e = find_entry(handle, key);
+    if (!e) {
+        e = calloc(1, sizeof(*e));
+        e->key = strdup(key);
+        e->next = namespaces[handle - 1].entries;
+        namespaces[handle - 1].entries = e;
+    }
+    free(e->value);
+    e->value = copy;
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length) {
+    if (!handle_valid(handle) || !key || !length) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&nvs_lock);
+    sim_nvs_entry_t *e = find_entry(handle, key);
+    if (!e) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else if (!out_value) {
+        *length = strlen(e->value) + 1;
+    } else if (*length < strlen(e->value) + 1) {
+        err = ESP_ERR_INVALID_SIZE;
+    } else {
+        strcpy(out_value, e->value);
+        *length = strlen(e->value) + 1;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
@@ -0,0 +1,658 @@
+/* sim_rmaker.c - In-process stand-in for ESP RainMaker and the network layer.
+ * Keeps the node/device/param model of the real core, and turns every params report into
+ * a logged "publish" so that traces can check what the cloud would have seen. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sdkconfig.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_standard_types.h>
+#include <esp_rmaker_standard_params.h>
+#include <esp_rmaker_console.h>
+#include <esp_console.h>
+#include <esp_timer.h>
+#include <app_network.h>
+#include "esp_log.h"
+#include "sim.h"
+
+static const char *TAG = "sim_cloud";
+
+#define SIM_PUBLISH_MAX 16384
+/* MQTT budget defaults of the RainMaker Kconfig */
+#define SIM_MQTT_BUDGET_DEFAULT     100
+#define SIM_MQTT_BUDGET_MAX         1024
+#define SIM_MQTT_BUDGET_REVIVE_US   5000000
+#define SIM_MAX_CONSOLE_CMDS        8
+
+typedef struct sim_param {
+    char *name;
+    char *type;
+    uint8_t props;
+    esp_rmaker_param_val_t val;
+    esp_rmaker_param_val_t reported;    /* Value in the last publish that carried this param */
+    bool changed;
+    bool ever_reported;
+    bool report_immediate;
+    struct sim_device *parent;
+    struct sim_param *next;
+} sim_param_t;
+
+typedef struct sim_device {
+    char *name;
+    char *type;
+    void *priv_data;
+    esp_rmaker_device_write_cb_t write_cb;
+    esp_rmaker_device_bulk_write_cb_t bulk_write_cb;
+    sim_param_t *params;
+    struct sim_device *next;
+} sim_device_t;
+
+typedef struct {
+    char *name;
+    char *type;
+    sim_device_t *devices;
+} sim_node_t;
+
+ESP_EVENT_DEFINE_BASE(RMAKER_EVENT);
+
+static pthread_mutex_t rmaker_lock;
+static pthread_once_t rmaker_once = PTHREAD_ONCE_INIT;
+static sim_node_t *node;
+static bool started;
+static uint8_t batch_depth;
+static esp_timer_handle_t coalesce_timer;   /* Armed while reports wait for the coalescing window */
+static uint32_t publish_count;
+static uint32_t publish_bytes;
+static uint32_t alert_count;
+static uint32_t ts_count;
+static uint32_t ts_records;
+static uint32_t ts_bytes;
+static uint32_t dropped_count;
+static bool mqtt_down;
+static bool budget_enabled = true;
+static int32_t budget = SIM_MQTT_BUDGET_DEFAULT;
+static int64_t budget_revived_us;
+static esp_console_cmd_t console_cmds[SIM_MAX_CONSOLE_CMDS];
+static int console_cmd_count;
+
+static void rmaker_lock_init(void) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&rmaker_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void lock(void) {
+    pthread_once(&rmaker_once, rmaker_lock_init);
+    pthread_mutex_lock(&rmaker_lock);
+}
+
+static void unlock(void) {
+    pthread_mutex_unlock(&rmaker_lock);
+}
+
+static bool val_is_string(esp_rmaker_val_type_t type) {
+    return type == RMAKER_VAL_TYPE_STRING || type == RMAKER_VAL_TYPE_OBJECT || type == RMAKER_VAL_TYPE_ARRAY;
+}
+
+static void val_copy(esp_rmaker_param_val_t *dst, esp_rmaker_param_val_t src) {
+    if (val_is_string(dst->type)) free(dst->val.s);
+    *dst = src;
+    if (val_is_string(src.type) && src.val.s) dst->val.s = strdup(src.val.s);
+}
+
+static int val_print(char *buf, size_t len, const esp_rmaker_param_val_t *v) {
+    switch (v->type) {
+    case RMAKER_VAL_TYPE_BOOLEAN: return snprintf(buf, len, "%s", v->val.b ? "true" : "false");
+    case RMAKER_VAL_TYPE_INTEGER: return snprintf(buf, len, "%d", v->val.i);
+    case RMAKER_VAL_TYPE_FLOAT: return snprintf(buf, len, "%.2f", v->val.f);
+    case RMAKER_VAL_TYPE_STRING: return snprintf(buf, len, "\"%s\"", v->val.s ? v->val.s : "");
+    case RMAKER_VAL_TYPE_OBJECT:
+    case RMAKER_VAL_TYPE_ARRAY: return snprintf(buf, len, "%s", v->val.s ? v->val.s : "null");
+    default: return snprintf(buf, len, "null");
+    }
+}
+
+/* Parses `text` as a value of `type`; strings are borrowed, not copied */
+static esp_rmaker_param_val_t val_parse(esp_rmaker_val_type_t type, const char *text) {
+    esp_rmaker_param_val_t v = { .type = type };
+    switch (type) {
+    case RMAKER_VAL_TYPE_BOOLEAN: v.val.b = strcmp(text, "true") == 0 || strcmp(text, "1") == 0; break;
+    case RMAKER_VAL_TYPE_INTEGER: v.val.i = atoi(text); break;
+    case RMAKER_VAL_TYPE_FLOAT: v.val.f = strtof(text, NULL); break;
+    default: v.val.s = (char *)text; break;
+    }
+    return v;
+}
+
+static bool val_equal(const esp_rmaker_param_val_t *a, const esp_rmaker_param_val_t *b) {
+    if (a->type != b->type) return false;
+    switch (a->type) {
+    case RMAKER_VAL_TYPE_BOOLEAN: return a->val.b == b->val.b;
+    case RMAKER_VAL_TYPE_INTEGER: return a->val.i == b->val.i;
+    case RMAKER_VAL_TYPE_FLOAT: return fabsf(a->val.f - b->val.f) < 0.05f;
+    default: return a->val.s && b->val.s && strcmp(a->val.s, b->val.s) == 0;
+    }
+}
+
+static bool budget_available(void) {
+    if (!budget_enabled) return true;
+    int64_t revives = (sim_now_us() - budget_revived_us) / SIM_MQTT_BUDGET_REVIVE_US;
+    budget_revived_us += revives * SIM_MQTT_BUDGET_REVIVE_US;
+    budget = budget + revives > SIM_MQTT_BUDGET_MAX ? SIM_MQTT_BUDGET_MAX : budget + (int32_t)revives;
+    return budget > 0;
+}
+
+/* Whether a publish would go out now; takes one unit of budget if it would */
+static bool publish_allowed(const char *what) {
+    if (!mqtt_down && budget_available()) {
+        if (budget_enabled) budget--;
+        return true;
+    }
+    dropped_count++;
+    ESP_LOGW(TAG, "%s dropped: %s", what, mqtt_down ? "MQTT disconnected" : "MQTT budget exhausted");
+    return false;
+}
+
+/* Publishes every changed param in one message, like esp_rmaker_report_updated_params() */
+static void report_updated(bool all) {
+    char msg[SIM_PUBLISH_MAX];
+    size_t len = 0;
+    bool any = false;
+    if (!started || !node) return;
+    /* Like the core, the changed flags are reset even if the publish then fails */
+    bool online = !mqtt_down && budget_available();
+    len += snprintf(msg + len, sizeof(msg) - len, "{");
+    for (sim_device_t *d = node->devices; d; d = d->next) {
+        bool dev_open = false;
+        for (sim_param_t *p = d->params; p; p = p->next) {
+            if (!p->changed && !all) continue;
+            if (len >= sizeof(msg) - 1) break;
+            if (!dev_open) {
+                len += snprintf(msg + len, sizeof(msg) - len, "%s\"%s\":{", any ? "," : "", d->name);
+                dev_open = true;
+            } else {
+                len += snprintf(msg + len, sizeof(msg) - len, ",");
+            }
+            if (len >= sizeof(msg) - 1) break;
+            len += snprintf(msg + len, sizeof(msg) - len, "\"%s\":", p->name);
+            if (len >= sizeof(msg) - 1) break;
+            len += val_print(msg + len, sizeof(msg) - len, &p->val);
+            if (online) {
+                val_copy(&p->reported, p->val);
+                p->ever_reported = true;
+            }
+            p->changed = false;
+            any = true;
+        }
+        if (dev_open && len < sizeof(msg) - 1) len += snprintf(msg + len, sizeof(msg) - len, "}");
+    }
+    if (!any) return;
+    if (len < sizeof(msg) - 1) len += snprintf(msg + len, sizeof(msg) - len, "}");
+    if (len > sizeof(msg) - 1) len = sizeof(msg) - 1;
+    if (!publish_allowed("Params publish")) return;
+    publish_count++;
+    publish_bytes += len;
+    ESP_LOGI(TAG, "Publish #%lu (%u bytes) %s", (unsigned long)publish_count, (unsigned)len, msg);
+}
+
+static void coalesce_timer_cb(void *arg) {
+    lock();
+    report_updated(false);
+    unlock();
+}
+
+/* Like the core, a report waits for the coalescing window unless a changed param skips it */
+static void report_coalesced(bool immediate) {
+    if (!immediate && CONFIG_ESP_RMAKER_PARAM_REPORT_COALESCE_MS > 0) {
+        if (!coalesce_timer) {
+            const esp_timer_create_args_t args = { .callback = coalesce_timer_cb, .name = "rmaker_report" };
+            esp_timer_create(&args, &coalesce_timer);
+        }
+        if (esp_timer_is_active(coalesce_timer) ||
+            esp_timer_start_once(coalesce_timer, CONFIG_ESP_RMAKER_PARAM_REPORT_COALESCE_MS * 1000) == ESP_OK) {
+            return;
+        }
+    }
+    report_updated(false);
+}
+
+static bool changed_immediate(void) {
+    for (sim_device_t *d = node ? node->devices : NULL; d; d = d->next) {
+        for (sim_param_t *p = d->params; p; p = p->next) {
+            if (p->changed && p->report_immediate) return true;
+        }
+    }
+    return false;
+}
+
+static sim_device_t *find_device(const char *name) {
+    for (sim_device_t *d = node ? node->devices : NULL; d; d = d->next) {
+        if (strcmp(d->name, name) == 0) return d;
+    }
+    return NULL;
+}
+
+static sim_param_t *find_param(const sim_device_t *d, const char *name) {
+    for (sim_param_t *p = d ? d->params : NULL; p; p = p->next) {
+        if (strcmp(p->name, name) == 0) return p;
+    }
+    return NULL;
+}
+
+esp_rmaker_param_val_t esp_rmaker_bool(bool bval) {
+    return (esp_rmaker_param_val_t){ .type = RMAKER_VAL_TYPE_BOOLEAN, .val.b = bval };
+}
+
+esp_rmaker_param_val_t esp_rmaker_int(int ival) {
+    return (esp_rmaker_param_val_t){ .type = RMAKER_VAL_TYPE_INTEGER, .val.i = ival };
+}
+
+esp_rmaker_param_val_t esp_rmaker_float(float fval) {
+    return (esp_rmaker_param_val_t){ .type = RMAKER_VAL_TYPE_FLOAT, .val.f = fval };
+}
+
+esp_rmaker_param_val_t esp_rmaker_str(const char *sval) {
+    return (esp_rmaker_param_val_t){ .type = RMAKER_VAL_TYPE_STRING, .val.s = (char *)sval };
+}
+
+esp_rmaker_param_val_t esp_rmaker_obj(const char *val) {
+    return (esp_rmaker_param_val_t){ .type = RMAKER_VAL_TYPE_OBJECT, .val.s = (char *)val };
+}
+
+esp_rmaker_param_val_t esp_rmaker_array(const char *val) {
+    return (esp_rmaker_param_val_t){ .type = RMAKER_VAL_TYPE_ARRAY, .val.s = (char *)val };
+}
+
+esp_rmaker_node_t *esp_rmaker_node_init(const esp_rmaker_config_t *config, const char *name, const char *type) {
+    lock();
+    if (!node) {
+        node = calloc(1, sizeof(*node));
+        if (node) {
+            node->name = strdup(name);
+            node->type = strdup(type);
+        }
+    }
+    unlock();
+    return (esp_rmaker_node_t *)node;
+}
+
+esp_err_t esp_rmaker_node_add_device(const esp_rmaker_node_t *n, const esp_rmaker_device_t *device) {
+    if (!n || !device) return ESP_ERR_INVALID_ARG;
+    sim_device_t *d = (sim_device_t *)device;
+    lock();
+    sim_device_t **tail = &((sim_node_t *)n)->devices;
+    while (*tail) tail = &(*tail)->next;
+    *tail = d;
+    unlock();
+    return ESP_OK;
+}
+
+esp_rmaker_device_t *esp_rmaker_device_create(const char *dev_name, const char *type, void *priv_data) {
+    if (!dev_name) return NULL;
+    sim_device_t *d = calloc(1, sizeof(*d));
+    if (!d) return NULL;
+    d->name = strdup(dev_name);
+    d->type = type ? strdup(type) : NULL;
+    d->priv_data = priv_data;
+    return (esp_rmaker_device_t *)d;
+}
+
+esp_err_t esp_rmaker_device_add_cb(const esp_rmaker_device_t *device, esp_rmaker_device_write_cb_t write_cb,
+                                   esp_rmaker_device_read_cb_t read_cb) {
+    if (!device) return ESP_ERR_INVALID_ARG;
+    ((sim_device_t *)device)->write_cb = write_cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_device_add_bulk_cb(const esp_rmaker_device_t *device, esp_rmaker_device_bulk_write_cb_t write_cb,
+                                        esp_rmaker_device_bulk_read_cb_t read_cb) {
+    if (!device) return ESP_ERR_INVALID_ARG;
+    ((sim_device_t *)device)->bulk_write_cb = write_cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_device_add_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param) {
+    if (!device || !param) return ESP_ERR_INVALID_ARG;
+    sim_device_t *d = (sim_device_t *)device;
+    sim_param_t *p = (sim_param_t *)param;
+    lock();
+    p->parent = d;
+    sim_param_t **tail = &d->params;
+    while (*tail) tail = &(*tail)->next;
+    *tail = p;
+    unlock();
+    return ESP_OK;
+}
+
+char *esp_rmaker_device_get_name(const esp_rmaker_device_t *device) {
+    return device ? ((sim_device_t *)device)->name : NULL;
+}
+
+char *esp_rmaker_device_get_type(const esp_rmaker_device_t *device) {
+    return device ? ((sim_device_t *)device)->type : NULL;
+}
+
+void *esp_rmaker_device_get_priv_data(const esp_rmaker_device_t *device) {
+    return device ? ((sim_device_t *)device)->priv_data : NULL;
+}
+
+esp_rmaker_param_t *esp_rmaker_device_get_param_by_name(const esp_rmaker_device_t *device, const char *param_name) {
+    return (esp_rmaker_param_t *)find_param((const sim_device_t *)device, param_name);
+}
+
+esp_err_t esp_rmaker_device_assign_primary_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param) {
+    return device && param ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_rmaker_param_t *esp_rmaker_param_create(const char *param_name, const char *type,
+                                            esp_rmaker_param_val_t val, uint8_t properties) {
+    if (!param_name) return NULL;
+    /* Same restriction as the real core */
+    if ((properties & (PROP_FLAG_TIME_SERIES | PROP_FLAG_SIMPLE_TIME_SERIES)) &&
+        (val.type == RMAKER_VAL_TYPE_OBJECT || val.type == RMAKER_VAL_TYPE_ARRAY)) {
+        ESP_LOGE(TAG, "Time series not allowed for array/object param %s", param_name);
+        return NULL;
+    }
+    sim_param_t *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->name = strdup(param_name);
+    p->type = type ? strdup(type) : NULL;
+    p->props = properties;
+    p->val.type = val.type;
+    p->reported.type = val.type;
+    val_copy(&p->val, val);
+    return (esp_rmaker_param_t *)p;
+}
+
+esp_err_t esp_rmaker_param_add_ui_type(const esp_rmaker_param_t *param, const char *ui_type) {
+    return param ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_rmaker_param_add_report_immediate(const esp_rmaker_param_t *param) {
+    if (!param) return ESP_ERR_INVALID_ARG;
+    ((sim_param_t *)param)->report_immediate = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_param_add_bounds(const esp_rmaker_param_t *param, esp_rmaker_param_val_t min,
+                                      esp_rmaker_param_val_t max, esp_rmaker_param_val_t step) {
+    return param ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+char *esp_rmaker_param_get_name(const esp_rmaker_param_t *param) {
+    return param ? ((sim_param_t *)param)->name : NULL;
+}
+
+char *esp_rmaker_param_get_type(const esp_rmaker_param_t *param) {
+    return param ? ((sim_param_t *)param)->type : NULL;
+}
+
+esp_rmaker_param_val_t *esp_rmaker_param_get_val(esp_rmaker_param_t *param) {
+    return param ? &((sim_param_t *)param)->val : NULL;
+}
+
+esp_err_t esp_rmaker_param_update(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val) {
+    if (!param) return ESP_ERR_INVALID_ARG;
+    sim_param_t *p = (sim_param_t *)param;
+    if (p->val.type != val.type) {
+        ESP_LOGE(TAG, "New param value type not same as the existing one.");
+        return ESP_ERR_INVALID_ARG;
+    }
+    lock();
+    val_copy(&p->val, val);
+    p->changed = true;
+    unlock();
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_param_update_and_report(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val) {
+    esp_err_t err = esp_rmaker_param_update(param, val);
+    if (err != ESP_OK) return err;
+    lock();
+    if (batch_depth == 0) report_coalesced(((sim_param_t *)param)->report_immediate);
+    unlock();
+    return ESP_OK;
+}
+
+static esp_err_t report_simple_ts(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val, bool cache_only) {
+    if (!param) return ESP_ERR_INVALID_ARG;
+    sim_param_t *p = (sim_param_t *)param;
+    if (!(p->props & PROP_FLAG_SIMPLE_TIME_SERIES) || p->val.type != val.type) return ESP_ERR_INVALID_ARG;
+    lock();
+    /* Goes out on its own topic. Like the core, the value then rides along with the next
+     * params report unless only the time series database wants it. */
+    val_copy(&p->val, val);
+    if (!cache_only) p->changed = true;
+    if (!publish_allowed("Time series")) {
+        unlock();
+        return ESP_FAIL;
+    }
+    ts_count++;
+    ts_records++;
+    size_t len = val_is_string(val.type) && val.val.s ? strlen(val.val.s) : sizeof(val.val);
+    ts_bytes += len;
+    unlock();
+    ESP_LOGD(TAG, "Time series %s: %zu bytes", p->name, len);
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_param_report_simple_ts_data(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val,
+                                                 int timestamp, uint16_t ttl_days) {
+    return report_simple_ts(param, val, false);
+}
+
+esp_err_t esp_rmaker_param_report_simple_ts_data_only(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val,
+                                                      int timestamp, uint16_t ttl_days) {
+    return report_simple_ts(param, val, true);
+}
+
+esp_err_t esp_rmaker_param_report_time_series_records(const esp_rmaker_ts_record_t *records, size_t count) {
+    if (!records || !count) return ESP_ERR_INVALID_ARG;
+    char line[128];
+    size_t len = 0;
+    lock();
+    for (size_t i = 0; i < count; i++) {
+        const sim_param_t *p = (const sim_param_t *)records[i].param;
+        if (!p || !p->parent || records[i].val.type != p->val.type) {
+            unlock();
+            return ESP_ERR_INVALID_ARG;
+        }
+        /* Roughly what the core generates: a name entry per run, a {t,v} object per record */
+        if (i == 0 || records[i - 1].param != records[i].param) {
+            len += snprintf(line, sizeof(line), "{\"name\":\"%s.%s\",\"dt\":\"float\",\"records\":[]},",
+                            p->parent->name, p->name);
+        }
+        len += snprintf(line, sizeof(line), "{\"t\":%d,\"v\":", records[i].timestamp);
+        len += val_print(line, sizeof(line), &records[i].val) + 2;
+    }
+    if (!started) {
+        unlock();
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!publish_allowed("Time series records")) {
+        unlock();
+        return ESP_FAIL;
+    }
+    ts_count++;
+    ts_records += count;
+    ts_bytes += len;
+    unlock();
+    ESP_LOGI(TAG, "Time series batch: %u records (%u bytes)", (unsigned)count, (unsigned)len);
+    return ESP_OK;
+}
+
+bool esp_rmaker_is_mqtt_connected(void) {
+    lock();
+    bool connected = started && !mqtt_down;
+    unlock();
+    return connected;
+}
+
+bool esp_rmaker_mqtt_is_budget_available(void) {
+    lock();
+    bool available = budget_available();
+    unlock();
+    return available;
+}
+
+esp_err_t esp_rmaker_param_batch_begin(void) {
+    lock();
+    batch_depth++;
+    unlock();
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_param_batch_commit(void) {
+    esp_err_t err = ESP_OK;
+    lock();
+    if (batch_depth == 0) err = ESP_ERR_INVALID_STATE;
+    else if (--batch_depth == 0) report_coalesced(changed_immediate());
+    unlock();
+    return err;
+}
+
+esp_err_t esp_rmaker_raise_alert(const char *alert_str) {
+    if (!alert_str) return ESP_ERR_INVALID_ARG;
+    lock();
+    alert_count++;
+    unlock();
+    ESP_LOGW(TAG, "Alert: %s", alert_str);
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_start(void) {
+    lock();
+    started = true;
+    /* The initial params report carries every param */
+    report_updated(true);
+    unlock();
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_ota_enable_default(void) {
+    return ESP_OK;
+}
+
+esp_rmaker_param_t *esp_rmaker_power_param_create(const char *param_name, bool val) {
+    return esp_rmaker_param_create(param_name, ESP_RMAKER_PARAM_POWER, esp_rmaker_bool(val),
+                                   PROP_FLAG_READ | PROP_FLAG_WRITE);
+}
+
+bool esp_rmaker_time_check(void) {
+    return true;
+}
+
+esp_err_t esp_rmaker_console_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_console_cmd_register(const esp_console_cmd_t *cmd) {
+    if (!cmd || !cmd->command || !cmd->func) return ESP_ERR_INVALID_ARG;
+    if (console_cmd_count == SIM_MAX_CONSOLE_CMDS) return ESP_ERR_NO_MEM;
+    console_cmds[console_cmd_count++] = *cmd;
+    return ESP_OK;
+}
+
+int sim_console_run(int argc, char **argv) {
+    for (int i = 0; i < console_cmd_count; i++) {
+        if (strcmp(console_cmds[i].command, argv[0]) == 0) return console_cmds[i].func(argc, argv);
+    }
+    ESP_LOGE(TAG, "No console command %s", argv[0]);
+    return -1;
+}
+
+void app_network_init(void) {
+}
+
+esp_err_t app_network_start(app_network_pop_type_t pop_type) {
+    ESP_LOGI(TAG, "Network up (simulated)");
+    return ESP_OK;
+}
+
+esp_err_t sim_rmaker_write(const char *device, const char *param, const char *value) {
+    lock();
+    sim_device_t *d = find_device(device);
+    sim_param_t *p = find_param(d, param);
+    unlock();
+    if (!p) {
+        ESP_LOGE(TAG, "No param %s.%s to write", device, param);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (!(p->props & PROP_FLAG_WRITE)) {
+        ESP_LOGE(TAG, "Param %s.%s is read-only", device, param);
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_rmaker_param_write_req_t req = {
+        .param = (esp_rmaker_param_t *)p,
+        .val = val_parse(p->val.type, value),
+    };
+    esp_rmaker_write_ctx_t ctx = { .src = ESP_RMAKER_REQ_SRC_CLOUD };
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    sim_stimulus(SIM_STIMULUS_CLOUD);
+    if (d->bulk_write_cb) {
+        err = d->bulk_write_cb((esp_rmaker_device_t *)d, &req, 1, d->priv_data, &ctx);
+    } else if (d->write_cb) {
+        err = d->write_cb((esp_rmaker_device_t *)d, req.param, req.val, d->priv_data, &ctx);
+    }
+    if (err == ESP_OK) {
+        lock();
+        report_updated(false);
+        unlock();
+    }
+    return err;
+}
+
+bool sim_rmaker_expect(const char *device, const char *param, const char *value) {
+    lock();
+    sim_param_t *p = find_param(find_device(device), param);
+    bool ok = false;
+    char seen[64] = "nothing";
+    if (p) {
+        esp_rmaker_param_val_t want = val_parse(p->val.type, value);
+        ok = p->ever_reported && val_equal(&p->reported, &want);
+        if (p->ever_reported) val_print(seen, sizeof(seen), &p->reported);
+    }
+    unlock();
+    if (!ok) ESP_LOGE(TAG, "Expected %s.%s = %s, cloud has %s", device, param, value, p ? seen : "no such param");
+    return ok;
+}
+
+void sim_rmaker_stats(uint32_t *publishes, uint32_t *alerts, uint32_t *bytes) {
+    lock();
+    *publishes = publish_count;
+    *alerts = alert_count;
+    *bytes = publish_bytes;
+    unlock();
+}
+
+void sim_rmaker_ts_stats(uint32_t *publishes, uint32_t *records, uint32_t *bytes) {
+    lock();
+    *publishes = ts_count;
+    *records = ts_records;
+    *bytes = ts_bytes;
+    unlock();
+}
+
+uint32_t sim_rmaker_dropped(void) {
+    lock();
+    uint32_t dropped = dropped_count;
+    unlock();
+    return dropped;
+}
+
+void sim_rmaker_mqtt(bool connected) {
+    lock();
+    mqtt_down = !connected;
+    unlock();
+    ESP_LOGW(TAG, "MQTT %s", connected ? "connected" : "disconnected");
+}
+
+void sim_rmaker_budget_enable(bool enable) {
+    lock();
+    budget_enabled = enable;
+    unlock();
+}
@@ -0,0 +1,139 @@
+/* sim_timer.c - esp_timer on the simulated clock, dispatched from one thread */
+#include <stdlib.h>
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "sim.h"
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    int64_t alarm_us;
+    uint64_t period_us;         /* 0 for one-shot timers */
+    bool armed;
+    struct esp_timer *next;
+};
+
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+static struct esp_timer *timers;
+
+static struct esp_timer *timer_next_due(void) {
+    struct esp_timer *next = NULL;
+    for (struct esp_timer *t = timers; t; t = t->next) {
+        if (t->armed && (!next || t->alarm_us < next->alarm_us)) next = t;
+    }
+    return next;
+}
+
+/* Plays the role of the esp_timer task: callbacks never overlap each other */
+static void *timer_thread(void *arg) {
+    pthread_mutex_lock(&timer_lock);
+    while (1) {
+        struct esp_timer *t = timer_next_due();
+        if (!t) {
+            pthread_cond_wait(&timer_cond, &timer_lock);
+            continue;
+        }
+        int64_t now = sim_now_us();
+        if (t->alarm_us > now) {
+            sim_deadline_t deadline = { .at = sim_deadline(t->alarm_us - now) };
+            sim_cond_wait(&timer_cond, &timer_lock, &deadline);
+            continue;
+        }
+        if (t->period_us) t->alarm_us += t->period_us;
+        else t->armed = false;
+        esp_timer_cb_t cb = t->callback;
+        void *cb_arg = t->arg;
+        pthread_mutex_unlock(&timer_lock);
+        cb(cb_arg);
+        pthread_mutex_lock(&timer_lock);
+    }
+    return NULL;
+}
+
+static void timer_start_thread(void) {
+    pthread_t thread;
+    sim_cond_init(&timer_cond);
+    pthread_create(&thread, NULL, timer_thread, NULL);
+    pthread_detach(thread);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+    if (!create_args || !create_args->callback || !out_handle) return ESP_ERR_INVALID_ARG;
+    pthread_once(&timer_once, timer_start_thread);
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) return ESP_ERR_NO_MEM;
+    t->callback = create_args->callback;
+    t->arg = create_args->arg;
+    t->name = create_args->name;
+    pthread_mutex_lock(&timer_lock);
+    t->next = timers;
+    timers = t;
+    pthread_mutex_unlock(&timer_lock);
+    *out_handle = t;
+    return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us, bool restart) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&timer_lock);
+    if (timer->armed != restart) {
+        pthread_mutex_unlock(&timer_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->alarm_us = sim_now_us() + (int64_t)timeout_us;
+    timer->period_us = period_us;
+    timer->armed = true;
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return timer_arm(timer, timeout_us, 0, false);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    return timer_arm(timer, period, period, false);
+}
+
+esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    return timer_arm(timer, timeout_us, timer->period_us ? timeout_us : 0, true);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&timer_lock);
+    esp_err_t err = timer->armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    pthread_mutex_unlock(&timer_lock);
+    return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&timer_lock);
+    if (timer->armed) {
+        pthread_mutex_unlock(&timer_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (struct esp_timer **p = &timers; *p; p = &(*p)->next) {
+        if (*p == timer) {
+            *p = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&timer_lock);
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    pthread_mutex_lock(&timer_lock);
+    bool armed = timer && timer->armed;
+    pthread_mutex_unlock(&timer_lock);
+    return armed;
+}
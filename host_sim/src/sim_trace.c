@@ -0,0 +1,222 @@
+/* sim_trace.c - Scripted stimulus for the simulation.
+ *
+ * One event per line, `time_s,event,args...`; blank lines and `#` comments are skipped:
+ *   12.5,temp,31.0,40          sensor reads 31.0 C / 40 %RH here, interpolated in between
+ *   20,press                   emergency button pressed (and released SIM_BUTTON_HOLD_US later)
+ *   30,write,Emergency,Power,false   cloud write to a device param
+ *   35,expect,Fire Water,Power,true  last value published to the cloud must match
+ *   40,dht,crc                 next DHT11 frame has a bad checksum (`timeout`: no answer)
+ *   60,mqtt,down               MQTT link lost (`up`: back)
+ *   70,backlog,3               the offline history must hold exactly 3 unsent records
+ *   80,console,latency         run a console command, with up to 4 arguments after it
+ *   90,end                     stop; defaults to one second after the last event
+ */
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "app_history.h"
+#include "sim.h"
+
+static const char *TAG = "sim_trace";
+
+#define TRACE_MAX_EVENTS    512
+#define TRACE_MAX_FIELDS    6
+#define TRACE_FIELD_LEN     96
+
+typedef enum {
+    EV_TEMP,
+    EV_PRESS,
+    EV_RELEASE,
+    EV_WRITE,
+    EV_EXPECT,
+    EV_DHT,
+    EV_MQTT,
+    EV_BACKLOG,
+    EV_CONSOLE,
+    EV_END,
+} trace_kind_t;
+
+typedef struct {
+    int64_t t_us;
+    int line;
+    trace_kind_t kind;
+    float temp;
+    float hum;
+    int argc;
+    char args[TRACE_MAX_FIELDS][TRACE_FIELD_LEN];
+} trace_event_t;
+
+static trace_event_t events[TRACE_MAX_EVENTS];
+static int event_count;
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+    return s;
+}
+
+static int event_cmp(const void *a, const void *b) {
+    const trace_event_t *ea = a, *eb = b;
+    if (ea->t_us != eb->t_us) return ea->t_us < eb->t_us ? -1 : 1;
+    return ea->line - eb->line;
+}
+
+static trace_event_t *event_add(int64_t t_us, int line, trace_kind_t kind) {
+    if (event_count == TRACE_MAX_EVENTS) return NULL;
+    trace_event_t *ev = &events[event_count++];
+    memset(ev, 0, sizeof(*ev));
+    ev->t_us = t_us;
+    ev->line = line;
+    ev->kind = kind;
+    return ev;
+}
+
+esp_err_t sim_trace_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        ESP_LOGE(TAG, "Cannot open trace %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    char buf[256];
+    int line = 0;
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK && fgets(buf, sizeof(buf), f)) {
+        line++;
+        char *text = trim(buf);
+        if (*text == '\0' || *text == '#') continue;
+        char *field[TRACE_MAX_FIELDS + 2];
+        int n = 0;
+        for (char *tok = strtok(text, ","); tok && n < TRACE_MAX_FIELDS + 2; tok = strtok(NULL, ",")) {
+            field[n++] = trim(tok);
+        }
+        if (n < 2) {
+            ESP_LOGE(TAG, "%s:%d: expected time,event", path, line);
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        int64_t t_us = (int64_t)llround(strtod(field[0], NULL) * 1e6);
+        const char *name = field[1];
+        trace_event_t *ev = NULL;
+        if (strcmp(name, "temp") == 0 && n == 4) {
+            ev = event_add(t_us, line, EV_TEMP);
+            if (ev) {
+                ev->temp = strtof(field[2], NULL);
+                ev->hum = strtof(field[3], NULL);
+            }
+        } else if (strcmp(name, "press") == 0 && n == 2) {
+            ev = event_add(t_us, line, EV_PRESS);
+            if (ev) ev = event_add(t_us + SIM_BUTTON_HOLD_US, line, EV_RELEASE);
+        } else if ((strcmp(name, "write") == 0 || strcmp(name, "expect") == 0) && n == 5) {
+            ev = event_add(t_us, line, name[0] == 'w' ? EV_WRITE : EV_EXPECT);
+        } else if (strcmp(name, "dht") == 0 && n == 3) {
+            ev = event_add(t_us, line, EV_DHT);
+        } else if (strcmp(name, "mqtt") == 0 && n == 3 &&
+                   (strcmp(field[2], "up") == 0 || strcmp(field[2], "down") == 0)) {
+            ev = event_add(t_us, line, EV_MQTT);
+        } else if (strcmp(name, "backlog") == 0 && n == 3) {
+            ev = event_add(t_us, line, EV_BACKLOG);
+        } else if (strcmp(name, "console") == 0 && n >= 3) {
+            ev = event_add(t_us, line, EV_CONSOLE);
+            if (ev) ev->argc = n - 2;
+        } else if (strcmp(name, "end") == 0 && n == 2) {
+            ev = event_add(t_us, line, EV_END);
+        } else {
+            ESP_LOGE(TAG, "%s:%d: cannot parse event '%s'", path, line, name);
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        if (!ev) {
+            ESP_LOGE(TAG, "%s:%d: more than %d events", path, line, TRACE_MAX_EVENTS);
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        for (int i = 2; i < n && i - 2 < TRACE_MAX_FIELDS; i++) {
+            snprintf(ev->args[i - 2], TRACE_FIELD_LEN, "%s", field[i]);
+        }
+    }
+    fclose(f);
+    if (err == ESP_OK) qsort(events, event_count, sizeof(events[0]), event_cmp);
+    return err;
+}
+
+void sim_trace_sample(int64_t sim_us, float *temp, float *hum) {
+    const trace_event_t *prev = NULL, *next = NULL;
+    *temp = 25.0f;
+    *hum = 50.0f;
+    for (int i = 0; i < event_count; i++) {
+        if (events[i].kind != EV_TEMP) continue;
+        if (events[i].t_us <= sim_us) {
+            prev = &events[i];
+        } else {
+            next = &events[i];
+            break;
+        }
+    }
+    if (!prev && !next) return;
+    if (!prev || !next) {
+        const trace_event_t *only = prev ? prev : next;
+        *temp = only->temp;
+        *hum = only->hum;
+        return;
+    }
+    float k = (float)(sim_us - prev->t_us) / (float)(next->t_us - prev->t_us);
+    *temp = prev->temp + k * (next->temp - prev->temp);
+    *hum = prev->hum + k * (next->hum - prev->hum);
+}
+
+int sim_trace_run(void) {
+    int failures = 0;
+    int64_t last_us = 0;
+    for (int i = 0; i < event_count; i++) {
+        const trace_event_t *ev = &events[i];
+        sim_sleep_until(ev->t_us);
+        last_us = ev->t_us;
+        switch (ev->kind) {
+        case EV_TEMP:
+            break;
+        case EV_PRESS:
+            ESP_LOGI(TAG, "Button pressed");
+            sim_gpio_button(true);
+            break;
+        case EV_RELEASE:
+            sim_gpio_button(false);
+            break;
+        case EV_WRITE:
+            ESP_LOGI(TAG, "Cloud write %s.%s = %s", ev->args[0], ev->args[1], ev->args[2]);
+            sim_rmaker_write(ev->args[0], ev->args[1], ev->args[2]);
+            break;
+        case EV_EXPECT:
+            if (!sim_rmaker_expect(ev->args[0], ev->args[1], ev->args[2])) failures++;
+            break;
+        case EV_DHT:
+            sim_gpio_dht_fault(ev->args[0]);
+            break;
+        case EV_MQTT:
+            sim_rmaker_mqtt(strcmp(ev->args[0], "up") == 0);
+            break;
+        case EV_BACKLOG: {
+            size_t pending = app_history_pending();
+            if (pending != strtoul(ev->args[0], NULL, 10)) {
+                ESP_LOGE(TAG, "Expected a backlog of %s records, history has %u", ev->args[0], (unsigned)pending);
+                failures++;
+            }
+            break;
+        }
+        case EV_CONSOLE: {
+            char *argv[TRACE_MAX_FIELDS];
+            for (int a = 0; a < ev->argc; a++) argv[a] = (char *)ev->args[a];
+            ESP_LOGI(TAG, "Console: %s", ev->args[0]);
+            if (sim_console_run(ev->argc, argv) != 0) failures++;
+            break;
+        }
+        case EV_END:
+            return failures;
+        }
+    }
+    sim_sleep_until(last_us + 1000000);
+    return failures;
+}
@@ -0,0 +1,50 @@
+/* app_actuators.c - Actuator registry */
+#include <stdio.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_standard_params.h>
+#include "esp_log.h"
+#include "app_actuators.h"
+
+static const char *TAG = "app_actuators";
+
+static const struct {
+    const char *name;
+    const char *type;
+} kinds[APP_ACTUATOR_MAX] = {
+    [APP_ACTUATOR_AC]        = { "Air Conditioner", "esp.device.fan" },
+    [APP_ACTUATOR_WATER]     = { "Fire Water",      "esp.device.switch" },
+    [APP_ACTUATOR_SOUND]     = { "Sound Alarm",     "esp.device.switch" },
+    [APP_ACTUATOR_LED]       = { "Fire LED",        "esp.device.lightbulb" },
+    [APP_ACTUATOR_FAN]       = { "Extractor Fan",   "esp.device.fan" },
+    [APP_ACTUATOR_EMERGENCY] = { "Emergency",       "esp.device.switch" },
+};
+
+esp_err_t app_actuators_create(const esp_rmaker_node_t *node, app_actuator_t actuators[APP_ACTUATOR_MAX],
+                               uint8_t zone, const char *prefix, const int8_t *outputs,
+                               esp_rmaker_device_bulk_write_cb_t write_cb) {
+    char name[48];
+    for (int i = 0; i < APP_ACTUATOR_MAX; i++) {
+        app_actuator_t *a = &actuators[i];
+        *a = (app_actuator_t){
+            .name = kinds[i].name,
+            .zone = zone,
+            .id = (app_actuator_id_t)i,
+            .gpio = outputs ? outputs[i] : -1,
+        };
+        if (prefix) snprintf(name, sizeof(name), "%s %s", prefix, kinds[i].name);
+        else snprintf(name, sizeof(name), "%s", kinds[i].name);
+        /* RainMaker keeps its own copy of the name */
+        a->device = esp_rmaker_device_create(name, kinds[i].type, a);
+        a->power = esp_rmaker_power_param_create("Power", false);
+        if (!a->device || !a->power) {
+            ESP_LOGE(TAG, "Could not create device %s", name);
+            return ESP_ERR_NO_MEM;
+        }
+        esp_rmaker_device_add_bulk_cb(a->device, write_cb, NULL);
+        /* Output state is what the latency budget measures, so it never waits for sensor reports */
+        esp_rmaker_param_add_report_immediate(a->power);
+        esp_rmaker_device_add_param(a->device, a->power);
+        esp_rmaker_node_add_device(node, a->device);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_rmaker_core.h>
+
+typedef enum {
+    APP_ACTUATOR_AC = 0,
+    APP_ACTUATOR_WATER,
+    APP_ACTUATOR_SOUND,
+    APP_ACTUATOR_LED,
+    APP_ACTUATOR_FAN,
+    APP_ACTUATOR_EMERGENCY,
+    APP_ACTUATOR_MAX,
+} app_actuator_id_t;
+
+/* One entry per actuator of a zone, resolved once at startup so that state updates need no
+ * lookups. The entry is the device's priv_data, so write callbacks dispatch through it
+ * directly. The state of every actuator is owned by the control task; see app_control.h. */
+typedef struct {
+    const char *name;               /* Kind of actuator, e.g. "Air Conditioner" */
+    uint8_t zone;
+    app_actuator_id_t id;
+    int gpio;                       /* -1 if the actuator has no output of its own */
+    esp_rmaker_device_t *device;
+    esp_rmaker_param_t *power;
+} app_actuator_t;
+
+/* Creates the RainMaker device and "Power" param of every actuator of a zone and adds them
+ * to the node. Devices are named "<prefix> <kind>", or just "<kind>" without a prefix.
+ * outputs holds a GPIO per app_actuator_id_t (-1 for none) and may be NULL. write_cb
+ * receives the actuator's app_actuator_t as priv_data. */
+esp_err_t app_actuators_create(const esp_rmaker_node_t *node, app_actuator_t actuators[APP_ACTUATOR_MAX],
+                               uint8_t zone, const char *prefix, const int8_t *outputs,
+                               esp_rmaker_device_bulk_write_cb_t write_cb);
@@ -0,0 +1,284 @@
+/* app_control.c - Single-writer actuator state machine.
+ *
+ * Every change to an output goes through one queue into the control task, which applies
+ * the commands in order, publishes the resulting state word of the zone and acks the
+ * sender. Commands for one zone that arrive together are applied as a burst and reported in
+ * one publish by a separate, lower priority reporter task, so actuation never waits for the
+ * network. */
+#include <stdatomic.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_utils.h>
+#include "app_driver.h"
+#include "app_control.h"
+#include "app_latency.h"
+#include "app_zone.h"
+
+static const char *TAG = "app_control";
+
+#define CONTROL_QUEUE_LEN       8
+#define CONTROL_QUEUE_PER_ZONE  2       /* One tick can switch AC and Emergency in every zone */
+#define CONTROL_TASK_PRIO       10      /* Same as the button task: actuation comes first */
+#define CONTROL_TASK_STACK      3072
+#define REPORT_QUEUE_LEN        8
+#define REPORT_TASK_PRIO        3
+#define REPORT_TASK_STACK       4096
+#define CONTROL_ACK_INDEX       1       /* Notification index 0 is left to the tasks' own use */
+
+/* Actuators that follow the Emergency switch; their pins are in app_zone_t.emergency_outputs */
+#define EMERGENCY_GROUP     (APP_CONTROL_BIT(APP_ACTUATOR_EMERGENCY) | APP_CONTROL_BIT(APP_ACTUATOR_WATER) | \
+                             APP_CONTROL_BIT(APP_ACTUATOR_SOUND) | APP_CONTROL_BIT(APP_ACTUATOR_LED) | \
+                             APP_CONTROL_BIT(APP_ACTUATOR_FAN))
+
+typedef struct {
+    app_cmd_t cmd;
+    TaskHandle_t ack_task;      /* NULL when the sender does not wait */
+    uint16_t ack_seq;
+    bool wake;                  /* No command, only wakes the task for pending button presses */
+} control_msg_t;
+
+/* A burst of applied commands, on its way to the cloud */
+typedef struct {
+    uint8_t zone;
+    uint32_t changed;           /* Actuators whose param must be reported */
+    uint32_t state;             /* State word after the burst */
+    int8_t emergency;           /* New Emergency state if it switched, else -1 */
+    uint8_t commands;
+    app_cmd_source_t source;    /* Of the first command */
+    int64_t trigger_us;         /* Of the first command */
+    int64_t actuated_us;        /* Last output written */
+} report_event_t;
+
+static const char *const source_names[APP_CMD_SRC_MAX] = {
+    [APP_CMD_SRC_CLOUD] = "cloud",
+    [APP_CMD_SRC_SCHEDULE] = "schedule",
+    [APP_CMD_SRC_LOCAL] = "local",
+    [APP_CMD_SRC_BUTTON] = "button",
+    [APP_CMD_SRC_AUTO] = "auto",
+};
+
+static QueueHandle_t control_queue;
+static QueueHandle_t report_queue;
+static TaskHandle_t control_task_handle;
+static _Atomic uint32_t state_words[APP_ZONE_MAX];
+static uint16_t ack_seq;
+static portMUX_TYPE ack_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Emergency button presses are counted here rather than queued, so a full queue cannot
+ * lose one; the control task takes them before anything in the queue */
+static struct {
+    uint16_t presses;
+    int64_t trigger_us;         /* Of the oldest press not taken yet */
+} pending[APP_ZONE_MAX];
+static portMUX_TYPE pending_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* The ack carries the sequence number so that a late ack for a command whose sender gave
+ * up cannot be taken for the ack of the next one */
+static inline uint32_t ack_word(uint16_t seq, esp_err_t err) {
+    return ((uint32_t)seq << 16) | (uint16_t)err;
+}
+
+const char *app_control_source_name(app_cmd_source_t source) {
+    return source < APP_CMD_SRC_MAX ? source_names[source] : "?";
+}
+
+uint32_t app_control_snapshot(uint8_t zone) {
+    return zone < APP_ZONE_MAX ? atomic_load_explicit(&state_words[zone], memory_order_acquire) : 0;
+}
+
+/* Drives the outputs for one command and updates the state word. Emergency switches its
+ * whole group in one register write and takes AC down with it; AC cannot come back on
+ * while the emergency is active. */
+static inline uint32_t output_bit(const app_actuator_t *a) {
+    return a->gpio >= 0 ? APP_DRIVER_BIT(a->gpio) : 0;
+}
+
+static esp_err_t control_apply(const app_cmd_t *cmd, uint32_t *state, uint32_t *changed) {
+    app_zone_t *z = app_zone_get(cmd->zone);
+    uint32_t bit = APP_CONTROL_BIT(cmd->id);
+    bool on = (cmd->op == APP_CMD_TOGGLE) ? !(*state & bit) : cmd->on;
+    uint32_t next;
+
+    if (cmd->id == APP_ACTUATOR_EMERGENCY) {
+        if (on) {
+            app_driver_apply(z->emergency_outputs, output_bit(&z->actuators[APP_ACTUATOR_AC]));
+            next = (*state | EMERGENCY_GROUP) & ~APP_CONTROL_BIT(APP_ACTUATOR_AC);
+        } else {
+            app_driver_apply(0, z->emergency_outputs);
+            next = *state & ~EMERGENCY_GROUP;
+        }
+    } else if (cmd->id == APP_ACTUATOR_AC && on && (*state & APP_CONTROL_BIT(APP_ACTUATOR_EMERGENCY))) {
+        /* The sender may already show AC as on; report the real state back */
+        *changed |= bit;
+        return ESP_ERR_INVALID_STATE;
+    } else {
+        uint32_t out = output_bit(&z->actuators[cmd->id]);
+        on ? app_driver_apply(out, 0) : app_driver_apply(0, out);
+        next = on ? (*state | bit) : (*state & ~bit);
+    }
+    *changed |= *state ^ next;
+    *state = next;
+    return ESP_OK;
+}
+
+/* Turns one pending button press into a toggle of its zone's Emergency switch */
+static bool control_take_press(control_msg_t *msg) {
+    bool found = false;
+    portENTER_CRITICAL(&pending_lock);
+    for (unsigned zone = 0; zone < APP_ZONE_MAX && !found; zone++) {
+        if (!pending[zone].presses) continue;
+        *msg = (control_msg_t) {
+            .cmd = {
+                .zone = zone, .id = APP_ACTUATOR_EMERGENCY, .op = APP_CMD_TOGGLE,
+                .source = APP_CMD_SRC_BUTTON, .trigger_us = pending[zone].trigger_us,
+            },
+        };
+        /* Later presses were only counted; they are timed from now on */
+        if (--pending[zone].presses) pending[zone].trigger_us = esp_timer_get_time();
+        found = true;
+    }
+    portEXIT_CRITICAL(&pending_lock);
+    return found;
+}
+
+static void control_task(void *pvParameters) {
+    static uint32_t states[APP_ZONE_MAX];
+    control_msg_t msg, next;
+    while (1) {
+        if (!control_take_press(&msg) &&
+            (xQueueReceive(control_queue, &msg, portMAX_DELAY) != pdPASS || msg.wake)) {
+            continue;
+        }
+        uint8_t zone = msg.cmd.zone;
+        uint32_t state = states[zone];
+        report_event_t ev = {
+            .zone = zone,
+            .emergency = -1,
+            .source = msg.cmd.source,
+            .trigger_us = msg.cmd.trigger_us,
+        };
+        /* Everything already queued for the same zone joins the burst. An emergency transition
+         * ends it, so that each transition gets its own alert. */
+        do {
+            uint32_t before = state;
+            esp_err_t err = control_apply(&msg.cmd, &state, &ev.changed);
+            ev.commands++;
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "%s %s refused: %s", source_names[msg.cmd.source],
+                         esp_rmaker_device_get_name(app_zone_actuator(zone, msg.cmd.id)->device), esp_err_to_name(err));
+            }
+            if ((before ^ state) & APP_CONTROL_BIT(APP_ACTUATOR_EMERGENCY)) {
+                ev.emergency = (state & APP_CONTROL_BIT(APP_ACTUATOR_EMERGENCY)) != 0;
+            }
+            /* Published before the ack, so an acked sender reads its own change */
+            atomic_store_explicit(&state_words[zone], state, memory_order_release);
+            if (msg.ack_task) {
+                xTaskNotifyIndexed(msg.ack_task, CONTROL_ACK_INDEX, ack_word(msg.ack_seq, err), eSetValueWithOverwrite);
+            }
+        } while (ev.emergency < 0 && xQueuePeek(control_queue, &next, 0) == pdPASS && !next.wake &&
+                 next.cmd.zone == zone && xQueueReceive(control_queue, &msg, 0) == pdPASS);
+
+        states[zone] = state;
+        ev.actuated_us = esp_timer_get_time();
+        ev.state = state;
+        if (!ev.changed) continue;
+        if (xQueueSend(report_queue, &ev, 0) != pdPASS) {
+            ESP_LOGW(TAG, "Report queue full, cloud state may lag");
+        }
+    }
+}
+
+/* All params of a burst go out in one publish */
+static void report_task(void *pvParameters) {
+    report_event_t ev;
+    while (1) {
+        if (xQueueReceive(report_queue, &ev, portMAX_DELAY) != pdPASS) continue;
+        int64_t start_us = esp_timer_get_time();
+        esp_rmaker_param_batch_begin();
+        for (int i = 0; i < APP_ACTUATOR_MAX; i++) {
+            app_actuator_t *a = app_zone_actuator(ev.zone, i);
+            if (!(ev.changed & APP_CONTROL_BIT(i)) || !a->power) continue;
+            esp_rmaker_param_update_and_report(a->power, esp_rmaker_bool(ev.state & APP_CONTROL_BIT(i)));
+        }
+        esp_rmaker_param_batch_commit();
+        if (ev.emergency >= 0) {
+            const char *zone_name = app_zone_get(ev.zone)->cfg->name;
+            char alert[64];
+            snprintf(alert, sizeof(alert), "%s%s%s", zone_name ? zone_name : "", zone_name ? ": " : "",
+                     ev.emergency ? "EMERGENCY ACTIVATED!" : "Emergency Deactivated");
+            esp_rmaker_raise_alert(alert);
+        }
+        int64_t done_us = esp_timer_get_time();
+        app_latency_record(ev.source, ev.trigger_us, ev.actuated_us, done_us);
+        ESP_LOGI(TAG, "%u command(s) from %s: actuated %lld us after trigger, queued %lld us, reported in %lld us",
+                 ev.commands, source_names[ev.source], (long long)(ev.actuated_us - ev.trigger_us),
+                 (long long)(start_us - ev.actuated_us), (long long)(done_us - start_us));
+    }
+}
+
+esp_err_t app_control_start(void) {
+    if (!app_zone_count()) return ESP_ERR_INVALID_STATE;
+    control_queue = xQueueCreate(CONTROL_QUEUE_LEN + CONTROL_QUEUE_PER_ZONE * app_zone_count(), sizeof(control_msg_t));
+    report_queue = xQueueCreate(REPORT_QUEUE_LEN, sizeof(report_event_t));
+    if (!control_queue || !report_queue) return ESP_ERR_NO_MEM;
+    if (xTaskCreate(report_task, "ControlReport", REPORT_TASK_STACK, NULL, REPORT_TASK_PRIO, NULL) != pdPASS ||
+        xTaskCreate(control_task, "ControlTask", CONTROL_TASK_STACK, NULL, CONTROL_TASK_PRIO, &control_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_control_submit(const app_cmd_t *cmd, TickType_t ack_timeout) {
+    if (!control_queue) return ESP_ERR_INVALID_STATE;
+    if (cmd->zone >= app_zone_count() || cmd->id >= APP_ACTUATOR_MAX || cmd->source >= APP_CMD_SRC_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    control_msg_t msg = { .cmd = *cmd };
+    if (msg.cmd.trigger_us == 0) msg.cmd.trigger_us = esp_timer_get_time();
+    if (ack_timeout) {
+        if (xTaskGetCurrentTaskHandle() == control_task_handle) return ESP_ERR_INVALID_STATE;
+        msg.ack_task = xTaskGetCurrentTaskHandle();
+        portENTER_CRITICAL(&ack_lock);
+        msg.ack_seq = ++ack_seq;
+        portEXIT_CRITICAL(&ack_lock);
+    }
+    TickType_t start = xTaskGetTickCount();
+    if (xQueueSend(control_queue, &msg, ack_timeout) != pdPASS) {
+        ESP_LOGW(TAG, "Control queue full, %s command dropped", source_names[cmd->source]);
+        return ESP_ERR_TIMEOUT;
+    }
+    if (!ack_timeout) return ESP_OK;
+    while (1) {
+        TickType_t wait = ack_timeout;
+        if (ack_timeout != portMAX_DELAY) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= ack_timeout) return ESP_ERR_TIMEOUT;
+            wait = ack_timeout - elapsed;
+        }
+        uint32_t word;
+        if (xTaskNotifyWaitIndexed(CONTROL_ACK_INDEX, 0, 0, &word, wait) != pdTRUE) return ESP_ERR_TIMEOUT;
+        if ((word >> 16) == msg.ack_seq) return (esp_err_t)(int16_t)(word & 0xffff);
+    }
+}
+
+esp_err_t app_control_press_emergency(uint8_t zone, int64_t trigger_us) {
+    if (!control_queue) return ESP_ERR_INVALID_STATE;
+    if (zone >= app_zone_count()) return ESP_ERR_INVALID_ARG;
+    portENTER_CRITICAL(&pending_lock);
+    if (!pending[zone].presses++) pending[zone].trigger_us = trigger_us ? trigger_us : esp_timer_get_time();
+    portEXIT_CRITICAL(&pending_lock);
+    /* If the queue is full the control task has work and gets to the press anyway */
+    control_msg_t wake = { .wake = true };
+    xQueueSend(control_queue, &wake, 0);
+    return ESP_OK;
+}
+
+esp_err_t app_control_set(uint8_t zone, app_actuator_id_t id, bool on, app_cmd_source_t source, TickType_t ack_timeout) {
+    app_cmd_t cmd = { .zone = zone, .id = id, .op = APP_CMD_SET, .on = on, .source = source };
+    return app_control_submit(&cmd, ack_timeout);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "app_actuators.h"
+
+/* Who asked for a change; only used for logs and latency accounting */
+typedef enum {
+    APP_CMD_SRC_CLOUD = 0,
+    APP_CMD_SRC_SCHEDULE,       /* RainMaker schedules and scenes */
+    APP_CMD_SRC_LOCAL,          /* RainMaker local control */
+    APP_CMD_SRC_BUTTON,
+    APP_CMD_SRC_AUTO,           /* Temperature thresholds */
+    APP_CMD_SRC_MAX,
+} app_cmd_source_t;
+
+typedef enum {
+    APP_CMD_SET = 0,
+    APP_CMD_TOGGLE,             /* Resolved against the state the control task holds */
+} app_cmd_op_t;
+
+typedef struct {
+    uint8_t zone;
+    app_actuator_id_t id;
+    app_cmd_op_t op;
+    bool on;                    /* APP_CMD_SET only */
+    app_cmd_source_t source;
+    int64_t trigger_us;         /* esp_timer time of the stimulus; 0 means now */
+} app_cmd_t;
+
+#define APP_CONTROL_BIT(id)     (1UL << (id))
+
+const char *app_control_source_name(app_cmd_source_t source);
+
+/* Creates the control task, which owns all actuator state and is the only writer of the
+ * outputs, and the reporter task that carries state changes to the cloud. Call after
+ * app_zones_create() and before esp_rmaker_start() so that cloud writes have somewhere
+ * to go. */
+esp_err_t app_control_start(void);
+
+/* Queues a command. With ack_timeout 0 it returns once the command is queued; otherwise it
+ * waits for the control task to apply it and returns the result, e.g. ESP_ERR_INVALID_STATE
+ * when an interlock refused it. Must not be called from the control task itself. */
+esp_err_t app_control_submit(const app_cmd_t *cmd, TickType_t ack_timeout);
+esp_err_t app_control_set(uint8_t zone, app_actuator_id_t id, bool on, app_cmd_source_t source, TickType_t ack_timeout);
+
+/* Toggles the Emergency switch of the zone for a button press. Unlike app_control_submit()
+ * it never drops the press: presses are counted apart from the queue and applied first,
+ * each in its own burst. trigger_us is the esp_timer time of the press; 0 means now. */
+esp_err_t app_control_press_emergency(uint8_t zone, int64_t trigger_us);
+
+/* One bit per actuator of the zone (APP_CONTROL_BIT), updated by the control task after
+ * every command. A single load, so any task can read a consistent view without locking. */
+uint32_t app_control_snapshot(uint8_t zone);
+
+static inline bool app_control_get_state(uint8_t zone, app_actuator_id_t id) {
+    return (app_control_snapshot(zone) & APP_CONTROL_BIT(id)) != 0;
+}
@@ -0,0 +1,69 @@
+/* app_display.c - OLED render task */
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/i2c_master.h"
+#include "esp_log.h"
+#include "ssd1306.h"
+#include "app_driver.h"
+#include "app_display.h"
+
+#define OLED_I2C_ADDRESS            0x3C
+#define OLED_WIDTH                  128
+#define OLED_HEIGHT                 32
+#define DISPLAY_TASK_STACK          3072
+#define DISPLAY_TASK_PRIORITY       1
+
+static const char *TAG = "app_display";
+
+static SSD1306_t oled_dev;
+static QueueHandle_t display_mailbox;
+
+static void display_render(const app_display_model_t *m) {
+    char line[32];
+    snprintf(line, sizeof(line), "T:%.1fC H:%.0f%%", m->temp, m->hum);
+    ssd1306_display_text(&oled_dev, 0, line, strlen(line), false);
+    if (m->emergency) {
+        ssd1306_display_text(&oled_dev, 2, "!! EMERGENCY !!", 15, false);
+    } else {
+        snprintf(line, sizeof(line), "A%d W%d S%d F%d L%d", m->ac, m->water, m->sound, m->fan, m->led);
+        ssd1306_display_text(&oled_dev, 2, line, strlen(line), false);
+    }
+}
+
+static void task_display_render(void *pvParameters) {
+    app_display_model_t model;
+    while (1) {
+        if (xQueueReceive(display_mailbox, &model, portMAX_DELAY) == pdPASS) {
+            display_render(&model);
+            size_t sent = ssd1306_flush(&oled_dev);
+            ESP_LOGD(TAG, "OLED refresh sent %u bytes (%lu total)", (unsigned)sent, (unsigned long)oled_dev.tx_bytes);
+        }
+    }
+}
+
+esp_err_t app_display_init(void) {
+    i2c_master_bus_handle_t bus = app_driver_i2c_bus();
+    if (!bus) return ESP_FAIL;
+    esp_err_t err = ssd1306_init(&oled_dev, bus, OLED_I2C_ADDRESS, OLED_WIDTH, OLED_HEIGHT);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "SSD1306 init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    ssd1306_clear_screen(&oled_dev, false);
+    ssd1306_flush(&oled_dev);
+
+    /* Length-1 queue used as a latest-value mailbox */
+    display_mailbox = xQueueCreate(1, sizeof(app_display_model_t));
+    if (!display_mailbox) return ESP_ERR_NO_MEM;
+    if (xTaskCreate(task_display_render, "DisplayTask", DISPLAY_TASK_STACK, NULL, DISPLAY_TASK_PRIORITY, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void app_display_publish(const app_display_model_t *model) {
+    if (display_mailbox) xQueueOverwrite(display_mailbox, model);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <stdbool.h>
+#include "esp_err.h"
+
+/* Everything the OLED shows. Producers publish a copy; only the render task touches the panel. */
+typedef struct {
+    float temp;
+    float hum;
+    bool ac;
+    bool water;
+    bool sound;
+    bool fan;
+    bool led;
+    bool emergency;
+} app_display_model_t;
+
+esp_err_t app_display_init(void);
+/* Never blocks: replaces any model the render task has not picked up yet */
+void app_display_publish(const app_display_model_t *model);
@@ -1,23 +1,25 @@
 /* app_driver.c - Hardware Driver */
 #include "driver/gpio.h"
+#include "driver/i2c_master.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "soc/gpio_reg.h"
 #include <stdbool.h>
-
-#define AC_GPIO         3
-#define WATER_GPIO      4
-#define SOUND_GPIO      5
-#define FIRE_LED_GPIO   6
-#define FAN_GPIO        7
+#include "app_driver.h"
 
 static const char *TAG = "app_driver";
 
+/* Mirrors the output register for the pins this driver owns */
+static uint32_t out_shadow;
+static uint32_t out_mask = APP_DRIVER_OUTPUTS;
+static portMUX_TYPE out_lock = portMUX_INITIALIZER_UNLOCKED;
+static i2c_master_bus_handle_t i2c_bus;
+
 void app_driver_init()
 {
     gpio_config_t io_conf = {
         .mode = GPIO_MODE_OUTPUT,
-        .pin_bit_mask = (1ULL << AC_GPIO) | (1ULL << WATER_GPIO) | 
-                        (1ULL << SOUND_GPIO) | (1ULL << FIRE_LED_GPIO) | 
-                        (1ULL << FAN_GPIO),
+        .pin_bit_mask = APP_DRIVER_OUTPUTS,
         .intr_type = GPIO_INTR_DISABLE,
         .pull_down_en = 0,
         .pull_up_en = 0,
@@ -27,24 +29,76 @@ void app_driver_init()
     // استخدام TAG لإزالة التحذير
     ESP_LOGI(TAG, "Hardware driver initialized successfully on GPIO 3-7.");
 
-    gpio_set_level(AC_GPIO, 0);
-    gpio_set_level(WATER_GPIO, 0);
-    gpio_set_level(SOUND_GPIO, 0);
-    gpio_set_level(FIRE_LED_GPIO, 0);
-    gpio_set_level(FAN_GPIO, 0);
+    app_driver_apply(0, APP_DRIVER_OUTPUTS);
 }
 
-void app_driver_set_ac(bool state) { gpio_set_level(AC_GPIO, state); }
-void app_driver_set_water(bool state) { gpio_set_level(WATER_GPIO, state); }
-void app_driver_set_sound(bool state) { gpio_set_level(SOUND_GPIO, state); }
-void app_driver_set_fire_led(bool state) { gpio_set_level(FIRE_LED_GPIO, state); }
-void app_driver_set_fan(bool state) { gpio_set_level(FAN_GPIO, state); }
+/* All outputs sit below GPIO 32, so one W1TS and one W1TC store cover them. The lock keeps
+ * the shadow and the pins in step when several tasks switch outputs. */
+void app_driver_apply(uint32_t set_mask, uint32_t clear_mask) {
+    set_mask &= out_mask;
+    clear_mask &= out_mask & ~set_mask;
+    portENTER_CRITICAL(&out_lock);
+    REG_WRITE(GPIO_OUT_W1TC_REG, clear_mask);
+    REG_WRITE(GPIO_OUT_W1TS_REG, set_mask);
+    out_shadow = (out_shadow & ~clear_mask) | set_mask;
+    portEXIT_CRITICAL(&out_lock);
+}
+
+esp_err_t app_driver_add_outputs(uint32_t mask) {
+    mask &= ~out_mask;
+    if (!mask) return ESP_OK;
+    gpio_config_t io_conf = {
+        .mode = GPIO_MODE_OUTPUT,
+        .pin_bit_mask = mask,
+        .intr_type = GPIO_INTR_DISABLE,
+        .pull_down_en = 0,
+        .pull_up_en = 0,
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err != ESP_OK) return err;
+    portENTER_CRITICAL(&out_lock);
+    out_mask |= mask;
+    portEXIT_CRITICAL(&out_lock);
+    app_driver_apply(0, mask);
+    return ESP_OK;
+}
+
+uint32_t app_driver_get_outputs(void) {
+    return out_shadow;
+}
+
+static void app_driver_set_one(int gpio, bool state) {
+    state ? app_driver_apply(APP_DRIVER_BIT(gpio), 0) : app_driver_apply(0, APP_DRIVER_BIT(gpio));
+}
+
+void app_driver_set_ac(bool state) { app_driver_set_one(AC_GPIO, state); }
+void app_driver_set_water(bool state) { app_driver_set_one(WATER_GPIO, state); }
+void app_driver_set_sound(bool state) { app_driver_set_one(SOUND_GPIO, state); }
+void app_driver_set_fire_led(bool state) { app_driver_set_one(FIRE_LED_GPIO, state); }
+void app_driver_set_fan(bool state) { app_driver_set_one(FAN_GPIO, state); }
 
 // Compatibility Wrapper
 void app_driver_set_alarm(bool state) {
-    app_driver_set_sound(state);
-    app_driver_set_fire_led(state);
+    uint32_t mask = APP_DRIVER_BIT(SOUND_GPIO) | APP_DRIVER_BIT(FIRE_LED_GPIO);
+    state ? app_driver_apply(mask, 0) : app_driver_apply(0, mask);
 }
 
-float app_driver_get_temp() { return 0.0; }
-float app_driver_get_humidity() { return 0.0; }
\ No newline at end of file
+/* Asynchronous, so that OLED page flushes do not hold up the sensors sharing the bus */
+i2c_master_bus_handle_t app_driver_i2c_bus(void) {
+    if (i2c_bus) return i2c_bus;
+    i2c_master_bus_config_t bus_cfg = {
+        .i2c_port = I2C_BUS_PORT,
+        .sda_io_num = I2C_BUS_SDA_GPIO,
+        .scl_io_num = I2C_BUS_SCL_GPIO,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .trans_queue_depth = I2C_BUS_QUEUE_DEPTH,
+        .flags.enable_internal_pullup = true,
+    };
+    esp_err_t err = i2c_new_master_bus(&bus_cfg, &i2c_bus);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "I2C bus init failed: %s", esp_err_to_name(err));
+        i2c_bus = NULL;
+    }
+    return i2c_bus;
+}
\ No newline at end of file
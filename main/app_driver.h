@@ -1,13 +1,41 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+
+#define AC_GPIO         3
+#define WATER_GPIO      4
+#define SOUND_GPIO      5
+#define FIRE_LED_GPIO   6
+#define FAN_GPIO        7
+
+/* I2C bus shared by the OLED and I2C sensors */
+#define I2C_BUS_PORT        0
+#define I2C_BUS_SCL_GPIO    8
+#define I2C_BUS_SDA_GPIO    20
+#define I2C_BUS_QUEUE_DEPTH 8       /* >= SSD1306_MAX_PAGES */
+
+#define APP_DRIVER_BIT(gpio)    (1UL << (gpio))
+/* Outputs of the default board, claimed and driven low by app_driver_init() */
+#define APP_DRIVER_OUTPUTS      (APP_DRIVER_BIT(AC_GPIO) | APP_DRIVER_BIT(WATER_GPIO) | APP_DRIVER_BIT(SOUND_GPIO) | \
+                                 APP_DRIVER_BIT(FIRE_LED_GPIO) | APP_DRIVER_BIT(FAN_GPIO))
 
 // تعريف الدوال الموجودة في app_driver.c
 void app_driver_init(void);
+/* Claims further output pins (below GPIO 32) and drives them low */
+esp_err_t app_driver_add_outputs(uint32_t mask);
+/* Drives every output in set_mask high and every output in clear_mask low with back-to-back
+ * writes to the GPIO set/clear registers. Bits of pins not claimed as outputs are ignored
+ * and a bit in both masks ends up set. */
+void app_driver_apply(uint32_t set_mask, uint32_t clear_mask);
+/* Output levels as last written, from the shadow register; no peripheral access */
+uint32_t app_driver_get_outputs(void);
 void app_driver_set_ac(bool state);
 void app_driver_set_water(bool state);
 void app_driver_set_sound(bool state);
 void app_driver_set_fire_led(bool state);
 void app_driver_set_fan(bool state);
 void app_driver_set_alarm(bool state); // دالة التوافق
-float app_driver_get_temp(void);
-float app_driver_get_humidity(void);
\ No newline at end of file
+/* Creates the shared I2C bus on first use; NULL if it could not be created */
+i2c_master_bus_handle_t app_driver_i2c_bus(void);
\ No newline at end of file
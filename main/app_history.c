@@ -0,0 +1,253 @@
+/* app_history.c - Flash ring log of sensor history for offline periods.
+ *
+ * Every sector starts with a {magic, seq} header followed by fixed-size records. The sector
+ * with the highest seq is the head, and the ring continues at the next index, so the
+ * oldest data is always in the sector after the head. A record's flag byte is 0xFF while
+ * the slot is free, HIST_FLAG_PENDING | zone once written and plain zone once uploaded.
+ * Both steps only clear bits, so neither needs an erase; this relies on the partition not
+ * being encrypted. */
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "app_history.h"
+
+static const char *TAG = "app_history";
+
+#define HIST_MAGIC          0x31545348  /* "HST1" */
+#define HIST_FLAG_PENDING   0x80
+#define HIST_FLAG_RESERVED  0x60        /* Written as 0, so a torn write shows up here */
+#define HIST_ZONE_MASK      0x1f
+#define HIST_CHUNK          32          /* Records per flash access */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+} hist_sector_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t time;
+    int16_t temp_centi;
+    uint8_t hum_half;
+    uint8_t flags;
+} hist_record_t;
+
+typedef struct {
+    uint16_t sector;
+    uint16_t slot;              /* slots_per_sector past the last record */
+} hist_pos_t;
+
+static const esp_partition_t *part;
+static uint16_t sector_count;
+static uint16_t slots_per_sector;
+static uint32_t head_seq;
+static hist_pos_t head;         /* Next free slot */
+static hist_pos_t tail;         /* No pending record before this */
+static hist_pos_t peek_end;
+static bool peek_valid;
+static app_history_stats_t stats;
+
+static bool pos_equal(hist_pos_t a, hist_pos_t b) {
+    return a.sector == b.sector && a.slot == b.slot;
+}
+
+static size_t slot_offset(hist_pos_t pos) {
+    return (size_t)pos.sector * part->erase_size + sizeof(hist_sector_header_t) +
+           (size_t)pos.slot * sizeof(hist_record_t);
+}
+
+static bool record_free(const hist_record_t *r) {
+    const uint8_t *b = (const uint8_t *)r;
+    for (size_t i = 0; i < sizeof(*r); i++) {
+        if (b[i] != 0xff) return false;
+    }
+    return true;
+}
+
+static bool record_pending(const hist_record_t *r) {
+    return (r->flags & HIST_FLAG_PENDING) && !(r->flags & HIST_FLAG_RESERVED);
+}
+
+static void record_decode(const hist_record_t *r, app_history_record_t *out) {
+    out->time = r->time;
+    out->zone = r->flags & HIST_ZONE_MASK;
+    out->temp = r->temp_centi / 100.0f;
+    out->hum = r->hum_half / 2.0f;
+}
+
+/* Visits the records in [*pos, end) in ring order and stops early once max pending ones
+ * were seen. Pending records are decoded into out if it is not NULL, and marked uploaded
+ * if clear is set. Leaves *pos after the last record visited and returns the number of
+ * pending records seen. */
+static size_t walk(hist_pos_t *pos, hist_pos_t end, size_t max, app_history_record_t *out, bool clear) {
+    hist_record_t buf[HIST_CHUNK];
+    size_t n = 0;
+    while (n < max && !pos_equal(*pos, end)) {
+        if (pos->slot == slots_per_sector) {
+            pos->sector = (pos->sector + 1) % sector_count;
+            pos->slot = 0;
+            continue;
+        }
+        uint16_t last = pos->sector == end.sector ? end.slot : slots_per_sector;
+        uint16_t count = last - pos->slot < HIST_CHUNK ? last - pos->slot : HIST_CHUNK;
+        size_t offset = slot_offset(*pos);
+        if (esp_partition_read(part, offset, buf, count * sizeof(buf[0])) != ESP_OK) break;
+        uint16_t visited = 0;
+        size_t seen = 0;
+        while (visited < count && n + seen < max) {
+            hist_record_t *r = &buf[visited++];
+            if (!record_pending(r)) continue;
+            if (out) record_decode(r, &out[n + seen]);
+            if (clear) r->flags &= ~HIST_FLAG_PENDING;
+            seen++;
+        }
+        if (clear && seen && esp_partition_write(part, offset, buf, visited * sizeof(buf[0])) != ESP_OK) break;
+        n += seen;
+        pos->slot += visited;
+    }
+    return n;
+}
+
+static uint16_t first_free_slot(uint16_t sector) {
+    hist_record_t buf[HIST_CHUNK];
+    for (hist_pos_t pos = { sector, 0 }; pos.slot < slots_per_sector; pos.slot += HIST_CHUNK) {
+        uint16_t count = slots_per_sector - pos.slot < HIST_CHUNK ? slots_per_sector - pos.slot : HIST_CHUNK;
+        if (esp_partition_read(part, slot_offset(pos), buf, count * sizeof(buf[0])) != ESP_OK) break;
+        for (uint16_t i = 0; i < count; i++) {
+            if (record_free(&buf[i])) return pos.slot + i;
+        }
+    }
+    return slots_per_sector;
+}
+
+static esp_err_t open_next_sector(void) {
+    hist_pos_t next = { (head.sector + 1) % sector_count, 0 };
+    /* A full ring loses the oldest sector, with whatever was not uploaded from it */
+    if (stats.pending && tail.sector == next.sector) {
+        hist_pos_t pos = tail;
+        size_t lost = 0;
+        if (pos.slot < slots_per_sector) {
+            lost = walk(&pos, (hist_pos_t){ next.sector, slots_per_sector }, SIZE_MAX, NULL, false);
+        }
+        stats.pending -= lost;
+        stats.dropped += lost;
+        tail = (hist_pos_t){ (next.sector + 1) % sector_count, 0 };
+        peek_valid = false;
+        if (lost) ESP_LOGW(TAG, "History full, %u records dropped", (unsigned)lost);
+    }
+    esp_err_t err = esp_partition_erase_range(part, (size_t)next.sector * part->erase_size, part->erase_size);
+    if (err != ESP_OK) return err;
+    stats.erases++;
+    hist_sector_header_t hdr = { .magic = HIST_MAGIC, .seq = ++head_seq };
+    err = esp_partition_write(part, (size_t)next.sector * part->erase_size, &hdr, sizeof(hdr));
+    if (err != ESP_OK) return err;
+    head = next;
+    if (!stats.pending) tail = head;
+    return ESP_OK;
+}
+
+esp_err_t app_history_init(void) {
+    const esp_partition_t *p = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, APP_HISTORY_PARTITION_SUBTYPE,
+                                                        APP_HISTORY_PARTITION_LABEL);
+    if (!p) {
+        ESP_LOGW(TAG, "No %s partition, offline history disabled", APP_HISTORY_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (p->size / p->erase_size < 2) return ESP_ERR_INVALID_SIZE;
+    part = p;
+    sector_count = p->size / p->erase_size;
+    slots_per_sector = (p->erase_size - sizeof(hist_sector_header_t)) / sizeof(hist_record_t);
+
+    bool found = false;
+    for (uint16_t s = 0; s < sector_count; s++) {
+        hist_sector_header_t hdr;
+        if (esp_partition_read(p, (size_t)s * p->erase_size, &hdr, sizeof(hdr)) != ESP_OK) continue;
+        if (hdr.magic != HIST_MAGIC || hdr.seq == UINT32_MAX) continue;
+        if (!found || hdr.seq > head_seq) {
+            head_seq = hdr.seq;
+            head.sector = s;
+            found = true;
+        }
+    }
+    if (!found) {
+        /* Blank partition: the first append opens sector 0 */
+        head = (hist_pos_t){ sector_count - 1, slots_per_sector };
+        tail = head;
+    } else {
+        head.slot = first_free_slot(head.sector);
+        /* The oldest sector is the first written one after the head */
+        tail = (hist_pos_t){ (head.sector + 1) % sector_count, 0 };
+        while (tail.sector != head.sector) {
+            hist_sector_header_t hdr;
+            if (esp_partition_read(p, (size_t)tail.sector * p->erase_size, &hdr, sizeof(hdr)) == ESP_OK &&
+                hdr.magic == HIST_MAGIC) {
+                break;
+            }
+            tail.sector = (tail.sector + 1) % sector_count;
+        }
+        hist_pos_t pos = tail;
+        stats.pending = walk(&pos, head, SIZE_MAX, NULL, false);
+    }
+    stats.capacity = (uint32_t)sector_count * slots_per_sector;
+    ESP_LOGI(TAG, "History: %lu of %lu records pending upload", (unsigned long)stats.pending,
+             (unsigned long)stats.capacity);
+    return ESP_OK;
+}
+
+bool app_history_ready(void) {
+    return part != NULL;
+}
+
+esp_err_t app_history_append(const app_history_record_t *rec) {
+    if (!part) return ESP_ERR_INVALID_STATE;
+    if (rec->zone > HIST_ZONE_MASK) return ESP_ERR_INVALID_ARG;
+    if (head.slot == slots_per_sector) {
+        esp_err_t err = open_next_sector();
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Cannot open a history sector: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+    long temp = lroundf(rec->temp * 100.0f);
+    long hum = lroundf(rec->hum * 2.0f);
+    hist_record_t r = {
+        .time = rec->time,
+        .temp_centi = temp < INT16_MIN ? INT16_MIN : temp > INT16_MAX ? INT16_MAX : temp,
+        .hum_half = hum < 0 ? 0 : hum > 200 ? 200 : hum,
+        .flags = HIST_FLAG_PENDING | rec->zone,
+    };
+    esp_err_t err = esp_partition_write(part, slot_offset(head), &r, sizeof(r));
+    /* A failed write may have left part of the record behind; the slot is skipped either way */
+    head.slot++;
+    if (err != ESP_OK) return err;
+    stats.pending++;
+    stats.appended++;
+    return ESP_OK;
+}
+
+size_t app_history_pending(void) {
+    return stats.pending;
+}
+
+size_t app_history_peek(app_history_record_t *out, size_t max) {
+    peek_valid = false;
+    if (!part) return 0;
+    peek_end = tail;
+    size_t n = walk(&peek_end, head, max, out, false);
+    peek_valid = true;
+    return n;
+}
+
+esp_err_t app_history_consume(void) {
+    if (!part || !peek_valid) return ESP_ERR_INVALID_STATE;
+    peek_valid = false;
+    size_t n = walk(&tail, peek_end, SIZE_MAX, NULL, true);
+    stats.pending -= n;
+    stats.uploaded += n;
+    return pos_equal(tail, peek_end) ? ESP_OK : ESP_FAIL;
+}
+
+void app_history_get_stats(app_history_stats_t *out) {
+    *out = stats;
+}
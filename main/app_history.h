@@ -0,0 +1,46 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/* Sensor history kept in flash while the cloud cannot be reached.
+ *
+ * An append-only ring of fixed-size records on the "history" data partition. Sectors are
+ * erased in turn, so wear spreads evenly over the partition; when the ring is full the
+ * oldest sector is erased, and any records in it that were never uploaded are lost.
+ * Uploaded records are marked in place by clearing one bit, so the backlog survives a
+ * reboot without a separate cursor in NVS.
+ *
+ * Not thread safe: call everything from the controller task. */
+
+#define APP_HISTORY_PARTITION_LABEL     "history"
+#define APP_HISTORY_PARTITION_SUBTYPE   0x40
+
+typedef struct {
+    uint32_t time;              /* Epoch seconds */
+    uint8_t zone;               /* Index in the zone table, below 32 */
+    float temp;                 /* Stored to 0.01 C */
+    float hum;                  /* Stored to 0.5 %RH */
+} app_history_record_t;
+
+typedef struct {
+    uint32_t capacity;          /* Records the partition holds */
+    uint32_t pending;           /* Appended but not uploaded yet */
+    uint32_t appended;          /* Since boot */
+    uint32_t uploaded;
+    uint32_t dropped;           /* Overwritten before upload */
+    uint32_t erases;
+} app_history_stats_t;
+
+/* Finds the partition and recovers the ring from it. Returns ESP_ERR_NOT_FOUND if the
+ * partition table has no history partition; the other calls then do nothing. */
+esp_err_t app_history_init(void);
+bool app_history_ready(void);
+esp_err_t app_history_append(const app_history_record_t *rec);
+size_t app_history_pending(void);
+/* Copies up to max of the oldest pending records to out, oldest first */
+size_t app_history_peek(app_history_record_t *out, size_t max);
+/* Marks the records returned by the last app_history_peek() as uploaded */
+esp_err_t app_history_consume(void);
+void app_history_get_stats(app_history_stats_t *out);
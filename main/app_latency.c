@@ -0,0 +1,191 @@
+/* app_latency.c - Stimulus-to-response latency histograms and the latency budget alert.
+ *
+ * Samples are recorded by the control reporter task and read by the console and the
+ * controller tick; a short critical section around the counters is all they share. */
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_console.h"
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_standard_types.h>
+#include "app_latency.h"
+
+static const char *TAG = "app_latency";
+
+#define LATENCY_REPORT_MS       60000
+#define LATENCY_JSON_MAX        512
+
+typedef struct {
+    uint32_t buckets[APP_LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t max_us;
+} latency_hist_t;
+
+static latency_hist_t hists[APP_CMD_SRC_MAX][APP_LATENCY_STAGE_MAX];
+static uint32_t over_budget;
+static uint32_t budget_us;
+static uint32_t recorded;           /* Bumped by every record, to tell when to publish */
+static uint32_t published;
+static int64_t published_us;
+static int64_t alerted_us;
+static bool alerted;
+static esp_rmaker_param_t *latency_param;
+static portMUX_TYPE latency_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int bucket_of(uint32_t us) {
+    int b = 0;
+    while (us > 1 && b < APP_LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static void hist_add(latency_hist_t *h, int64_t us) {
+    uint32_t v = us < 0 ? 0 : us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+    h->buckets[bucket_of(v)]++;
+    h->count++;
+    if (v > h->max_us) h->max_us = v;
+}
+
+static uint32_t hist_percentile(const latency_hist_t *h, uint32_t per_mille) {
+    uint32_t rank = (uint32_t)(((uint64_t)h->count * per_mille + 999) / 1000);
+    uint32_t seen = 0;
+    for (int b = 0; b < APP_LATENCY_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            /* The last bucket is open ended, so only the maximum bounds it */
+            if (b == APP_LATENCY_BUCKETS - 1) return h->max_us;
+            uint32_t upper = (2UL << b) - 1;
+            return upper < h->max_us ? upper : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+void app_latency_record(app_cmd_source_t source, int64_t trigger_us, int64_t actuated_us, int64_t notified_us) {
+    if (source >= APP_CMD_SRC_MAX) return;
+    int64_t actuate_us = actuated_us - trigger_us;
+    bool alert = false;
+    portENTER_CRITICAL(&latency_lock);
+    hist_add(&hists[source][APP_LATENCY_ACTUATE], actuate_us);
+    hist_add(&hists[source][APP_LATENCY_NOTIFY], notified_us - trigger_us);
+    recorded++;
+    if (budget_us && actuate_us > budget_us) {
+        over_budget++;
+        if (!alerted || notified_us - alerted_us >= (int64_t)APP_LATENCY_ALERT_HOLDOFF_MS * 1000) {
+            alerted = true;
+            alerted_us = notified_us;
+            alert = true;
+        }
+    }
+    portEXIT_CRITICAL(&latency_lock);
+    if (!alert) return;
+
+    char text[96];
+    snprintf(text, sizeof(text), "Slow response: %s command actuated after %lu ms (budget %lu ms)",
+             app_control_source_name(source), (unsigned long)(actuate_us / 1000), (unsigned long)(budget_us / 1000));
+    ESP_LOGW(TAG, "%s", text);
+    esp_rmaker_raise_alert(text);
+}
+
+void app_latency_get(app_cmd_source_t source, app_latency_stage_t stage, app_latency_summary_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (source >= APP_CMD_SRC_MAX || stage >= APP_LATENCY_STAGE_MAX) return;
+    latency_hist_t h;
+    portENTER_CRITICAL(&latency_lock);
+    h = hists[source][stage];
+    portEXIT_CRITICAL(&latency_lock);
+    out->count = h.count;
+    out->max_us = h.max_us;
+    if (!h.count) return;
+    out->p50_us = hist_percentile(&h, 500);
+    out->p99_us = hist_percentile(&h, 990);
+}
+
+uint32_t app_latency_over_budget(void) {
+    portENTER_CRITICAL(&latency_lock);
+    uint32_t n = over_budget;
+    portEXIT_CRITICAL(&latency_lock);
+    return n;
+}
+
+/* {"budget_ms":250,"over":0,"button":{"n":3,"act":[p50,p99,max],"notify":[p50,p99,max]},...}
+ * in microseconds, sources without samples left out */
+static int latency_json(char *buf, size_t len) {
+    int n = snprintf(buf, len, "{\"budget_ms\":%lu,\"over\":%lu", (unsigned long)(budget_us / 1000),
+                     (unsigned long)app_latency_over_budget());
+    for (int src = 0; src < APP_CMD_SRC_MAX && n < (int)len; src++) {
+        app_latency_summary_t act, notify;
+        app_latency_get(src, APP_LATENCY_ACTUATE, &act);
+        if (!act.count) continue;
+        app_latency_get(src, APP_LATENCY_NOTIFY, &notify);
+        n += snprintf(buf + n, len - n, ",\"%s\":{\"n\":%lu,\"act\":[%lu,%lu,%lu],\"notify\":[%lu,%lu,%lu]}",
+                      app_control_source_name(src), (unsigned long)act.count,
+                      (unsigned long)act.p50_us, (unsigned long)act.p99_us, (unsigned long)act.max_us,
+                      (unsigned long)notify.p50_us, (unsigned long)notify.p99_us, (unsigned long)notify.max_us);
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - n, "}");
+    return n;
+}
+
+void app_latency_publish(int64_t now_us) {
+    if (!latency_param) return;
+    uint32_t seen = recorded;
+    if (seen == published) return;
+    if (published_us && now_us - published_us < (int64_t)LATENCY_REPORT_MS * 1000) return;
+    char buf[LATENCY_JSON_MAX];
+    if (latency_json(buf, sizeof(buf)) >= (int)sizeof(buf)) {
+        ESP_LOGW(TAG, "Latency summary truncated");
+        return;
+    }
+    published = seen;
+    published_us = now_us;
+    esp_rmaker_param_update_and_report(latency_param, esp_rmaker_str(buf));
+}
+
+static int latency_cmd(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        portENTER_CRITICAL(&latency_lock);
+        memset(hists, 0, sizeof(hists));
+        over_budget = 0;
+        portEXIT_CRITICAL(&latency_lock);
+        printf("Latency histograms cleared\n");
+        return 0;
+    }
+    printf("Latency budget %lu ms, %lu actuation(s) over it\n", (unsigned long)(budget_us / 1000),
+           (unsigned long)app_latency_over_budget());
+    printf("%-9s %6s  %10s %10s %10s  %10s %10s %10s\n", "source", "n", "act p50", "act p99", "act max",
+           "cloud p50", "cloud p99", "cloud max");
+    for (int src = 0; src < APP_CMD_SRC_MAX; src++) {
+        app_latency_summary_t act, notify;
+        app_latency_get(src, APP_LATENCY_ACTUATE, &act);
+        if (!act.count) continue;
+        app_latency_get(src, APP_LATENCY_NOTIFY, &notify);
+        printf("%-9s %6lu  %10lu %10lu %10lu  %10lu %10lu %10lu\n", app_control_source_name(src),
+               (unsigned long)act.count, (unsigned long)act.p50_us, (unsigned long)act.p99_us,
+               (unsigned long)act.max_us, (unsigned long)notify.p50_us, (unsigned long)notify.p99_us,
+               (unsigned long)notify.max_us);
+    }
+    printf("Times in us; percentiles are bucket upper bounds\n");
+    return 0;
+}
+
+esp_err_t app_latency_init(const esp_rmaker_node_t *node, uint32_t budget_ms) {
+    budget_us = budget_ms * 1000;
+    esp_rmaker_device_t *device = esp_rmaker_device_create("Diagnostics", "esp.device.other", NULL);
+    latency_param = esp_rmaker_param_create("Latency", "esp.param.latency", esp_rmaker_str("{}"), PROP_FLAG_READ);
+    if (!device || !latency_param) return ESP_ERR_NO_MEM;
+    esp_rmaker_param_add_ui_type(latency_param, ESP_RMAKER_UI_TEXT);
+    esp_rmaker_device_add_param(device, latency_param);
+    esp_rmaker_node_add_device(node, device);
+
+    const esp_console_cmd_t cmd = {
+        .command = "latency",
+        .help = "Stimulus-to-output and stimulus-to-cloud latency per command source. Usage: latency [reset]",
+        .func = &latency_cmd,
+    };
+    if (esp_console_cmd_register(&cmd) != ESP_OK) ESP_LOGW(TAG, "Console command %s not registered", cmd.command);
+    return ESP_OK;
+}
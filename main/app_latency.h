@@ -0,0 +1,44 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_rmaker_core.h>
+#include "esp_err.h"
+#include "app_control.h"
+
+/* Latency of the stimulus-to-response path, per command source.
+ *
+ * The stimulus is the trigger_us of the first command of a burst: the decoded sample that
+ * tipped a rule, the button interrupt or the arrival of a cloud write. From there two
+ * times are kept in log2 histograms: until the outputs are written, and until the cloud
+ * report and any alert have been handed to MQTT. An actuation slower than the budget
+ * raises an alert, at most one per APP_LATENCY_ALERT_HOLDOFF_MS.
+ *
+ * Read with the `latency` console command, or the Latency param of the Diagnostics
+ * device. */
+
+#define APP_LATENCY_BUCKETS             24      /* [2^i, 2^(i+1)) us; the last one is open ended */
+#define APP_LATENCY_ALERT_HOLDOFF_MS    60000
+
+typedef enum {
+    APP_LATENCY_ACTUATE = 0,    /* Stimulus to outputs written */
+    APP_LATENCY_NOTIFY,         /* Stimulus to report and alert queued for the cloud */
+    APP_LATENCY_STAGE_MAX,
+} app_latency_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t p50_us;            /* Upper bound of the bucket holding the percentile */
+    uint32_t p99_us;
+    uint32_t max_us;
+} app_latency_summary_t;
+
+/* Creates the Diagnostics device and registers the console command, so the console must be
+ * up already. budget_ms 0 turns the alert off. */
+esp_err_t app_latency_init(const esp_rmaker_node_t *node, uint32_t budget_ms);
+/* Called by the control reporter once per burst. Raises the budget alert if due. */
+void app_latency_record(app_cmd_source_t source, int64_t trigger_us, int64_t actuated_us, int64_t notified_us);
+void app_latency_get(app_cmd_source_t source, app_latency_stage_t stage, app_latency_summary_t *out);
+uint32_t app_latency_over_budget(void);
+/* Updates the Latency param, at most once a minute and only if something was recorded.
+ * Called from the controller tick. */
+void app_latency_publish(int64_t now_us);
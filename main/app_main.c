@@ -3,12 +3,11 @@
 #include <stdio.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
 #include "freertos/queue.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "driver/gpio.h"
-#include "driver/i2c.h"
+#include "esp_timer.h"
 /* مكتبات RainMaker والشبكة */
 #include <esp_rmaker_core.h>
 #include <esp_rmaker_standard_types.h> 
@@ -20,196 +19,225 @@
 /* تم إزالة app_insights.h */
 
 /* المكتبات المحلية */
-#include "ssd1306.h"
-#include "dht11.h"
+#include "app_display.h"
+#include "app_actuators.h"
+#include "app_control.h"
+#include "app_sensor.h"
+#include "app_zone.h"
+#include "app_rules.h"
+#include "app_history.h"
+#include "app_latency.h"
+#include "sensor_sched.h"
+#include "dht.h"
+#include "sht3x.h"
 #include "app_driver.h"
 
 static const char *TAG = "SmartHome";
 
 /* تعريفات الأرجل */
-#define I2C_MASTER_SCL_IO           8
-#define I2C_MASTER_SDA_IO           20
-#define I2C_MASTER_NUM              I2C_NUM_0
-#define I2C_MASTER_FREQ_HZ          400000
 #define DHT11_GPIO                  2
 #define BTN_EMERGENCY_GPIO          10
+#define BTN_DEBOUNCE_MS             50
 #define SENSOR_READ_INTERVAL_MS     10000
-#define AC_ON_TEMP                  27.0f
-#define AC_OFF_TEMP                 26.0f
-#define ALARM_ON_TEMP               30.0f
-#define ALARM_OFF_TEMP              29.0f
+#define SENSOR_STALE_MS             (3 * SENSOR_READ_INTERVAL_MS)   /* A point older than this is ignored */
+#define SENSOR_JITTER_LOG_SAMPLES   30      /* Log the sample period statistics every 30 samples per sensor */
+#define CONTROLLER_TICK_MS          5000    /* Zones are evaluated at least this often, so stale points age out */
+#define BTN_EMERGENCY_ZONE          0
+
+/* Rules in effect until the "Rules" param of the Controller device is written; see
+ * app_rules.h. AC on at 27 C, off at 26 C. Emergency at 30 C or a rise of 8 C/min
+ * (rate-of-rise heat detector class, ~15 F/min), cleared below 29 C once the rise has
+ * levelled off under 1 C/min. */
+#define DEFAULT_RULES   "temp>=27/1:ac; maxtemp>=30/1:emergency; rise>=8/7:emergency"
+
+/* Temperature points of the room. Parts that do not answer at boot are left out, so the
+ * same table serves boards with and without the I2C sensor. I2C parts share the OLED bus. */
+static sensor_dev_t sensors[] = {
+    { .name = "DHT", .driver = &dht11_driver, .gpio = DHT11_GPIO, .interval_ms = SENSOR_READ_INTERVAL_MS },
+    { .name = "SHT", .driver = &sht3x_driver, .i2c_addr = SHT3X_I2C_ADDR_DEFAULT, .interval_ms = SENSOR_READ_INTERVAL_MS },
+};
+#define SENSOR_COUNT    (sizeof(sensors) / sizeof(sensors[0]))
+
+/* Rooms served by this node. The board has a single room; it keeps the unprefixed device
+ * names so that existing schedules and scenes still match. More rooms are more rows, each
+ * with its own slice of the sensor table and, if they drive pins here, an output map. */
+static const int8_t room_outputs[APP_ACTUATOR_MAX] = {
+    [APP_ACTUATOR_AC] = AC_GPIO,
+    [APP_ACTUATOR_WATER] = WATER_GPIO,
+    [APP_ACTUATOR_SOUND] = SOUND_GPIO,
+    [APP_ACTUATOR_LED] = FIRE_LED_GPIO,
+    [APP_ACTUATOR_FAN] = FAN_GPIO,
+    [APP_ACTUATOR_EMERGENCY] = -1,
+};
+
+static const app_zone_config_t zone_table[] = {
+    {
+        .name = NULL, .outputs = room_outputs,
+        .first_sensor = 0, .sensor_count = SENSOR_COUNT, .stale_ms = SENSOR_STALE_MS,
+    },
+};
+#define ZONE_COUNT      (sizeof(zone_table) / sizeof(zone_table[0]))
 
 /* متغيرات النظام */
-static SemaphoreHandle_t xOLEDMutex;
-static QueueHandle_t xSensorDataQueue;
-static SSD1306_t oled_dev; 
-#define MAX_QUEUE_SIZE 5
+static sensor_ring_t sensor_ring;
+static sensor_jitter_t sensor_jitter[SENSOR_COUNT];
+static TaskHandle_t xControllerTask;
+static TaskHandle_t xEmergencyTask;
+static esp_timer_handle_t btn_debounce_timer;
+static volatile int64_t btn_isr_time_us;
 
-typedef struct { float temp; float hum; } sensor_data_t;
-
-bool ac_state = false;
-bool water_state = false;
-bool sound_state = false;
-bool led_state = false;
-bool fan_state = false;
-bool emergency_state = false; 
+/* --- دوال الهاردوير --- */
+/* Acts on the first falling edge, then masks the pin until the debounce timer re-arms it */
+static void IRAM_ATTR btn_emergency_isr(void *arg) {
+    BaseType_t woken = pdFALSE;
+    gpio_intr_disable(BTN_EMERGENCY_GPIO);
+    btn_isr_time_us = esp_timer_get_time();
+    if (xEmergencyTask) vTaskNotifyGiveFromISR(xEmergencyTask, &woken);
+    portYIELD_FROM_ISR(woken);
+}
 
-/* كائنات RainMaker */
-esp_rmaker_device_t *ac_device = NULL;
-esp_rmaker_device_t *water_device = NULL;
-esp_rmaker_device_t *sound_device = NULL;
-esp_rmaker_device_t *led_device = NULL;
-esp_rmaker_device_t *fan_device = NULL;
-esp_rmaker_device_t *emergency_device = NULL;
-esp_rmaker_device_t *sensor_device = NULL;
+/* Re-arms the button once it has been released; keeps waiting while it is still held */
+static void btn_debounce_cb(void *arg) {
+    if (gpio_get_level(BTN_EMERGENCY_GPIO) == 0) {
+        esp_timer_start_once(btn_debounce_timer, BTN_DEBOUNCE_MS * 1000);
+        return;
+    }
+    gpio_intr_enable(BTN_EMERGENCY_GPIO);
+}
 
-/* --- دوال الهاردوير --- */
+/* The interrupt stays masked until the emergency task exists; see app_main() */
 static void buttons_init(void) {
     gpio_config_t btn_conf = {
         .mode = GPIO_MODE_INPUT,
         .pin_bit_mask = (1ULL << BTN_EMERGENCY_GPIO), 
-        .intr_type = GPIO_INTR_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
         .pull_up_en = GPIO_PULLUP_ENABLE, 
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
     };
     gpio_config(&btn_conf);
-}
-
-static void oled_init_custom(void) {
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+    gpio_intr_disable(BTN_EMERGENCY_GPIO);
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) ESP_LOGE(TAG, "GPIO ISR service install failed");
+    gpio_isr_handler_add(BTN_EMERGENCY_GPIO, btn_emergency_isr, NULL);
+    esp_timer_create_args_t debounce_args = {
+        .callback = btn_debounce_cb,
+        .name = "btn_debounce",
     };
-    i2c_param_config(I2C_MASTER_NUM, &conf);
-    i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0);
-    oled_dev.i2c_port = I2C_MASTER_NUM;
-    oled_dev.address = 0x3C;
-    oled_dev.width = 128;
-    oled_dev.height = 32;
-    ssd1306_init(&oled_dev, 128, 32);
-    ssd1306_clear_screen(&oled_dev, false);
+    esp_timer_create(&debounce_args, &btn_debounce_timer);
 }
 
 /* --- دوال RainMaker والمنطق --- */
-void update_rmaker_state(const char *device_name, bool status) {
-    const esp_rmaker_node_t *node = esp_rmaker_get_node();
-    esp_rmaker_device_t *dev = esp_rmaker_node_get_device_by_name(node, device_name);
-    if (dev && strcmp(esp_rmaker_device_get_name(dev), "Sensor") != 0) {
-        esp_rmaker_param_t *param = esp_rmaker_device_get_param_by_name(dev, "Power");
-        if (param) esp_rmaker_param_update_and_report(param, esp_rmaker_bool(status));
+#define CLOUD_ACK_TIMEOUT_MS    100
+
+static app_cmd_source_t write_source(const esp_rmaker_write_ctx_t *ctx) {
+    switch (ctx ? ctx->src : ESP_RMAKER_REQ_SRC_CLOUD) {
+    case ESP_RMAKER_REQ_SRC_SCHEDULE:
+    case ESP_RMAKER_REQ_SRC_SCENE_ACTIVATE:
+    case ESP_RMAKER_REQ_SRC_SCENE_DEACTIVATE:
+        return APP_CMD_SRC_SCHEDULE;
+    case ESP_RMAKER_REQ_SRC_LOCAL:
+        return APP_CMD_SRC_LOCAL;
+    default:
+        return APP_CMD_SRC_CLOUD;
     }
 }
 
-void activate_emergency() {
-    emergency_state = true;
-    water_state = true; app_driver_set_water(true);
-    sound_state = true; app_driver_set_sound(true);
-    led_state = true;   app_driver_set_fire_led(true);
-    fan_state = true;   app_driver_set_fan(true);
-    ac_state = false;   app_driver_set_ac(false);
-    update_rmaker_state("Fire Water", true);
-    update_rmaker_state("Sound Alarm", true);
-    update_rmaker_state("Fire LED", true);
-    update_rmaker_state("Extractor Fan", true);
-    update_rmaker_state("Emergency", true); 
-    update_rmaker_state("Air Conditioner", false); 
-    esp_rmaker_raise_alert("EMERGENCY ACTIVATED!");
-}
-
-void deactivate_emergency() {
-    emergency_state = false;
-    water_state = false; app_driver_set_water(false);
-    sound_state = false; app_driver_set_sound(false);
-    led_state = false;   app_driver_set_fire_led(false);
-    fan_state = false;   app_driver_set_fan(false);
-    update_rmaker_state("Fire Water", false);
-    update_rmaker_state("Sound Alarm", false);
-    update_rmaker_state("Fire LED", false);
-    update_rmaker_state("Extractor Fan", false);
-    update_rmaker_state("Emergency", false);
-    esp_rmaker_raise_alert("Emergency Deactivated");
+/* priv_data is the actuator's registry entry. The control task applies the write and
+ * reports the params itself, so nothing is left for RainMaker to report on return. */
+static esp_err_t write_cb(const esp_rmaker_device_t *device, const esp_rmaker_param_write_req_t write_req[],
+                          uint8_t count, void *priv_data, esp_rmaker_write_ctx_t *ctx)
+{
+    app_actuator_t *a = (app_actuator_t *)priv_data;
+    if (!a) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < count; i++) {
+        if (write_req[i].param != a->power) continue;
+        app_cmd_t cmd = {
+            .zone = a->zone,
+            .id = a->id,
+            .op = APP_CMD_SET,
+            .on = write_req[i].val.val.b,
+            .source = write_source(ctx),
+        };
+        esp_err_t ret = app_control_submit(&cmd, pdMS_TO_TICKS(CLOUD_ACK_TIMEOUT_MS));
+        if (ret != ESP_OK) err = ret;
+    }
+    return err;
 }
 
-static esp_err_t write_cb(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param,
-                          const esp_rmaker_param_val_t val, void *priv_data, esp_rmaker_write_ctx_t *ctx)
-{
-    const char *device_name = esp_rmaker_device_get_name(device);
-    const char *param_name = esp_rmaker_param_get_name(param);
-    if (strcmp(param_name, "Power") == 0) {
-        if (strcmp(device_name, "Emergency") == 0) val.val.b ? activate_emergency() : deactivate_emergency();
-        else if (strcmp(device_name, "Air Conditioner") == 0) { ac_state = val.val.b; app_driver_set_ac(ac_state); }
-        else if (strcmp(device_name, "Fire Water") == 0) { water_state = val.val.b; app_driver_set_water(water_state); }
-        else if (strcmp(device_name, "Sound Alarm") == 0) { sound_state = val.val.b; app_driver_set_sound(sound_state); }
-        else if (strcmp(device_name, "Fire LED") == 0) { led_state = val.val.b; app_driver_set_fire_led(led_state); }
-        else if (strcmp(device_name, "Extractor Fan") == 0) { fan_state = val.val.b; app_driver_set_fan(fan_state); }
-        
-        if (strcmp(device_name, "Emergency") != 0) esp_rmaker_param_update_and_report(param, val);
+/* Runs in the esp_timer task for every finished conversion */
+static void sensor_read_done(sensor_dev_t *dev, const sensor_reading_t *reading, void *arg) {
+    uint8_t idx = (uint8_t)(dev - sensors);
+    sensor_jitter_add(&sensor_jitter[idx], reading->timestamp_us);
+    if (reading->err == ESP_OK) {
+        sensor_sample_t sample = {
+            .temp = reading->temp, .hum = reading->hum,
+            .timestamp_us = reading->timestamp_us, .sensor = idx,
+        };
+        sensor_ring_push(&sensor_ring, &sample);
+        if (xControllerTask) xTaskNotifyGive(xControllerTask);
+    } else {
+        ESP_LOGW(TAG, "%s read failed: %s (ok %lu/%lu, checksum %lu, timeout %lu)", dev->name,
+                 esp_err_to_name(reading->err), (unsigned long)dev->stats.ok, (unsigned long)dev->stats.reads,
+                 (unsigned long)dev->stats.checksum_errors, (unsigned long)dev->stats.timeout_errors);
     }
-    return ESP_OK;
 }
 
-static void task_sensor_reader(void *pvParameters) {
-    sensor_data_t data;
-    float temp_val = 0.0f, hum_val = 0.0f;
-    while (1) {
-        if (dht11_read_safe(&temp_val, &hum_val)) {
-            data.temp = temp_val; data.hum = hum_val;
-            xQueueSend(xSensorDataQueue, &data, 0);
-        }
-        vTaskDelay(pdMS_TO_TICKS(SENSOR_READ_INTERVAL_MS));
+static void sensor_jitter_log(void) {
+    for (size_t i = 0; i < SENSOR_COUNT; i++) {
+        if (!sensors[i].present) continue;
+        sensor_jitter_stats_t stats;
+        sensor_jitter_get(&sensor_jitter[i], &stats);
+        ESP_LOGI(TAG, "%s sample period over %lu periods: min %ld us, max %ld us, p99 %ld us (nominal %lu ms)",
+                 sensors[i].name, (unsigned long)stats.count, (long)stats.min_us, (long)stats.max_us,
+                 (long)stats.p99_us, (unsigned long)sensors[i].interval_ms);
     }
 }
 
+/* Drains every buffered sample into its zone, then evaluates all zones in one pass. Also
+ * runs every CONTROLLER_TICK_MS without samples, so that a zone whose sensors went quiet
+ * stops acting on old values. */
 static void task_system_controller(void *pvParameters) {
-    sensor_data_t current_data = {0.0f, 0.0f};
-    char line1[32], line2[32];
-    bool auto_ac_active = false, auto_alarm_active = false;
-    while (1) {
-        if (xQueueReceive(xSensorDataQueue, &current_data, portMAX_DELAY) == pdPASS) {
-            float g_temp = current_data.temp;
-            float g_hum = current_data.hum;
-            
-            if (g_temp >= AC_ON_TEMP && !ac_state && !emergency_state) { 
-                ac_state = true; app_driver_set_ac(true); update_rmaker_state("Air Conditioner", true); auto_ac_active = true;
-            } else if (g_temp <= AC_OFF_TEMP && auto_ac_active && !emergency_state) {
-                ac_state = false; app_driver_set_ac(false); update_rmaker_state("Air Conditioner", false); auto_ac_active = false;
-            }
-            if (g_temp >= ALARM_ON_TEMP && !emergency_state) {
-                activate_emergency(); auto_alarm_active = true;
-            } else if (g_temp <= ALARM_OFF_TEMP && auto_alarm_active && emergency_state) { 
-                deactivate_emergency(); auto_alarm_active = false;
-            }
+    sensor_sample_t sample;
+    uint32_t overruns_seen = 0;
+    uint32_t samples = 0;
 
-            if (xSemaphoreTake(xOLEDMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-                ssd1306_clear_screen(&oled_dev, false);
-                snprintf(line1, sizeof(line1), "T:%.1fC H:%.0f%%", g_temp, g_hum);
-                ssd1306_display_text(&oled_dev, 0, line1, strlen(line1), false);
-                if (emergency_state) ssd1306_display_text(&oled_dev, 2, "!! EMERGENCY !!", 15, false);
-                else {
-                    snprintf(line2, sizeof(line2), "A%d W%d S%d F%d L%d", ac_state, water_state, sound_state, fan_state, led_state);
-                    ssd1306_display_text(&oled_dev, 2, line2, strlen(line2), false);
-                }
-                xSemaphoreGive(xOLEDMutex);
-            }
-            if (sensor_device) {
-                esp_rmaker_param_update_and_report(esp_rmaker_device_get_param_by_name(sensor_device, "Temperature"), esp_rmaker_float(g_temp));
-                esp_rmaker_param_update_and_report(esp_rmaker_device_get_param_by_name(sensor_device, "Humidity"), esp_rmaker_float(g_hum));
-            }
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONTROLLER_TICK_MS));
+        if (sensor_ring.overruns != overruns_seen) {
+            ESP_LOGW(TAG, "Sensor ring overrun, %lu samples dropped", (unsigned long)(sensor_ring.overruns - overruns_seen));
+            overruns_seen = sensor_ring.overruns;
+        }
+        while (sensor_ring_pop(&sensor_ring, &sample)) {
+            if (!app_zones_sample(&sample)) continue;
+            if (++samples % (SENSOR_JITTER_LOG_SAMPLES * SENSOR_COUNT) == 0) sensor_jitter_log();
         }
+        int64_t now_us = esp_timer_get_time();
+        app_zones_tick(now_us);
+        app_latency_publish(now_us);
+
+        /* The panel shows the first zone */
+        const app_zone_t *z = app_zone_get(0);
+        uint32_t state = app_control_snapshot(0);
+        app_display_model_t model = {
+            .temp = z->view.mean_temp, .hum = z->view.mean_hum,
+            .ac = state & APP_CONTROL_BIT(APP_ACTUATOR_AC),
+            .water = state & APP_CONTROL_BIT(APP_ACTUATOR_WATER),
+            .sound = state & APP_CONTROL_BIT(APP_ACTUATOR_SOUND),
+            .fan = state & APP_CONTROL_BIT(APP_ACTUATOR_FAN),
+            .led = state & APP_CONTROL_BIT(APP_ACTUATOR_LED),
+            .emergency = state & APP_CONTROL_BIT(APP_ACTUATOR_EMERGENCY),
+        };
+        app_display_publish(&model);
     }
 }
 
-static void task_emergency_monitor(void *pvParameters) {
-    bool btn_state_prev = true; 
+/* Sleeps until the button ISR notifies it and hands a toggle to the control task */
+static void task_emergency(void *pvParameters) {
     while (1) {
-        bool btn_state_curr = gpio_get_level(BTN_EMERGENCY_GPIO);
-        if (btn_state_prev == true && btn_state_curr == false) (!emergency_state) ? activate_emergency() : deactivate_emergency();
-        btn_state_prev = btn_state_curr;
-        vTaskDelay(pdMS_TO_TICKS(100));
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        app_control_press_emergency(BTN_EMERGENCY_ZONE, btn_isr_time_us);
+        esp_timer_start_once(btn_debounce_timer, BTN_DEBOUNCE_MS * 1000);
     }
 }
 
@@ -217,8 +245,7 @@ void app_main() {
     /* 1. تهيئة الهاردوير */
     app_driver_init();
     buttons_init();
-    oled_init_custom();
-    dht11_init_gpio(DHT11_GPIO);
+    if (app_display_init() != ESP_OK) ESP_LOGE(TAG, "Display init failed");
 
     /* 2. تهيئة الذاكرة NVS */
     esp_err_t err = nvs_flash_init();
@@ -227,13 +254,16 @@ void app_main() {
         err = nvs_flash_init();
     }
     ESP_ERROR_CHECK(err);
+    /* Without the history partition the minutes spent offline are simply not kept */
+    app_history_init();
 
     /* 3. تهيئة الشبكة (الطريقة الصحيحة) */
     app_network_init();
 
     /* 4. تهيئة RainMaker */
     esp_rmaker_config_t rainmaker_cfg = {
-        .enable_time_sync = false,
+        /* Time-series records are stamped with the wall clock */
+        .enable_time_sync = true,
     };
     esp_rmaker_node_t *node = esp_rmaker_node_init(&rainmaker_cfg, "Smart Home System", "ESP32-C3 Controller");
     if (!node) {
@@ -243,52 +273,43 @@ void app_main() {
     }
 
     /* 5. إنشاء الأجهزة */
-    ac_device = esp_rmaker_device_create("Air Conditioner", "esp.device.fan", NULL);
-    esp_rmaker_device_add_cb(ac_device, write_cb, NULL);
-    esp_rmaker_device_add_param(ac_device, esp_rmaker_power_param_create("Power", false));
-    esp_rmaker_node_add_device(node, ac_device);
-
-    water_device = esp_rmaker_device_create("Fire Water", "esp.device.switch", NULL);
-    esp_rmaker_device_add_cb(water_device, write_cb, NULL);
-    esp_rmaker_device_add_param(water_device, esp_rmaker_power_param_create("Power", false));
-    esp_rmaker_node_add_device(node, water_device);
-
-    sound_device = esp_rmaker_device_create("Sound Alarm", "esp.device.switch", NULL);
-    esp_rmaker_device_add_cb(sound_device, write_cb, NULL);
-    esp_rmaker_device_add_param(sound_device, esp_rmaker_power_param_create("Power", false));
-    esp_rmaker_node_add_device(node, sound_device);
-
-    led_device = esp_rmaker_device_create("Fire LED", "esp.device.lightbulb", NULL);
-    esp_rmaker_device_add_cb(led_device, write_cb, NULL);
-    esp_rmaker_device_add_param(led_device, esp_rmaker_power_param_create("Power", false));
-    esp_rmaker_node_add_device(node, led_device);
-
-    fan_device = esp_rmaker_device_create("Extractor Fan", "esp.device.fan", NULL);
-    esp_rmaker_device_add_cb(fan_device, write_cb, NULL);
-    esp_rmaker_device_add_param(fan_device, esp_rmaker_power_param_create("Power", false));
-    esp_rmaker_node_add_device(node, fan_device);
+    if (app_zones_create(node, zone_table, ZONE_COUNT, write_cb) != ESP_OK) {
+        ESP_LOGE(TAG, "Could not create zone devices. Aborting!!!");
+        vTaskDelay(5000/portTICK_PERIOD_MS);
+        abort();
+    }
+    if (app_rules_init(node, ZONE_COUNT, DEFAULT_RULES) != ESP_OK) {
+        ESP_LOGE(TAG, "Could not load the rules. Aborting!!!");
+        vTaskDelay(5000/portTICK_PERIOD_MS);
+        abort();
+    }
 
-    emergency_device = esp_rmaker_device_create("Emergency", "esp.device.switch", NULL);
-    esp_rmaker_device_add_cb(emergency_device, write_cb, NULL);
-    esp_rmaker_device_add_param(emergency_device, esp_rmaker_power_param_create("Power", false));
-    esp_rmaker_node_add_device(node, emergency_device);
+    /* Latency diagnostics are optional; the console only carries their command */
+    if (esp_rmaker_console_init() != ESP_OK) ESP_LOGW(TAG, "Console not available");
+    if (app_latency_init(node, CONFIG_APP_LATENCY_BUDGET_MS) != ESP_OK) ESP_LOGW(TAG, "Latency diagnostics not available");
 
-    sensor_device = esp_rmaker_device_create("Sensor", "esp.device.sensor", NULL);
-    esp_rmaker_device_add_param(sensor_device, esp_rmaker_param_create("Temperature", "esp.param.temperature", esp_rmaker_float(0), PROP_FLAG_READ));
-    esp_rmaker_device_add_param(sensor_device, esp_rmaker_param_create("Humidity", "esp.param.humidity", esp_rmaker_float(0), PROP_FLAG_READ));
-    esp_rmaker_node_add_device(node, sensor_device);
+    /* Cloud writes can arrive as soon as RainMaker starts */
+    if (app_control_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Could not start the control task. Aborting!!!");
+        vTaskDelay(5000/portTICK_PERIOD_MS);
+        abort();
+    }
 
     /* 6. تشغيل الخدمات (بدون Insights) */
     esp_rmaker_ota_enable_default();
     esp_rmaker_start();
 
     /* 7. بدء المهام */
-    xOLEDMutex = xSemaphoreCreateMutex();
-    xSensorDataQueue = xQueueCreate(MAX_QUEUE_SIZE, sizeof(sensor_data_t));
+    sensor_ring_init(&sensor_ring);
+    for (size_t i = 0; i < SENSOR_COUNT; i++) sensor_jitter_init(&sensor_jitter[i]);
 
-    xTaskCreate(task_sensor_reader, "SensorTask", 3072, NULL, 5, NULL);
-    xTaskCreate(task_system_controller, "ControllerTask", 4096, NULL, 4, NULL);
-    xTaskCreate(task_emergency_monitor, "EmergencyMonitor", 2048, NULL, 3, NULL);
+    xTaskCreate(task_system_controller, "ControllerTask", 4096, NULL, 4, &xControllerTask);
+    for (size_t i = 0; i < SENSOR_COUNT; i++) {
+        if (sensors[i].i2c_addr) sensors[i].bus = app_driver_i2c_bus();
+    }
+    if (sensor_sched_start(sensors, SENSOR_COUNT, sensor_read_done, NULL) != ESP_OK) ESP_LOGE(TAG, "No sensor available");
+    xTaskCreate(task_emergency, "EmergencyTask", 3072, NULL, 10, &xEmergencyTask);
+    gpio_intr_enable(BTN_EMERGENCY_GPIO);
 
     /* 8. بدء التزويد (QR Code) */
     err = app_network_start(POP_TYPE_MAC);
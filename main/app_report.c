@@ -0,0 +1,39 @@
+/* app_report.c - Deadband and interval policy for reporting sensor params */
+#include <math.h>
+#include <string.h>
+#include "esp_log.h"
+#include "app_report.h"
+
+static const char *TAG = "app_report";
+
+void app_report_policy_init(app_report_policy_t *p, esp_rmaker_param_t *param, float deadband,
+                            uint32_t min_interval_ms, uint32_t max_interval_ms) {
+    memset(p, 0, sizeof(*p));
+    p->param = param;
+    p->deadband = deadband;
+    p->min_interval_ms = min_interval_ms;
+    p->max_interval_ms = max_interval_ms;
+}
+
+bool app_report_policy_offer(app_report_policy_t *p, float value, int64_t now_us) {
+    if (!p->param) return false;
+    if (p->primed) {
+        int64_t elapsed_ms = (now_us - p->reported_us) / 1000;
+        bool heartbeat = p->max_interval_ms && elapsed_ms >= p->max_interval_ms;
+        bool moved = fabsf(value - p->reported) >= p->deadband && elapsed_ms >= p->min_interval_ms;
+        if (!heartbeat && !moved) {
+            p->suppressed++;
+            return false;
+        }
+    }
+    esp_err_t err = esp_rmaker_param_update_and_report(p->param, esp_rmaker_float(value));
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Report failed: %s", esp_err_to_name(err));
+        return false;
+    }
+    p->reported = value;
+    p->reported_us = now_us;
+    p->primed = true;
+    p->reports++;
+    return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_rmaker_core.h>
+
+/* Reporting policy for one float param. A value is reported when it has moved by at least
+ * `deadband` since the last report and `min_interval_ms` has passed, or unconditionally once
+ * `max_interval_ms` has passed (heartbeat). Values that are not reported leave the param
+ * untouched, so it always holds what the cloud last saw. */
+typedef struct {
+    esp_rmaker_param_t *param;
+    float deadband;
+    uint32_t min_interval_ms;
+    uint32_t max_interval_ms;       /* 0 disables the heartbeat */
+    /* State */
+    float reported;
+    int64_t reported_us;
+    bool primed;                    /* False until the first report */
+    uint32_t reports;
+    uint32_t suppressed;
+} app_report_policy_t;
+
+void app_report_policy_init(app_report_policy_t *p, esp_rmaker_param_t *param, float deadband,
+                            uint32_t min_interval_ms, uint32_t max_interval_ms);
+/* Reports value if the policy allows it and returns true if it did. Call between
+ * esp_rmaker_param_batch_begin() and esp_rmaker_param_batch_commit() to combine several
+ * params into one publish. */
+bool app_report_policy_offer(app_report_policy_t *p, float value, int64_t now_us);
@@ -0,0 +1,299 @@
+/* app_rules.c - Threshold rule engine.
+ *
+ * Rules are compiled once, when loaded or written, into a flat array sorted by zone. The
+ * controller evaluates it per tick without allocating or keeping state in it. A new set is handed over through
+ * one atomic pointer: the writer publishes it, the controller takes it at the start of a
+ * tick and frees the set it replaces, so no lock is shared with the control loop. */
+#include <ctype.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "nvs.h"
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_standard_types.h>
+#include <esp_rmaker_utils.h>
+#include "app_control.h"
+#include "app_rules.h"
+
+static const char *TAG = "app_rules";
+
+#define RULES_NVS_NAMESPACE     "app_rules"
+#define RULES_NVS_KEY           "rules"
+
+static const char *const input_names[APP_RULE_IN_MAX] = {
+    [APP_RULE_IN_TEMP] = "temp",
+    [APP_RULE_IN_MAX_TEMP] = "maxtemp",
+    [APP_RULE_IN_HUM] = "hum",
+    [APP_RULE_IN_RISE] = "rise",
+};
+
+static const char *const action_names[APP_ACTUATOR_MAX] = {
+    [APP_ACTUATOR_AC] = "ac",
+    [APP_ACTUATOR_WATER] = "water",
+    [APP_ACTUATOR_SOUND] = "sound",
+    [APP_ACTUATOR_LED] = "led",
+    [APP_ACTUATOR_FAN] = "fan",
+    [APP_ACTUATOR_EMERGENCY] = "emergency",
+};
+
+static size_t zone_total;
+static app_ruleset_t *current;                  /* Controller task only */
+static _Atomic(app_ruleset_t *) pending;
+static esp_rmaker_param_t *rules_param;
+
+static int lookup(const char *const *names, int count, const char *s, size_t len) {
+    for (int i = 0; i < count; i++) {
+        if (names[i] && strlen(names[i]) == len && strncmp(names[i], s, len) == 0) return i;
+    }
+    return -1;
+}
+
+static const char *skip_space(const char *s) {
+    while (*s == ' ' || *s == '\t') s++;
+    return s;
+}
+
+static size_t word_len(const char *s) {
+    size_t n = 0;
+    while (isalpha((unsigned char)s[n])) n++;
+    return n;
+}
+
+/* Parses one rule; zone 0 means every zone, otherwise it is 1-based */
+static esp_err_t parse_rule(const char *s, const char *end, app_rule_t *r, unsigned *zone, char *err, size_t err_len) {
+    char *next;
+    *r = (app_rule_t){ 0 };
+    *zone = 0;
+    s = skip_space(s);
+    if (isdigit((unsigned char)*s)) {
+        *zone = strtoul(s, &next, 10);
+        if (*next != '.' || *zone == 0) goto bad;
+        s = next + 1;
+    }
+    size_t n = word_len(s);
+    int input = lookup(input_names, APP_RULE_IN_MAX, s, n);
+    if (input < 0) {
+        snprintf(err, err_len, "unknown input '%.*s'", (int)n, s);
+        return ESP_ERR_INVALID_ARG;
+    }
+    r->input = input;
+    s = skip_space(s + n);
+    if (s[0] == '>' && s[1] == '=') r->cmp = APP_RULE_GE;
+    else if (s[0] == '<' && s[1] == '=') r->cmp = APP_RULE_LE;
+    else goto bad;
+    float threshold = strtof(s + 2, &next);
+    if (next == s + 2) goto bad;
+    s = skip_space(next);
+    float hysteresis = 0;
+    if (*s == '/') {
+        hysteresis = strtof(s + 1, &next);
+        if (next == s + 1 || hysteresis < 0) goto bad;
+        s = skip_space(next);
+    }
+    if (*s != ':') goto bad;
+    r->on_level = threshold;
+    r->off_level = r->cmp == APP_RULE_GE ? threshold - hysteresis : threshold + hysteresis;
+    do {
+        s = skip_space(s + 1);
+        n = word_len(s);
+        int action = lookup(action_names, APP_ACTUATOR_MAX, s, n);
+        if (action < 0) {
+            snprintf(err, err_len, "unknown action '%.*s'", (int)n, s);
+            return ESP_ERR_INVALID_ARG;
+        }
+        r->actions |= APP_CONTROL_BIT(action);
+        s = skip_space(s + n);
+    } while (*s == '+');
+    if (s != end) goto bad;
+    return ESP_OK;
+bad:
+    snprintf(err, err_len, "cannot parse '%.*s'", (int)(end - s), s);
+    return ESP_ERR_INVALID_ARG;
+}
+
+/* The parsed rules before the zone expansion. On the heap: compiling runs on the RainMaker
+ * work queue task, whose stack has no room for APP_RULES_MAX of them. */
+typedef struct {
+    app_rule_t rule;
+    unsigned zone;
+} parsed_rule_t;
+
+esp_err_t app_rules_compile(const char *text, size_t zones, app_ruleset_t **out, char *err, size_t err_len) {
+    size_t n_parsed = 0, total = 0;
+    esp_err_t ret = ESP_OK;
+    if (!text || zones == 0 || zones > APP_ZONE_MAX) return ESP_ERR_INVALID_ARG;
+    if (strlen(text) > APP_RULES_TEXT_MAX) {
+        snprintf(err, err_len, "longer than %d characters", APP_RULES_TEXT_MAX);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    parsed_rule_t *parsed = calloc(APP_RULES_MAX, sizeof(parsed_rule_t));
+    if (!parsed) return ESP_ERR_NO_MEM;
+
+    for (const char *s = text; *s; ) {
+        const char *end = s + strcspn(s, ";\n");
+        const char *last = end;
+        while (last > s && isspace((unsigned char)last[-1])) last--;
+        if (*skip_space(s) && skip_space(s) < last) {
+            if (n_parsed == APP_RULES_MAX) goto too_many;
+            parsed_rule_t *p = &parsed[n_parsed];
+            ret = parse_rule(s, last, &p->rule, &p->zone, err, err_len);
+            if (ret != ESP_OK) goto done;
+            if (p->zone > zones) {
+                snprintf(err, err_len, "no zone %u", p->zone);
+                ret = ESP_ERR_INVALID_ARG;
+                goto done;
+            }
+            total += p->zone ? 1 : zones;
+            n_parsed++;
+        }
+        s = *end ? end + 1 : end;
+    }
+    if (total > APP_RULES_MAX) goto too_many;
+
+    app_ruleset_t *set = calloc(1, sizeof(app_ruleset_t) + total * sizeof(app_rule_t));
+    if (!set) {
+        ret = ESP_ERR_NO_MEM;
+        goto done;
+    }
+    /* Expanded zone by zone, in text order within a zone */
+    for (size_t z = 0; z < APP_ZONE_MAX; z++) {
+        set->zone_first[z] = set->count;
+        if (z >= zones) continue;
+        for (size_t i = 0; i < n_parsed; i++) {
+            if (parsed[i].zone && parsed[i].zone != z + 1) continue;
+            set->rules[set->count] = parsed[i].rule;
+            set->rules[set->count].zone = z;
+            set->count++;
+        }
+    }
+    set->zone_first[APP_ZONE_MAX] = set->count;
+    *out = set;
+    goto done;
+too_many:
+    snprintf(err, err_len, "more than %d rules", APP_RULES_MAX);
+    ret = ESP_ERR_INVALID_SIZE;
+done:
+    free(parsed);
+    return ret;
+}
+
+/* Past on_level activates; past off_level releases. Without hysteresis the release is
+ * strict, so a value sitting on the threshold does not flap. */
+static bool rule_on(const app_rule_t *r, float x) {
+    return r->cmp == APP_RULE_GE ? x >= r->on_level : x <= r->on_level;
+}
+
+static bool rule_off(const app_rule_t *r, float x) {
+    if (r->on_level == r->off_level) return !rule_on(r, x);
+    return r->cmp == APP_RULE_GE ? x <= r->off_level : x >= r->off_level;
+}
+
+uint32_t app_rules_evaluate(const app_ruleset_t *set, uint8_t zone, const float *inputs, uint32_t held) {
+    uint32_t fire = 0, keep = 0;
+    if (!set || zone >= APP_ZONE_MAX) return 0;
+    for (size_t i = set->zone_first[zone]; i < set->zone_first[zone + 1]; i++) {
+        const app_rule_t *r = &set->rules[i];
+        float x = inputs[r->input];
+        if (rule_on(r, x)) fire |= r->actions;
+        if (!rule_off(r, x)) keep |= r->actions;
+    }
+    return fire | (keep & held);
+}
+
+app_ruleset_t *app_rules_current(void) {
+    app_ruleset_t *next = atomic_exchange_explicit(&pending, NULL, memory_order_acquire);
+    if (next) {
+        free(current);
+        current = next;
+        ESP_LOGI(TAG, "Rule set with %u rule(s) in effect", (unsigned)current->count);
+    }
+    return current;
+}
+
+/* A set the controller has not taken yet is simply replaced */
+static void rules_publish(app_ruleset_t *set) {
+    free(atomic_exchange_explicit(&pending, set, memory_order_release));
+}
+
+static char *rules_load(void) {
+    nvs_handle_t h;
+    size_t len = 0;
+    char *text = NULL;
+    if (nvs_open(RULES_NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return NULL;
+    if (nvs_get_str(h, RULES_NVS_KEY, NULL, &len) == ESP_OK && len > 0 && len <= APP_RULES_TEXT_MAX + 1) {
+        text = malloc(len);
+        if (text && nvs_get_str(h, RULES_NVS_KEY, text, &len) != ESP_OK) {
+            free(text);
+            text = NULL;
+        }
+    }
+    nvs_close(h);
+    return text;
+}
+
+static esp_err_t rules_store(const char *text) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(RULES_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_str(h, RULES_NVS_KEY, text);
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
+
+/* Invalid text is refused and raised as an alert, since the app shows no logs; the param
+ * keeps the rules in effect */
+static esp_err_t rules_write_cb(const esp_rmaker_device_t *device, const esp_rmaker_param_write_req_t write_req[],
+                                uint8_t count, void *priv_data, esp_rmaker_write_ctx_t *ctx) {
+    for (int i = 0; i < count; i++) {
+        if (write_req[i].param != rules_param) continue;
+        const char *text = write_req[i].val.val.s ? write_req[i].val.val.s : "";
+        app_ruleset_t *set;
+        char err[64], alert[96];
+        if (app_rules_compile(text, zone_total, &set, err, sizeof(err)) != ESP_OK) {
+            ESP_LOGW(TAG, "Rules rejected: %s", err);
+            snprintf(alert, sizeof(alert), "Rules rejected: %s", err);
+            esp_rmaker_raise_alert(alert);
+            return ESP_ERR_INVALID_ARG;
+        }
+        esp_err_t ret = rules_store(text);
+        if (ret != ESP_OK) ESP_LOGW(TAG, "Could not store rules: %s", esp_err_to_name(ret));
+        rules_publish(set);
+        esp_rmaker_param_update(rules_param, esp_rmaker_str(text));
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_rules_init(const esp_rmaker_node_t *node, size_t zones, const char *defaults) {
+    app_ruleset_t *set = NULL;
+    char err[64];
+    zone_total = zones;
+    char *text = rules_load();
+    if (text && app_rules_compile(text, zones, &set, err, sizeof(err)) != ESP_OK) {
+        ESP_LOGW(TAG, "Stored rules rejected (%s), using defaults", err);
+        free(text);
+        text = NULL;
+    }
+    if (!text) {
+        esp_err_t ret = app_rules_compile(defaults, zones, &set, err, sizeof(err));
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Default rules rejected: %s", err);
+            return ret;
+        }
+    }
+    ESP_LOGI(TAG, "%u rule(s) for %u zone(s)", (unsigned)set->count, (unsigned)zones);
+    rules_publish(set);
+
+    esp_rmaker_device_t *device = esp_rmaker_device_create("Controller", "esp.device.other", NULL);
+    rules_param = esp_rmaker_param_create("Rules", "esp.param.rules", esp_rmaker_str(text ? text : defaults),
+                                          PROP_FLAG_READ | PROP_FLAG_WRITE);
+    free(text);
+    if (!device || !rules_param) return ESP_ERR_NO_MEM;
+    esp_rmaker_param_add_ui_type(rules_param, ESP_RMAKER_UI_TEXT);
+    esp_rmaker_device_add_bulk_cb(device, rules_write_cb, NULL);
+    esp_rmaker_device_add_param(device, rules_param);
+    esp_rmaker_node_add_device(node, device);
+    return ESP_OK;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_rmaker_core.h>
+#include "esp_err.h"
+#include "app_zone.h"
+
+/* Threshold rules that drive the actuators of a zone.
+ *
+ * Text form, one rule per line or `;`-separated:
+ *     [zone.]input op threshold[/hysteresis]:action[+action...]
+ * zone is 1-based and defaults to every zone; input is temp, maxtemp, hum or rise (C/min);
+ * op is >= or <=; actions are ac, water, sound, led, fan and emergency. A >= rule fires at
+ * the threshold and lets go once the input is hysteresis below it, e.g.
+ *     temp>=27/1:ac; maxtemp>=30/1:emergency; rise>=8/7:emergency
+ * Any rule that fires switches its actions on; they stay on until every rule that names
+ * them has let go. Evaluation is stateless, so a new rule set continues where the old one
+ * left off. */
+
+#define APP_RULES_TEXT_MAX      512
+#define APP_RULES_MAX           128     /* Compiled rules, after expanding zone wildcards */
+
+typedef enum {
+    APP_RULE_IN_TEMP = 0,       /* Mean of the zone's fresh points */
+    APP_RULE_IN_MAX_TEMP,
+    APP_RULE_IN_HUM,            /* Mean */
+    APP_RULE_IN_RISE,           /* Fastest rate of rise */
+    APP_RULE_IN_MAX,
+} app_rule_input_t;
+
+typedef enum {
+    APP_RULE_GE = 0,
+    APP_RULE_LE,
+} app_rule_cmp_t;
+
+typedef struct {
+    uint8_t zone;
+    uint8_t input;              /* app_rule_input_t */
+    uint8_t cmp;                /* app_rule_cmp_t */
+    float on_level;
+    float off_level;
+    uint32_t actions;           /* APP_CONTROL_BIT() of each actuator */
+} app_rule_t;
+
+/* Rules sorted by zone, so that a zone evaluates one contiguous slice */
+typedef struct {
+    size_t count;
+    uint16_t zone_first[APP_ZONE_MAX + 1];  /* Rules of zone z are [zone_first[z], zone_first[z + 1]) */
+    app_rule_t rules[];
+} app_ruleset_t;
+
+/* Compiles text for `zones` zones into a new rule set. On failure a reason goes to err. */
+esp_err_t app_rules_compile(const char *text, size_t zones, app_ruleset_t **out, char *err, size_t err_len);
+
+/* Loads the rule set from NVS, or compiles `defaults` if NVS has none or it no longer
+ * compiles, and creates the "Controller" device whose "Rules" param edits it. A valid
+ * write is stored in NVS and handed to the controller, which picks it up at its next tick
+ * without stopping. Call after app_zones_create(). */
+esp_err_t app_rules_init(const esp_rmaker_node_t *node, size_t zones, const char *defaults);
+
+/* Controller task only: takes over a newly written rule set, if any, and returns the set
+ * to evaluate. */
+app_ruleset_t *app_rules_current(void);
+
+/* Returns the actuators of a zone that should be on for inputs (indexed by
+ * app_rule_input_t). held is what the rules switched on before and still holds. */
+uint32_t app_rules_evaluate(const app_ruleset_t *set, uint8_t zone, const float *inputs, uint32_t held);
@@ -0,0 +1,244 @@
+/* app_sensor.c - Sample ring, filter chain, rate-of-rise detector, sample period
+ * statistics and rolling aggregates. Nothing here allocates. */
+#include <math.h>
+#include <string.h>
+#include "app_sensor.h"
+
+void sensor_ring_init(sensor_ring_t *ring) {
+    memset(ring, 0, sizeof(*ring));
+    portMUX_INITIALIZE(&ring->lock);
+}
+
+void sensor_ring_push(sensor_ring_t *ring, const sensor_sample_t *sample) {
+    portENTER_CRITICAL(&ring->lock);
+    if (ring->head - ring->tail == SENSOR_RING_LEN) {
+        ring->tail++;
+        ring->overruns++;
+    }
+    ring->buf[ring->head % SENSOR_RING_LEN] = *sample;
+    ring->head++;
+    portEXIT_CRITICAL(&ring->lock);
+}
+
+bool sensor_ring_pop(sensor_ring_t *ring, sensor_sample_t *sample) {
+    bool ok = false;
+    portENTER_CRITICAL(&ring->lock);
+    if (ring->head != ring->tail) {
+        *sample = ring->buf[ring->tail % SENSOR_RING_LEN];
+        ring->tail++;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&ring->lock);
+    return ok;
+}
+
+void sensor_filter_chain_init(sensor_filter_chain_t *chain) {
+    memset(chain, 0, sizeof(*chain));
+}
+
+static sensor_filter_t *chain_add(sensor_filter_chain_t *chain, sensor_filter_type_t type) {
+    if (chain->n_stages == SENSOR_FILTER_CHAIN_MAX) return NULL;
+    sensor_filter_t *f = &chain->stages[chain->n_stages++];
+    memset(f, 0, sizeof(*f));
+    f->type = type;
+    return f;
+}
+
+esp_err_t sensor_filter_chain_add_median(sensor_filter_chain_t *chain, uint8_t n) {
+    if (n == 0 || n > SENSOR_MEDIAN_MAX || (n % 2) == 0) return ESP_ERR_INVALID_ARG;
+    sensor_filter_t *f = chain_add(chain, SENSOR_FILTER_MEDIAN);
+    if (!f) return ESP_ERR_NO_MEM;
+    f->median_n = n;
+    return ESP_OK;
+}
+
+esp_err_t sensor_filter_chain_add_ema(sensor_filter_chain_t *chain, float alpha) {
+    if (!(alpha > 0.0f && alpha <= 1.0f)) return ESP_ERR_INVALID_ARG;
+    sensor_filter_t *f = chain_add(chain, SENSOR_FILTER_EMA);
+    if (!f) return ESP_ERR_NO_MEM;
+    f->ema_alpha = alpha;
+    return ESP_OK;
+}
+
+/* Until the window is full the median is taken over the samples seen so far */
+static float median_apply(sensor_filter_t *f, float x) {
+    float sorted[SENSOR_MEDIAN_MAX];
+    f->window[f->pos] = x;
+    f->pos = (f->pos + 1) % f->median_n;
+    if (f->count < f->median_n) f->count++;
+    for (int i = 0; i < f->count; i++) {
+        float v = f->window[i];
+        int j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+    if (f->count % 2) return sorted[f->count / 2];
+    return 0.5f * (sorted[f->count / 2 - 1] + sorted[f->count / 2]);
+}
+
+static float ema_apply(sensor_filter_t *f, float x) {
+    if (!f->primed) {
+        f->ema = x;
+        f->primed = true;
+    } else {
+        f->ema += f->ema_alpha * (x - f->ema);
+    }
+    return f->ema;
+}
+
+float sensor_filter_chain_apply(sensor_filter_chain_t *chain, float x) {
+    for (int i = 0; i < chain->n_stages; i++) {
+        sensor_filter_t *f = &chain->stages[i];
+        x = (f->type == SENSOR_FILTER_MEDIAN) ? median_apply(f, x) : ema_apply(f, x);
+    }
+    return x;
+}
+
+void sensor_filter_chain_reset(sensor_filter_chain_t *chain) {
+    for (int i = 0; i < chain->n_stages; i++) {
+        sensor_filter_t *f = &chain->stages[i];
+        f->count = 0;
+        f->pos = 0;
+        f->primed = false;
+    }
+}
+
+void sensor_ror_init(sensor_ror_t *ror, uint32_t window_s, uint8_t min_samples) {
+    memset(ror, 0, sizeof(*ror));
+    ror->window_us = (int64_t)window_s * 1000000;
+    ror->min_samples = min_samples < 2 ? 2 : min_samples;
+}
+
+float sensor_ror_update(sensor_ror_t *ror, int64_t timestamp_us, float temp) {
+    ror->temp[ror->pos] = temp;
+    ror->ts[ror->pos] = timestamp_us;
+    ror->pos = (ror->pos + 1) % SENSOR_ROR_HISTORY;
+    if (ror->count < SENSOR_ROR_HISTORY) ror->count++;
+
+    /* Times are taken relative to the newest sample, in minutes, to keep floats small */
+    float n = 0, sum_t = 0, sum_y = 0, sum_tt = 0, sum_ty = 0;
+    for (int i = 0; i < ror->count; i++) {
+        int64_t age_us = timestamp_us - ror->ts[i];
+        if (age_us < 0 || age_us > ror->window_us) continue;
+        float t = -(float)age_us / 60e6f;
+        float y = ror->temp[i];
+        n++;
+        sum_t += t;
+        sum_y += y;
+        sum_tt += t * t;
+        sum_ty += t * y;
+    }
+    if (n < ror->min_samples) return 0.0f;
+    float denom = n * sum_tt - sum_t * sum_t;
+    if (denom <= 0.0f) return 0.0f;
+    return (n * sum_ty - sum_t * sum_y) / denom;
+}
+
+void sensor_jitter_init(sensor_jitter_t *jitter) {
+    memset(jitter, 0, sizeof(*jitter));
+    portMUX_INITIALIZE(&jitter->lock);
+}
+
+void sensor_jitter_add(sensor_jitter_t *jitter, int64_t timestamp_us) {
+    portENTER_CRITICAL(&jitter->lock);
+    if (jitter->last_us) {
+        int32_t period = (int32_t)(timestamp_us - jitter->last_us);
+        if (jitter->count == 0 || period < jitter->min_us) jitter->min_us = period;
+        if (jitter->count == 0 || period > jitter->max_us) jitter->max_us = period;
+        jitter->window[jitter->count % SENSOR_JITTER_WINDOW] = period;
+        jitter->count++;
+    }
+    jitter->last_us = timestamp_us;
+    portEXIT_CRITICAL(&jitter->lock);
+}
+
+/* Nearest-rank percentile over a sorted copy of the window; only run for diagnostics */
+void sensor_jitter_get(sensor_jitter_t *jitter, sensor_jitter_stats_t *stats) {
+    int32_t sorted[SENSOR_JITTER_WINDOW];
+    portENTER_CRITICAL(&jitter->lock);
+    uint32_t n = jitter->count < SENSOR_JITTER_WINDOW ? jitter->count : SENSOR_JITTER_WINDOW;
+    memcpy(sorted, jitter->window, n * sizeof(sorted[0]));
+    stats->count = jitter->count;
+    stats->min_us = jitter->min_us;
+    stats->max_us = jitter->max_us;
+    portEXIT_CRITICAL(&jitter->lock);
+
+    for (uint32_t i = 1; i < n; i++) {
+        int32_t v = sorted[i];
+        uint32_t j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+    stats->p99_us = n ? sorted[(n * 99 + 99) / 100 - 1] : 0;
+}
+
+void sensor_agg_add(sensor_agg_t *agg, float x) {
+    if (agg->count == 0 || x < agg->min) agg->min = x;
+    if (agg->count == 0 || x > agg->max) agg->max = x;
+    agg->count++;
+    float delta = x - agg->mean;
+    agg->mean += delta / agg->count;
+    agg->m2 += delta * (x - agg->mean);
+}
+
+/* Chan et al.'s pairwise update */
+void sensor_agg_merge(sensor_agg_t *a, const sensor_agg_t *b) {
+    if (b->count == 0) return;
+    if (a->count == 0) {
+        *a = *b;
+        return;
+    }
+    float n = (float)a->count + (float)b->count;
+    float delta = b->mean - a->mean;
+    a->mean += delta * b->count / n;
+    a->m2 += b->m2 + delta * delta * ((float)a->count * b->count / n);
+    if (b->min < a->min) a->min = b->min;
+    if (b->max > a->max) a->max = b->max;
+    a->count += b->count;
+}
+
+float sensor_agg_stddev(const sensor_agg_t *agg) {
+    if (agg->count < 2) return 0.0f;
+    return sqrtf(agg->m2 / agg->count);
+}
+
+void sensor_window_init(sensor_window_t *w, uint32_t bucket_s) {
+    memset(w, 0, sizeof(*w));
+    w->bucket_us = (int64_t)bucket_s * 1000000;
+}
+
+uint32_t sensor_window_roll(sensor_window_t *w, int64_t now_us) {
+    uint32_t closed = 0;
+    if (!w->start_us || now_us < w->start_us + w->bucket_us) return 0;
+    /* After a gap longer than the ring, only the last SENSOR_WINDOW_BUCKETS matter, and the
+     * open bucket is older than all of them */
+    int64_t ended = (now_us - w->start_us) / w->bucket_us;
+    if (ended > SENSOR_WINDOW_BUCKETS) {
+        w->start_us += (ended - SENSOR_WINDOW_BUCKETS) * w->bucket_us;
+        ended = SENSOR_WINDOW_BUCKETS;
+        memset(&w->open, 0, sizeof(w->open));
+    }
+    for (; closed < ended; closed++) {
+        w->closed[w->pos] = w->open;
+        w->pos = (w->pos + 1) % SENSOR_WINDOW_BUCKETS;
+        if (w->filled < SENSOR_WINDOW_BUCKETS) w->filled++;
+        memset(&w->open, 0, sizeof(w->open));
+        w->start_us += w->bucket_us;
+    }
+    w->rolled += closed;
+    return closed;
+}
+
+void sensor_window_add(sensor_window_t *w, int64_t timestamp_us, float x) {
+    if (!w->start_us) w->start_us = timestamp_us;
+    else sensor_window_roll(w, timestamp_us);
+    sensor_agg_add(&w->open, x);
+}
+
+void sensor_window_get(const sensor_window_t *w, uint8_t n, sensor_agg_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (n > w->filled) n = w->filled;
+    for (uint8_t i = 1; i <= n; i++) {
+        sensor_agg_merge(out, &w->closed[(w->pos + SENSOR_WINDOW_BUCKETS - i) % SENSOR_WINDOW_BUCKETS]);
+    }
+}
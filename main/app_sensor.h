@@ -0,0 +1,139 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+#define SENSOR_RING_LEN             16      /* Samples buffered between the reader and the controller */
+#define SENSOR_FILTER_CHAIN_MAX     4       /* Stages per filter chain */
+#define SENSOR_MEDIAN_MAX           7       /* Largest median window */
+#define SENSOR_ROR_HISTORY          16      /* Samples kept by the rate-of-rise detector */
+#define SENSOR_JITTER_WINDOW        128     /* Periods kept for the percentile */
+#define SENSOR_WINDOW_BUCKETS       15      /* Closed buckets kept by a rolling window */
+
+typedef struct {
+    float temp;
+    float hum;
+    int64_t timestamp_us;       /* esp_timer time of the measurement */
+    uint8_t sensor;             /* Index of the sensor in the application's table */
+} sensor_sample_t;
+
+/* Single-producer, single-consumer ring. When full, a push drops the oldest unread sample
+ * and counts it in `overruns`, so a slow consumer loses history instead of fresh data. */
+typedef struct {
+    sensor_sample_t buf[SENSOR_RING_LEN];
+    uint32_t head;              /* Samples pushed so far */
+    uint32_t tail;              /* Samples popped or dropped so far */
+    uint32_t overruns;
+    portMUX_TYPE lock;
+} sensor_ring_t;
+
+void sensor_ring_init(sensor_ring_t *ring);
+void sensor_ring_push(sensor_ring_t *ring, const sensor_sample_t *sample);
+bool sensor_ring_pop(sensor_ring_t *ring, sensor_sample_t *sample);
+
+typedef enum {
+    SENSOR_FILTER_MEDIAN,       /* Median of the last n inputs; rejects single-sample spikes */
+    SENSOR_FILTER_EMA,          /* y += alpha * (x - y) */
+} sensor_filter_type_t;
+
+typedef struct {
+    sensor_filter_type_t type;
+    uint8_t median_n;
+    float ema_alpha;
+    /* State */
+    float window[SENSOR_MEDIAN_MAX];
+    uint8_t count;
+    uint8_t pos;
+    float ema;
+    bool primed;
+} sensor_filter_t;
+
+/* Stages run in the order they were added */
+typedef struct {
+    sensor_filter_t stages[SENSOR_FILTER_CHAIN_MAX];
+    uint8_t n_stages;
+} sensor_filter_chain_t;
+
+void sensor_filter_chain_init(sensor_filter_chain_t *chain);
+/* n must be odd and at most SENSOR_MEDIAN_MAX */
+esp_err_t sensor_filter_chain_add_median(sensor_filter_chain_t *chain, uint8_t n);
+/* 0 < alpha <= 1; larger values follow the input faster */
+esp_err_t sensor_filter_chain_add_ema(sensor_filter_chain_t *chain, float alpha);
+float sensor_filter_chain_apply(sensor_filter_chain_t *chain, float x);
+void sensor_filter_chain_reset(sensor_filter_chain_t *chain);
+
+/* Least-squares slope of the temperature over a sliding time window */
+typedef struct {
+    int64_t window_us;
+    uint8_t min_samples;
+    float temp[SENSOR_ROR_HISTORY];
+    int64_t ts[SENSOR_ROR_HISTORY];
+    uint8_t count;
+    uint8_t pos;
+} sensor_ror_t;
+
+void sensor_ror_init(sensor_ror_t *ror, uint32_t window_s, uint8_t min_samples);
+/* Adds a sample and returns the rate of rise in degC/min. Returns 0 until min_samples
+ * samples fall inside the window. */
+float sensor_ror_update(sensor_ror_t *ror, int64_t timestamp_us, float temp);
+
+/* Sample period statistics. min/max cover every period since init, p99 the last
+ * SENSOR_JITTER_WINDOW periods. Fed from one task, readable from any. */
+typedef struct {
+    int64_t last_us;
+    uint32_t count;             /* Periods measured */
+    int32_t min_us;
+    int32_t max_us;
+    int32_t window[SENSOR_JITTER_WINDOW];
+    portMUX_TYPE lock;
+} sensor_jitter_t;
+
+typedef struct {
+    uint32_t count;
+    int32_t min_us;
+    int32_t max_us;
+    int32_t p99_us;
+} sensor_jitter_stats_t;
+
+void sensor_jitter_init(sensor_jitter_t *jitter);
+/* timestamp_us is the time of the sample, not of its arrival */
+void sensor_jitter_add(sensor_jitter_t *jitter, int64_t timestamp_us);
+void sensor_jitter_get(sensor_jitter_t *jitter, sensor_jitter_stats_t *stats);
+
+/* Count, mean, spread and range of a set of values. mean and m2 follow Welford, so the
+ * variance does not cancel out in float. */
+typedef struct {
+    uint32_t count;
+    float mean;
+    float m2;                   /* Sum of squared deviations from the mean */
+    float min;
+    float max;
+} sensor_agg_t;
+
+void sensor_agg_add(sensor_agg_t *agg, float x);
+/* Folds b into a */
+void sensor_agg_merge(sensor_agg_t *a, const sensor_agg_t *b);
+/* Population standard deviation; 0 for fewer than two values */
+float sensor_agg_stddev(const sensor_agg_t *agg);
+
+/* Rolling aggregates over fixed time buckets. A sample updates the open bucket in O(1);
+ * closing a bucket moves it into a ring of the last SENSOR_WINDOW_BUCKETS, and any window
+ * of up to that many buckets is merged from the ring on demand. */
+typedef struct {
+    int64_t bucket_us;
+    int64_t start_us;           /* Start of the open bucket; 0 before the first sample */
+    sensor_agg_t open;
+    sensor_agg_t closed[SENSOR_WINDOW_BUCKETS];
+    uint8_t pos;                /* Slot the next closed bucket goes to */
+    uint8_t filled;
+    uint32_t rolled;            /* Buckets closed since init, for readers polling the window */
+} sensor_window_t;
+
+void sensor_window_init(sensor_window_t *w, uint32_t bucket_s);
+/* Closes every bucket that has ended by now_us and returns how many were closed. Empty
+ * buckets are kept, so a window covers wall time and not a number of samples. */
+uint32_t sensor_window_roll(sensor_window_t *w, int64_t now_us);
+void sensor_window_add(sensor_window_t *w, int64_t timestamp_us, float x);
+/* Merges the last n closed buckets (at most SENSOR_WINDOW_BUCKETS) into out */
+void sensor_window_get(const sensor_window_t *w, uint8_t n, sensor_agg_t *out);
@@ -0,0 +1,390 @@
+/* app_zone.c - Zones: the sensors, actuators and thresholds of one room.
+ *
+ * Zones are built once from the application's table and evaluated together by the
+ * controller task, so adding a room costs memory and a few microseconds per tick but no
+ * task, stack or timer. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_standard_types.h>
+#include <esp_rmaker_utils.h>
+#include "app_control.h"
+#include "app_driver.h"
+#include "app_history.h"
+#include "app_rules.h"
+#include "app_zone.h"
+
+static const char *TAG = "app_zone";
+
+#define FILTER_MEDIAN_N             3       /* Rejects a single corrupted sample */
+#define FILTER_EMA_ALPHA            0.5f
+#define ROR_WINDOW_S                30      /* Rate of rise is fitted over the last half minute */
+#define ROR_MIN_SAMPLES             3
+#define TEMP_REPORT_DEADBAND        0.3f
+#define HUM_REPORT_DEADBAND         1.0f
+#define SENSOR_REPORT_MIN_MS        20000   /* At most one sensor report every two samples */
+#define SENSOR_REPORT_MAX_MS        300000  /* Heartbeat when the values do not move */
+#define STATS_BUCKET_S              60
+#define STATS_JSON_MAX              256
+#define HISTORY_BATCH               48      /* Offline minutes per upload */
+#define HISTORY_DRAIN_MS            10000   /* Half the MQTT budget revive rate, the rest is for live reports */
+#define SENSOR_MAP_NONE             0xff
+
+/* Actuators that follow the Emergency switch */
+#define EMERGENCY_FOLLOWERS     (APP_CONTROL_BIT(APP_ACTUATOR_WATER) | APP_CONTROL_BIT(APP_ACTUATOR_SOUND) | \
+                                 APP_CONTROL_BIT(APP_ACTUATOR_LED) | APP_CONTROL_BIT(APP_ACTUATOR_FAN))
+
+static app_zone_t *zones;
+static size_t zone_count;
+/* Sensor index to zone index, so a sample finds its zone in one load */
+static uint8_t sensor_map[UINT8_MAX + 1];
+/* Window lengths of the aggregates, in buckets */
+static const uint8_t stats_windows[] = { 1, 5, 15 };
+static int64_t history_drained_us;
+static bool mqtt_online;
+static bool mqtt_ever_online;  /* The first connection reports the whole node anyway */
+
+static const char *zone_label(const app_zone_t *z) {
+    return z->cfg->name ? z->cfg->name : "Room";
+}
+
+static void point_init(app_zone_point_t *p) {
+    sensor_filter_chain_init(&p->spike_filter);
+    sensor_filter_chain_add_median(&p->spike_filter, FILTER_MEDIAN_N);
+    sensor_filter_chain_init(&p->temp_filter);
+    sensor_filter_chain_add_ema(&p->temp_filter, FILTER_EMA_ALPHA);
+    p->hum_spike_filter = p->spike_filter;
+    p->hum_filter = p->temp_filter;
+    sensor_ror_init(&p->ror, ROR_WINDOW_S, ROR_MIN_SAMPLES);
+    p->updated_us = 0;
+}
+
+/* The rate of rise is fitted to the median output only: the fit already smooths, and the
+ * EMA lag would flatten the slope of a fast fire. The aggregates take the median output
+ * too, so that one corrupted frame does not widen min/max for a quarter of an hour. */
+static void point_update(app_zone_t *z, app_zone_point_t *p, const sensor_sample_t *sample) {
+    float despiked = sensor_filter_chain_apply(&p->spike_filter, sample->temp);
+    float hum_despiked = sensor_filter_chain_apply(&p->hum_spike_filter, sample->hum);
+    p->temp = sensor_filter_chain_apply(&p->temp_filter, despiked);
+    p->hum = sensor_filter_chain_apply(&p->hum_filter, hum_despiked);
+    p->rise = sensor_ror_update(&p->ror, sample->timestamp_us, despiked);
+    p->updated_us = sample->timestamp_us;
+    sensor_window_add(&z->temp_window, sample->timestamp_us, despiked);
+    sensor_window_add(&z->hum_window, sample->timestamp_us, hum_despiked);
+}
+
+static void zone_view(app_zone_t *z, int64_t now_us) {
+    app_zone_view_t *view = &z->view;
+    float sum_temp = 0, sum_hum = 0;
+    *view = (app_zone_view_t){ 0 };
+    for (size_t i = 0; i < z->cfg->sensor_count; i++) {
+        const app_zone_point_t *p = &z->points[i];
+        if (!p->updated_us || now_us - p->updated_us > (int64_t)z->cfg->stale_ms * 1000) continue;
+        if (!view->points || p->temp > view->max_temp) view->max_temp = p->temp;
+        if (!view->points || p->rise > view->max_rise) view->max_rise = p->rise;
+        sum_temp += p->temp;
+        sum_hum += p->hum;
+        if (p->updated_us > view->newest_us) view->newest_us = p->updated_us;
+        view->points++;
+    }
+    if (view->points) {
+        view->mean_temp = sum_temp / view->points;
+        view->mean_hum = sum_hum / view->points;
+    }
+}
+
+/* A zone without fresh points keeps its outputs as they are. While the emergency is on it
+ * owns the other outputs, so only rules that drive Emergency act. Rules switch off only
+ * what they switched on. */
+static void zone_evaluate(app_zone_t *z, app_ruleset_t *rules, int64_t now_us) {
+    const app_zone_view_t *v = &z->view;
+    zone_view(z, now_us);
+    /* A rule tipped by a new sample counts its latency from the sample, one tipped by time
+     * from this tick */
+    int64_t trigger_us = v->newest_us > z->evaluated_us ? v->newest_us : now_us;
+    z->evaluated_us = now_us;
+    if (!v->points) return;
+
+    const float inputs[APP_RULE_IN_MAX] = {
+        [APP_RULE_IN_TEMP] = v->mean_temp,
+        [APP_RULE_IN_MAX_TEMP] = v->max_temp,
+        [APP_RULE_IN_HUM] = v->mean_hum,
+        [APP_RULE_IN_RISE] = v->max_rise,
+    };
+    uint32_t state = app_control_snapshot(z->index);
+    uint32_t want = app_rules_evaluate(rules, z->index, inputs, z->auto_on & state);
+    uint32_t scope = (state & APP_CONTROL_BIT(APP_ACTUATOR_EMERGENCY)) ? APP_CONTROL_BIT(APP_ACTUATOR_EMERGENCY) : ~0UL;
+    for (int i = 0; i < APP_ACTUATOR_MAX; i++) {
+        uint32_t bit = APP_CONTROL_BIT(i);
+        if (!(scope & bit)) continue;
+        if ((want & bit) && !(state & bit)) {
+            ESP_LOGI(TAG, "%s: rules switch %s on (temp %.1f, max %.1f, rise %.1f C/min)", zone_label(z),
+                     z->actuators[i].name, v->mean_temp, v->max_temp, v->max_rise);
+            app_cmd_t cmd = {
+                .zone = z->index, .id = i, .op = APP_CMD_SET, .on = true,
+                .source = APP_CMD_SRC_AUTO, .trigger_us = trigger_us,
+            };
+            app_control_submit(&cmd, 0);
+            z->auto_on |= bit;
+        } else if (!(want & bit) && (z->auto_on & bit)) {
+            if (state & bit) {
+                app_cmd_t cmd = {
+                    .zone = z->index, .id = i, .op = APP_CMD_SET, .on = false,
+                    .source = APP_CMD_SRC_AUTO, .trigger_us = trigger_us,
+                };
+                app_control_submit(&cmd, 0);
+            }
+            z->auto_on &= ~bit;
+        }
+    }
+}
+
+static esp_err_t zone_create(app_zone_t *z, const esp_rmaker_node_t *node, const app_zone_config_t *cfg,
+                             uint8_t index, app_zone_point_t *points, esp_rmaker_device_bulk_write_cb_t write_cb) {
+    char name[48];
+    z->cfg = cfg;
+    z->index = index;
+    z->points = points;
+    for (size_t i = 0; i < cfg->sensor_count; i++) point_init(&z->points[i]);
+
+    esp_err_t err = app_actuators_create(node, z->actuators, index, cfg->name, cfg->outputs, write_cb);
+    if (err != ESP_OK) return err;
+    uint32_t outputs = 0;
+    for (int i = 0; i < APP_ACTUATOR_MAX; i++) {
+        int gpio = z->actuators[i].gpio;
+        if (gpio < 0) continue;
+        outputs |= APP_DRIVER_BIT(gpio);
+        if (EMERGENCY_FOLLOWERS & APP_CONTROL_BIT(i)) z->emergency_outputs |= APP_DRIVER_BIT(gpio);
+    }
+    if (outputs) {
+        err = app_driver_add_outputs(outputs);
+        if (err != ESP_OK) return err;
+    }
+
+    if (cfg->name) snprintf(name, sizeof(name), "%s Sensor", cfg->name);
+    else snprintf(name, sizeof(name), "Sensor");
+    z->sensor_device = esp_rmaker_device_create(name, "esp.device.sensor", NULL);
+    esp_rmaker_param_t *temp = esp_rmaker_param_create("Temperature", "esp.param.temperature", esp_rmaker_float(0), PROP_FLAG_READ);
+    esp_rmaker_param_t *hum = esp_rmaker_param_create("Humidity", "esp.param.humidity", esp_rmaker_float(0), PROP_FLAG_READ);
+    /* Time-series params cannot be objects, so the record goes out as JSON text */
+    z->stats_param = esp_rmaker_param_create("Stats", "esp.param.stats", esp_rmaker_str("{}"),
+                                             PROP_FLAG_READ | PROP_FLAG_SIMPLE_TIME_SERIES);
+    if (!z->sensor_device || !temp || !hum || !z->stats_param) return ESP_ERR_NO_MEM;
+    esp_rmaker_device_add_param(z->sensor_device, temp);
+    esp_rmaker_device_add_param(z->sensor_device, hum);
+    esp_rmaker_device_add_param(z->sensor_device, z->stats_param);
+    sensor_window_init(&z->temp_window, STATS_BUCKET_S);
+    sensor_window_init(&z->hum_window, STATS_BUCKET_S);
+    esp_rmaker_node_add_device(node, z->sensor_device);
+    app_report_policy_init(&z->temp_report, temp, TEMP_REPORT_DEADBAND, SENSOR_REPORT_MIN_MS, SENSOR_REPORT_MAX_MS);
+    app_report_policy_init(&z->hum_report, hum, HUM_REPORT_DEADBAND, SENSOR_REPORT_MIN_MS, SENSOR_REPORT_MAX_MS);
+    return ESP_OK;
+}
+
+esp_err_t app_zones_create(const esp_rmaker_node_t *node, const app_zone_config_t *cfg, size_t count,
+                           esp_rmaker_device_bulk_write_cb_t write_cb) {
+    if (zones) return ESP_ERR_INVALID_STATE;
+    if (!count || count > APP_ZONE_MAX) return ESP_ERR_INVALID_ARG;
+    size_t total_points = 0;
+    memset(sensor_map, SENSOR_MAP_NONE, sizeof(sensor_map));
+    for (size_t i = 0; i < count; i++) {
+        if (cfg[i].sensor_count > APP_ZONE_POINTS_MAX || cfg[i].first_sensor + cfg[i].sensor_count > UINT8_MAX + 1) {
+            ESP_LOGE(TAG, "Zone %u: bad sensor range", (unsigned)i);
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (size_t s = cfg[i].first_sensor; s < cfg[i].first_sensor + cfg[i].sensor_count; s++) {
+            if (sensor_map[s] != SENSOR_MAP_NONE) {
+                ESP_LOGE(TAG, "Sensor %u belongs to zones %u and %u", (unsigned)s, sensor_map[s], (unsigned)i);
+                return ESP_ERR_INVALID_ARG;
+            }
+            sensor_map[s] = (uint8_t)i;
+        }
+        total_points += cfg[i].sensor_count;
+    }
+
+    /* Filter state is most of a zone, so points are sized to the table rather than to
+     * APP_ZONE_POINTS_MAX */
+    zones = calloc(count, sizeof(app_zone_t));
+    app_zone_point_t *points = calloc(total_points ? total_points : 1, sizeof(app_zone_point_t));
+    if (!zones || !points) {
+        free(zones);
+        free(points);
+        zones = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < count; i++) {
+        esp_err_t err = zone_create(&zones[i], node, &cfg[i], (uint8_t)i, points, write_cb);
+        points += cfg[i].sensor_count;
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Could not create zone %s: %s", zone_label(&zones[i]), esp_err_to_name(err));
+            return err;
+        }
+        zone_count = i + 1;
+    }
+    ESP_LOGI(TAG, "%u zone(s), %u bytes of zone state", (unsigned)zone_count,
+             (unsigned)(zone_count * sizeof(app_zone_t) + total_points * sizeof(app_zone_point_t)));
+    return ESP_OK;
+}
+
+size_t app_zone_count(void) {
+    return zone_count;
+}
+
+app_zone_t *app_zone_get(size_t index) {
+    return index < zone_count ? &zones[index] : NULL;
+}
+
+bool app_zones_sample(const sensor_sample_t *sample) {
+    uint8_t zi = sensor_map[sample->sensor];
+    if (zi >= zone_count) return false;
+    app_zone_t *z = &zones[zi];
+    point_update(z, &z->points[sample->sensor - z->cfg->first_sensor], sample);
+    return true;
+}
+
+/* Returns the length needed, like snprintf; len must not be 0. Each step runs only while
+ * there is room, so a length past len never becomes the size of the next write. */
+static int stats_json_series(char *buf, size_t len, const char *key, const sensor_window_t *w) {
+    int n = snprintf(buf, len, "\"%s\":[", key);
+    for (size_t i = 0; i < sizeof(stats_windows) && n < (int)len; i++) {
+        sensor_agg_t agg;
+        sensor_window_get(w, stats_windows[i], &agg);
+        n += snprintf(buf + n, len - n, "%s[%.1f,%.1f,%.2f,%.2f]", i ? "," : "",
+                      agg.min, agg.max, agg.mean, sensor_agg_stddev(&agg));
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - n, "]");
+    return n;
+}
+
+/* One record per minute: {"w":[1,5,15],"n":[..],"temp":[[min,max,mean,sd],..],"hum":[..]}
+ * with one entry per window, in minutes. Appending stops as soon as the buffer is full. */
+static void zone_report_stats(app_zone_t *z) {
+    char buf[STATS_JSON_MAX];
+    const int len = sizeof(buf);
+    sensor_agg_t agg;
+    int n = snprintf(buf, len, "{\"w\":[");
+    for (size_t i = 0; i < sizeof(stats_windows) && n < len; i++) {
+        n += snprintf(buf + n, len - n, "%s%u", i ? "," : "", stats_windows[i]);
+    }
+    if (n < len) n += snprintf(buf + n, len - n, "],\"n\":[");
+    for (size_t i = 0; i < sizeof(stats_windows) && n < len; i++) {
+        sensor_window_get(&z->temp_window, stats_windows[i], &agg);
+        n += snprintf(buf + n, len - n, "%s%lu", i ? "," : "", (unsigned long)agg.count);
+    }
+    if (n < len) n += snprintf(buf + n, len - n, "],");
+    if (n < len) n += stats_json_series(buf + n, len - n, "temp", &z->temp_window);
+    if (n < len) n += snprintf(buf + n, len - n, ",");
+    if (n < len) n += stats_json_series(buf + n, len - n, "hum", &z->hum_window);
+    if (n < len) n += snprintf(buf + n, len - n, "}");
+    if (n >= (int)sizeof(buf)) {
+        ESP_LOGW(TAG, "%s: stats record truncated", zone_label(z));
+        return;
+    }
+    esp_err_t err = esp_rmaker_param_report_simple_ts_data_only(z->stats_param, esp_rmaker_str(buf), 0, 0);
+    if (err != ESP_OK) ESP_LOGW(TAG, "%s: stats report failed: %s", zone_label(z), esp_err_to_name(err));
+}
+
+/* Reports published while MQTT was down were dropped, so the cloud may still show the
+ * actuators and readings of before the outage. Marks them all changed again for the
+ * next publish. */
+static void zones_resync(void) {
+    for (size_t i = 0; i < zone_count; i++) {
+        app_zone_t *z = &zones[i];
+        for (int id = 0; id < APP_ACTUATOR_MAX; id++) {
+            esp_rmaker_param_t *power = z->actuators[id].power;
+            if (power) esp_rmaker_param_update(power, *esp_rmaker_param_get_val(power));
+        }
+        esp_rmaker_param_update(z->temp_report.param, *esp_rmaker_param_get_val(z->temp_report.param));
+        esp_rmaker_param_update(z->hum_report.param, *esp_rmaker_param_get_val(z->hum_report.param));
+    }
+}
+
+/* Keeps the minute in flash when it cannot go out now */
+static void zone_history_append(app_zone_t *z, const sensor_agg_t *temp) {
+    sensor_agg_t hum;
+    sensor_window_get(&z->hum_window, 1, &hum);
+    app_history_record_t rec = {
+        .time = (uint32_t)time(NULL), .zone = z->index, .temp = temp->mean, .hum = hum.mean,
+    };
+    esp_err_t err = app_history_append(&rec);
+    if (err != ESP_OK) ESP_LOGW(TAG, "%s: history append failed: %s", zone_label(z), esp_err_to_name(err));
+}
+
+/* Uploads the oldest offline minutes as temperature and humidity time series, one batch
+ * per HISTORY_DRAIN_MS while connected */
+static void zones_history_drain(int64_t now_us) {
+    static app_history_record_t recs[HISTORY_BATCH];
+    static esp_rmaker_ts_record_t ts[2 * HISTORY_BATCH];
+    if (!app_history_pending() || !esp_rmaker_is_mqtt_connected()) return;
+    if (history_drained_us && now_us - history_drained_us < (int64_t)HISTORY_DRAIN_MS * 1000) return;
+    if (!esp_rmaker_mqtt_is_budget_available()) return;
+    history_drained_us = now_us;
+
+    size_t n = app_history_peek(recs, HISTORY_BATCH);
+    size_t count = 0;
+    /* Grouped by param, so that each one is named once in the payload. Records of zones
+     * that are no longer in the table are consumed without upload. */
+    for (size_t zi = 0; zi < zone_count; zi++) {
+        for (size_t i = 0; i < n; i++) {
+            if (recs[i].zone != zi) continue;
+            ts[count++] = (esp_rmaker_ts_record_t){
+                .param = zones[zi].temp_report.param, .val = esp_rmaker_float(recs[i].temp), .timestamp = recs[i].time,
+            };
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (recs[i].zone != zi) continue;
+            ts[count++] = (esp_rmaker_ts_record_t){
+                .param = zones[zi].hum_report.param, .val = esp_rmaker_float(recs[i].hum), .timestamp = recs[i].time,
+            };
+        }
+    }
+    esp_err_t err = count ? esp_rmaker_param_report_time_series_records(ts, count) : ESP_OK;
+    if (err == ESP_OK) err = app_history_consume();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "History upload failed: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "Uploaded %u offline minutes, %u left", (unsigned)n, (unsigned)app_history_pending());
+}
+
+void app_zones_tick(int64_t now_us) {
+    app_ruleset_t *rules = app_rules_current();
+    for (size_t i = 0; i < zone_count; i++) zone_evaluate(&zones[i], rules, now_us);
+    /* Whatever passes the policies goes out in one publish */
+    esp_rmaker_param_batch_begin();
+    bool online = esp_rmaker_is_mqtt_connected();
+    if (online && !mqtt_online && mqtt_ever_online) zones_resync();
+    mqtt_online = online;
+    mqtt_ever_online |= online;
+    for (size_t i = 0; i < zone_count; i++) {
+        app_zone_t *z = &zones[i];
+        if (!z->view.points) continue;
+        app_report_policy_offer(&z->temp_report, z->view.mean_temp, now_us);
+        app_report_policy_offer(&z->hum_report, z->view.mean_hum, now_us);
+    }
+    esp_rmaker_param_batch_commit();
+
+    for (size_t i = 0; i < zone_count; i++) {
+        app_zone_t *z = &zones[i];
+        sensor_window_roll(&z->hum_window, now_us);
+        sensor_window_roll(&z->temp_window, now_us);
+        /* Samples roll the windows too, so compare against the last report */
+        if (z->temp_window.rolled == z->stats_rolled) continue;
+        z->stats_rolled = z->temp_window.rolled;
+        /* Nothing to say about a minute without samples */
+        sensor_agg_t last;
+        sensor_window_get(&z->temp_window, 1, &last);
+        /* Both paths need the wall clock, so nothing is kept before time sync */
+        if (!last.count || !esp_rmaker_time_check()) continue;
+        if (online) {
+            zone_report_stats(z);
+        } else {
+            zone_history_append(z, &last);
+        }
+    }
+    zones_history_drain(now_us);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_rmaker_core.h>
+#include "esp_err.h"
+#include "app_actuators.h"
+#include "app_report.h"
+#include "app_sensor.h"
+
+#define APP_ZONE_MAX            32      /* Zones one node can run */
+#define APP_ZONE_POINTS_MAX     4       /* Sensors per zone */
+
+/* One row of the zone table. A zone owns a contiguous range of the application's sensor
+ * table and a full set of actuators; what switches them is up to the rules (app_rules.h). */
+typedef struct {
+    const char *name;           /* Device name prefix; NULL keeps the plain device names */
+    const int8_t *outputs;      /* GPIO per app_actuator_id_t, -1 for none; NULL if all are remote */
+    uint8_t first_sensor;
+    uint8_t sensor_count;       /* At most APP_ZONE_POINTS_MAX */
+    uint32_t stale_ms;          /* A sensor that has not reported for this long is ignored */
+} app_zone_config_t;
+
+/* Filter and detector state of one sensor */
+typedef struct {
+    sensor_filter_chain_t spike_filter;
+    sensor_filter_chain_t temp_filter;
+    sensor_filter_chain_t hum_spike_filter;
+    sensor_filter_chain_t hum_filter;
+    sensor_ror_t ror;
+    float temp;
+    float hum;
+    float rise;
+    int64_t updated_us;         /* 0 until the first sample */
+} app_zone_point_t;
+
+/* What the controller decides on: comfort follows the mean, fire the worst point */
+typedef struct {
+    float mean_temp;
+    float mean_hum;
+    float max_temp;
+    float max_rise;
+    int64_t newest_us;          /* Time of the newest sample among them */
+    uint8_t points;             /* Fresh points that went into the view */
+} app_zone_view_t;
+
+typedef struct {
+    const app_zone_config_t *cfg;
+    uint8_t index;
+    app_actuator_t actuators[APP_ACTUATOR_MAX];
+    uint32_t emergency_outputs; /* GPIO mask the Emergency switch drives */
+    esp_rmaker_device_t *sensor_device;
+    app_report_policy_t temp_report;
+    app_report_policy_t hum_report;
+    esp_rmaker_param_t *stats_param;    /* Time series of the rolling aggregates */
+    sensor_window_t temp_window;        /* One-minute buckets of despiked samples */
+    sensor_window_t hum_window;
+    uint32_t stats_rolled;              /* temp_window.rolled at the last stats report */
+    app_zone_point_t *points;   /* cfg->sensor_count entries */
+    app_zone_view_t view;       /* As of the last tick */
+    uint32_t auto_on;           /* Actuators the rules switched on and still hold */
+    int64_t evaluated_us;       /* Last evaluation, to tell a new sample from a tick */
+} app_zone_t;
+
+/* Builds the zones of cfg[0..count), creates their RainMaker devices on node and claims
+ * their output pins. The table must outlive the zones. Call once, before
+ * app_control_start(). */
+esp_err_t app_zones_create(const esp_rmaker_node_t *node, const app_zone_config_t *cfg, size_t count,
+                           esp_rmaker_device_bulk_write_cb_t write_cb);
+size_t app_zone_count(void);
+/* NULL if index is out of range */
+app_zone_t *app_zone_get(size_t index);
+
+static inline app_actuator_t *app_zone_actuator(size_t zone, app_actuator_id_t id) {
+    app_zone_t *z = app_zone_get(zone);
+    return z ? &z->actuators[id] : NULL;
+}
+
+/* Runs a sample through the filters of the zone that owns its sensor. Returns false if no
+ * zone does. */
+bool app_zones_sample(const sensor_sample_t *sample);
+
+/* Evaluates the rules of every zone, submits the resulting commands without waiting, and
+ * offers the sensor reports of all zones in one publish. Each zone that closed a minute
+ * also reports its 1/5/15 min aggregates as one time-series record, or, while MQTT is
+ * down, keeps the minute's means in the history log (app_history.h), which is uploaded in
+ * batches once the connection is back. Called by the controller task only. */
+void app_zones_tick(int64_t now_us);
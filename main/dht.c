@@ -0,0 +1,166 @@
+#include "dht.h"
+#include <stdlib.h>
+#include <string.h>
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+#define DHT11_START_LOW_US      20000   /* Host start signal, >= 18 ms */
+#define DHT22_START_LOW_US      2000    /* Host start signal, >= 1 ms */
+#define DHT_FRAME_WINDOW_US     6000    /* 160 us response + 40 bits of <= 120 us, with margin */
+#define DHT_MAX_EDGES           90      /* 84 edges per frame, plus room for glitches */
+#define DHT_RESPONSE_MIN_US     60      /* The 80 us response high pulse precedes the data */
+#define DHT_BIT_ONE_MIN_US      40      /* '0' is ~27 us high, '1' is ~70 us high */
+
+typedef struct {
+    uint32_t t_us;
+    uint8_t level;
+} dht_edge_t;
+
+typedef struct {
+    gpio_num_t gpio;
+    esp_timer_handle_t release_timer;
+    dht_edge_t edges[DHT_MAX_EDGES];
+    volatile int edge_count;
+} dht_ctx_t;
+
+static void IRAM_ATTR dht_edge_isr(void *arg) {
+    dht_ctx_t *ctx = (dht_ctx_t *)arg;
+    int n = ctx->edge_count;
+    if (n < DHT_MAX_EDGES) {
+        ctx->edges[n].t_us = (uint32_t)esp_timer_get_time();
+        ctx->edges[n].level = gpio_get_level(ctx->gpio);
+        ctx->edge_count = n + 1;
+    }
+}
+
+/* Walks the captured edges and measures every high pulse. The first pulse of at least
+ * DHT_RESPONSE_MIN_US is the sensor's response, the next 40 carry the data bits. */
+static esp_err_t dht_decode(const dht_ctx_t *ctx, uint8_t data[5]) {
+    int bit = -1;
+    int edge_count = ctx->edge_count;
+    memset(data, 0, 5);
+    for (int i = 1; i < edge_count && bit < 40; i++) {
+        if (ctx->edges[i].level != 0 || ctx->edges[i - 1].level != 1) continue;
+        uint32_t high_us = ctx->edges[i].t_us - ctx->edges[i - 1].t_us;
+        if (bit < 0) {
+            if (high_us >= DHT_RESPONSE_MIN_US) bit = 0;
+            continue;
+        }
+        if (high_us > DHT_BIT_ONE_MIN_US) data[bit / 8] |= (1 << (7 - (bit % 8)));
+        bit++;
+    }
+    if (bit < 40) return ESP_ERR_TIMEOUT;
+    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) return ESP_ERR_INVALID_CRC;
+    return ESP_OK;
+}
+
+/* Ends the start pulse; the sensor answers 20-40 us later */
+static void dht_release_cb(void *arg) {
+    dht_ctx_t *ctx = (dht_ctx_t *)arg;
+    ctx->edge_count = 0;
+    gpio_set_level(ctx->gpio, 1);
+    gpio_intr_enable(ctx->gpio);
+}
+
+static esp_err_t dht_init(sensor_dev_t *dev) {
+    dht_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) return ESP_ERR_NO_MEM;
+    ctx->gpio = (gpio_num_t)dev->gpio;
+    gpio_reset_pin(ctx->gpio);
+    /* Open-drain with pull-up: writing 1 releases the bus to the sensor, reads stay valid */
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << ctx->gpio),
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err == ESP_OK) {
+        gpio_set_level(ctx->gpio, 1);
+        gpio_intr_disable(ctx->gpio);
+        err = gpio_install_isr_service(0);
+        if (err == ESP_ERR_INVALID_STATE) err = ESP_OK;
+    }
+    bool isr_added = false;
+    if (err == ESP_OK) {
+        err = gpio_isr_handler_add(ctx->gpio, dht_edge_isr, ctx);
+        isr_added = err == ESP_OK;
+    }
+    if (err == ESP_OK) {
+        esp_timer_create_args_t release_args = {
+            .callback = dht_release_cb,
+            .arg = ctx,
+            .name = "dht_release",
+        };
+        err = esp_timer_create(&release_args, &ctx->release_timer);
+    }
+    if (err != ESP_OK) {
+        /* The ISR must not run on a freed context */
+        if (isr_added) gpio_isr_handler_remove(ctx->gpio);
+        free(ctx);
+        return err;
+    }
+    dev->ctx = ctx;
+    return ESP_OK;
+}
+
+static esp_err_t dht_start(sensor_dev_t *dev, uint32_t low_us) {
+    dht_ctx_t *ctx = (dht_ctx_t *)dev->ctx;
+    gpio_intr_disable(ctx->gpio);
+    gpio_set_level(ctx->gpio, 0);
+    esp_err_t err = esp_timer_start_once(ctx->release_timer, low_us);
+    if (err != ESP_OK) gpio_set_level(ctx->gpio, 1);
+    return err;
+}
+
+static esp_err_t dht11_start(sensor_dev_t *dev) {
+    return dht_start(dev, DHT11_START_LOW_US);
+}
+
+static esp_err_t dht22_start(sensor_dev_t *dev) {
+    return dht_start(dev, DHT22_START_LOW_US);
+}
+
+static esp_err_t dht11_read(sensor_dev_t *dev, float *temp, float *hum) {
+    dht_ctx_t *ctx = (dht_ctx_t *)dev->ctx;
+    uint8_t data[5];
+    gpio_intr_disable(ctx->gpio);
+    esp_err_t err = dht_decode(ctx, data);
+    if (err != ESP_OK) return err;
+    *hum = (float)data[0] + (float)data[1] * 0.1f;
+    *temp = (float)data[2] + (float)data[3] * 0.1f;
+    return ESP_OK;
+}
+
+/* 16-bit values in tenths; the temperature is sign-magnitude */
+static esp_err_t dht22_read(sensor_dev_t *dev, float *temp, float *hum) {
+    dht_ctx_t *ctx = (dht_ctx_t *)dev->ctx;
+    uint8_t data[5];
+    gpio_intr_disable(ctx->gpio);
+    esp_err_t err = dht_decode(ctx, data);
+    if (err != ESP_OK) return err;
+    *hum = (float)((data[0] << 8) | data[1]) * 0.1f;
+    *temp = (float)(((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+    if (data[2] & 0x80) *temp = -*temp;
+    return ESP_OK;
+}
+
+const sensor_driver_t dht11_driver = {
+    .model = "DHT11",
+    .conversion_us = DHT11_START_LOW_US + DHT_FRAME_WINDOW_US,
+    .min_interval_ms = 1000,
+    .init = dht_init,
+    .start_conversion = dht11_start,
+    .read = dht11_read,
+};
+
+const sensor_driver_t dht22_driver = {
+    .model = "DHT22",
+    .conversion_us = DHT22_START_LOW_US + DHT_FRAME_WINDOW_US,
+    .min_interval_ms = 2000,
+    .init = dht_init,
+    .start_conversion = dht22_start,
+    .read = dht22_read,
+};
@@ -0,0 +1,12 @@
+#ifndef DHT_H
+#define DHT_H
+
+#include "sensor_drv.h"
+
+/* Single-wire DHT11 and DHT22 (AM2302). dev->gpio is the data pin, with a pull-up.
+ * The start pulse is timed by an esp_timer and the frame is captured by a GPIO ISR that
+ * only timestamps edges; read() decodes the captured pulses. */
+extern const sensor_driver_t dht11_driver;
+extern const sensor_driver_t dht22_driver;
+
+#endif
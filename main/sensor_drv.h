@@ -0,0 +1,51 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+
+/* Interface between the sensor scheduler and one kind of part. A conversion is started,
+ * runs on its own for conversion_us, and is then collected with read(). No operation may
+ * block for longer than a short bus transfer: they all run in the esp_timer task. */
+
+typedef struct sensor_dev sensor_dev_t;
+
+typedef struct {
+    const char *model;
+    uint32_t conversion_us;     /* start_conversion() to the first read() */
+    uint32_t min_interval_ms;   /* Shortest period the part allows between conversions */
+    esp_err_t (*init)(sensor_dev_t *dev);
+    esp_err_t (*start_conversion)(sensor_dev_t *dev);
+    /* Returns ESP_ERR_NOT_FINISHED while the result is still on its way; the scheduler
+     * calls again a little later. Any other error ends the conversion. */
+    esp_err_t (*read)(sensor_dev_t *dev, float *temp, float *hum);
+} sensor_driver_t;
+
+typedef struct {
+    uint32_t reads;
+    uint32_t ok;
+    uint32_t checksum_errors;
+    uint32_t timeout_errors;
+    uint32_t other_errors;
+} sensor_stats_t;
+
+/* One physical sensor. The application fills in the configuration; the rest belongs to the
+ * driver and the scheduler. */
+struct sensor_dev {
+    const char *name;
+    const sensor_driver_t *driver;
+    uint32_t interval_ms;
+    int gpio;                           /* Single-wire parts */
+    i2c_master_bus_handle_t bus;        /* I2C parts */
+    uint16_t i2c_addr;
+    /* Driver state, allocated by init() */
+    void *ctx;
+    /* Scheduler state */
+    bool present;                       /* init() succeeded */
+    bool converting;
+    uint8_t retries;
+    int64_t started_us;
+    int64_t next_start_us;
+    int64_t read_due_us;
+    sensor_stats_t stats;
+};
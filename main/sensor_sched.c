@@ -0,0 +1,109 @@
+/* sensor_sched.c - Interleaves conversions of several sensors on one esp_timer */
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sensor_sched.h"
+
+static const char *TAG = "sensor_sched";
+
+static sensor_dev_t *sched_devs;
+static size_t sched_count;
+static sensor_sched_cb_t sched_cb;
+static void *sched_cb_arg;
+static esp_timer_handle_t sched_timer;
+
+static void sched_finish(sensor_dev_t *dev, const sensor_reading_t *reading) {
+    dev->converting = false;
+    dev->stats.reads++;
+    switch (reading->err) {
+    case ESP_OK:                dev->stats.ok++; break;
+    case ESP_ERR_INVALID_CRC:   dev->stats.checksum_errors++; break;
+    case ESP_ERR_TIMEOUT:       dev->stats.timeout_errors++; break;
+    default:                    dev->stats.other_errors++; break;
+    }
+    if (sched_cb) sched_cb(dev, reading, sched_cb_arg);
+}
+
+static void sched_service(sensor_dev_t *dev, int64_t now) {
+    if (dev->converting && now >= dev->read_due_us) {
+        sensor_reading_t reading = { .timestamp_us = dev->started_us };
+        reading.err = dev->driver->read(dev, &reading.temp, &reading.hum);
+        if (reading.err == ESP_ERR_NOT_FINISHED && ++dev->retries <= SENSOR_SCHED_MAX_RETRIES) {
+            dev->read_due_us = now + SENSOR_SCHED_RETRY_US;
+            return;
+        }
+        if (reading.err == ESP_ERR_NOT_FINISHED) reading.err = ESP_ERR_TIMEOUT;
+        sched_finish(dev, &reading);
+    }
+    if (!dev->converting && now >= dev->next_start_us) {
+        /* Periods are counted from the schedule, not from when the timer ran. Periods
+         * missed entirely are skipped rather than run back to back. */
+        int64_t period_us = (int64_t)dev->interval_ms * 1000;
+        do {
+            dev->next_start_us += period_us;
+        } while (dev->next_start_us <= now);
+        dev->started_us = now;
+        dev->retries = 0;
+        esp_err_t err = dev->driver->start_conversion(dev);
+        if (err != ESP_OK) {
+            sensor_reading_t reading = { .timestamp_us = now, .err = err };
+            sched_finish(dev, &reading);
+            return;
+        }
+        dev->converting = true;
+        dev->read_due_us = now + dev->driver->conversion_us;
+    }
+}
+
+static void sched_timer_cb(void *arg) {
+    int64_t now = esp_timer_get_time();
+    int64_t next = INT64_MAX;
+    for (size_t i = 0; i < sched_count; i++) {
+        sensor_dev_t *dev = &sched_devs[i];
+        if (!dev->present) continue;
+        sched_service(dev, now);
+        int64_t due = dev->converting ? dev->read_due_us : dev->next_start_us;
+        if (due < next) next = due;
+    }
+    if (next == INT64_MAX) return;
+    int64_t delay = next - esp_timer_get_time();
+    esp_timer_start_once(sched_timer, delay > 0 ? (uint64_t)delay : 0);
+}
+
+esp_err_t sensor_sched_start(sensor_dev_t *devs, size_t count, sensor_sched_cb_t cb, void *arg) {
+    if (sched_timer) return ESP_ERR_INVALID_STATE;
+    sched_devs = devs;
+    sched_count = count;
+    sched_cb = cb;
+    sched_cb_arg = arg;
+
+    int64_t first = esp_timer_get_time();
+    size_t present = 0;
+    for (size_t i = 0; i < count; i++) {
+        sensor_dev_t *dev = &devs[i];
+        const sensor_driver_t *drv = dev->driver;
+        esp_err_t err = drv->init(dev);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "%s (%s) not available: %s", dev->name, drv->model, esp_err_to_name(err));
+            continue;
+        }
+        if (dev->interval_ms < drv->min_interval_ms) {
+            ESP_LOGW(TAG, "%s: %s needs %lu ms between reads, raising from %lu ms", dev->name, drv->model,
+                     (unsigned long)drv->min_interval_ms, (unsigned long)dev->interval_ms);
+            dev->interval_ms = drv->min_interval_ms;
+        }
+        dev->present = true;
+        dev->next_start_us = first + (int64_t)present * SENSOR_SCHED_SLOT_US;
+        present++;
+        ESP_LOGI(TAG, "%s: %s every %lu ms", dev->name, drv->model, (unsigned long)dev->interval_ms);
+    }
+    if (!present) return ESP_ERR_NOT_FOUND;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = sched_timer_cb,
+        .name = "sensor_sched",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &sched_timer);
+    if (err != ESP_OK) return err;
+    return esp_timer_start_once(sched_timer, 0);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stddef.h>
+#include "sensor_drv.h"
+
+#define SENSOR_SCHED_SLOT_US        50000   /* Offset between the first conversions of two sensors */
+#define SENSOR_SCHED_RETRY_US       1000    /* Wait before asking a driver again for its result */
+#define SENSOR_SCHED_MAX_RETRIES    20
+
+typedef struct {
+    float temp;
+    float hum;
+    int64_t timestamp_us;   /* esp_timer time at which the conversion was started */
+    esp_err_t err;
+} sensor_reading_t;
+
+/* Called from the esp_timer task for every finished conversion, failed ones included */
+typedef void (*sensor_sched_cb_t)(sensor_dev_t *dev, const sensor_reading_t *reading, void *arg);
+
+/* Initialises every sensor and starts sampling each one every interval_ms. Sensors whose
+ * init() fails are logged and left out. Conversions are started one slot apart and never
+ * wait on each other, so a slow or absent part does not delay the rest. Returns
+ * ESP_ERR_NOT_FOUND if no sensor could be initialised. */
+esp_err_t sensor_sched_start(sensor_dev_t *devs, size_t count, sensor_sched_cb_t cb, void *arg);
@@ -0,0 +1,112 @@
+#include "sht3x.h"
+#include <stdlib.h>
+#include "esp_attr.h"
+
+#define SHT3X_I2C_FREQ_HZ       400000
+#define SHT3X_I2C_TIMEOUT_MS    20
+#define SHT3X_MEASURE_US        16000   /* High repeatability: 15.5 ms max */
+#define SHT3X_FRAME_LEN         6       /* T msb, T lsb, CRC, RH msb, RH lsb, CRC */
+
+typedef enum {
+    SHT3X_RX_IDLE,
+    SHT3X_RX_PENDING,
+    SHT3X_RX_DONE,
+    SHT3X_RX_FAILED,
+} sht3x_rx_state_t;
+
+typedef struct {
+    i2c_master_dev_handle_t i2c;
+    bool async;
+    volatile sht3x_rx_state_t rx_state;
+    uint8_t rx[SHT3X_FRAME_LEN];
+} sht3x_ctx_t;
+
+/* Queued transfers read their buffer later, so commands live in flash */
+static const uint8_t cmd_measure[2] = { 0x24, 0x00 };
+
+/* CRC-8, polynomial 0x31, init 0xFF, over each 16-bit word */
+static uint8_t sht3x_crc(const uint8_t *data) {
+    uint8_t crc = 0xFF;
+    for (int i = 0; i < 2; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+/* Runs in the I2C ISR for every finished transfer; only the receive is waited for */
+static bool IRAM_ATTR sht3x_trans_done(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_data_t *evt, void *arg) {
+    sht3x_ctx_t *ctx = (sht3x_ctx_t *)arg;
+    if (ctx->rx_state == SHT3X_RX_PENDING) {
+        ctx->rx_state = (evt->event == I2C_EVENT_DONE) ? SHT3X_RX_DONE : SHT3X_RX_FAILED;
+    }
+    return false;
+}
+
+static esp_err_t sht3x_init(sensor_dev_t *dev) {
+    if (!dev->bus) return ESP_ERR_INVALID_ARG;
+    if (i2c_master_probe(dev->bus, dev->i2c_addr, SHT3X_I2C_TIMEOUT_MS) != ESP_OK) return ESP_ERR_NOT_FOUND;
+    sht3x_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) return ESP_ERR_NO_MEM;
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = dev->i2c_addr,
+        .scl_speed_hz = SHT3X_I2C_FREQ_HZ,
+    };
+    esp_err_t err = i2c_master_bus_add_device(dev->bus, &dev_cfg, &ctx->i2c);
+    if (err != ESP_OK) {
+        free(ctx);
+        return err;
+    }
+    /* Only asynchronous buses accept callbacks */
+    i2c_master_event_callbacks_t cbs = { .on_trans_done = sht3x_trans_done };
+    ctx->async = i2c_master_register_event_callbacks(ctx->i2c, &cbs, ctx) == ESP_OK;
+    dev->ctx = ctx;
+    return ESP_OK;
+}
+
+static esp_err_t sht3x_start(sensor_dev_t *dev) {
+    sht3x_ctx_t *ctx = (sht3x_ctx_t *)dev->ctx;
+    ctx->rx_state = SHT3X_RX_IDLE;
+    return i2c_master_transmit(ctx->i2c, cmd_measure, sizeof(cmd_measure), SHT3X_I2C_TIMEOUT_MS);
+}
+
+static esp_err_t sht3x_read(sensor_dev_t *dev, float *temp, float *hum) {
+    sht3x_ctx_t *ctx = (sht3x_ctx_t *)dev->ctx;
+    switch (ctx->rx_state) {
+    case SHT3X_RX_IDLE: {
+        ctx->rx_state = SHT3X_RX_PENDING;
+        esp_err_t err = i2c_master_receive(ctx->i2c, ctx->rx, SHT3X_FRAME_LEN, SHT3X_I2C_TIMEOUT_MS);
+        if (err != ESP_OK) {
+            ctx->rx_state = SHT3X_RX_IDLE;
+            return err;
+        }
+        if (!ctx->async) ctx->rx_state = SHT3X_RX_DONE;
+        if (ctx->rx_state != SHT3X_RX_DONE) return ESP_ERR_NOT_FINISHED;
+        break;
+    }
+    case SHT3X_RX_PENDING:
+        return ESP_ERR_NOT_FINISHED;
+    case SHT3X_RX_FAILED:
+        ctx->rx_state = SHT3X_RX_IDLE;
+        return ESP_ERR_TIMEOUT;
+    case SHT3X_RX_DONE:
+        break;
+    }
+    ctx->rx_state = SHT3X_RX_IDLE;
+    if (sht3x_crc(&ctx->rx[0]) != ctx->rx[2] || sht3x_crc(&ctx->rx[3]) != ctx->rx[5]) return ESP_ERR_INVALID_CRC;
+    uint16_t raw_t = (uint16_t)((ctx->rx[0] << 8) | ctx->rx[1]);
+    uint16_t raw_rh = (uint16_t)((ctx->rx[3] << 8) | ctx->rx[4]);
+    *temp = -45.0f + 175.0f * (float)raw_t / 65535.0f;
+    *hum = 100.0f * (float)raw_rh / 65535.0f;
+    return ESP_OK;
+}
+
+const sensor_driver_t sht3x_driver = {
+    .model = "SHT3x",
+    .conversion_us = SHT3X_MEASURE_US,
+    .min_interval_ms = 1000,
+    .init = sht3x_init,
+    .start_conversion = sht3x_start,
+    .read = sht3x_read,
+};
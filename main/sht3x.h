@@ -0,0 +1,13 @@
+#ifndef SHT3X_H
+#define SHT3X_H
+
+#include "sensor_drv.h"
+
+#define SHT3X_I2C_ADDR_DEFAULT  0x44    /* ADDR pin low; 0x45 when high */
+
+/* Sensirion SHT30/31/35 on I2C, single-shot high repeatability without clock stretching.
+ * dev->bus and dev->i2c_addr select the part. On a bus created with trans_queue_depth > 0,
+ * as the display's is, the result is collected asynchronously. */
+extern const sensor_driver_t sht3x_driver;
+
+#endif
@@ -1,5 +1,5 @@
 #include "ssd1306.h"
-#include "driver/i2c.h"
+#include "driver/i2c_master.h"
 #include "string.h"
 #include "freertos/task.h"
 
@@ -119,99 +119,155 @@ static const uint8_t font_5x7[95][5] = {
     {0x08, 0x04, 0x08, 0x10, 0x08}, // ~
 };
 
-static void ssd1306_write_command(SSD1306_t *dev, uint8_t command) {
-    uint8_t buffer[2] = {0x00, command};
-    i2c_master_write_to_device(dev->i2c_port, dev->address, 
-                              buffer, sizeof(buffer), 
-                              1000 / portTICK_PERIOD_MS);
+#define SSD1306_CTRL_CMD_STREAM     0x00    /* Co=0, D/C#=0: every following byte is a command */
+#define SSD1306_CTRL_CMD_SINGLE     0x80    /* Co=1, D/C#=0: one command byte follows */
+#define SSD1306_CTRL_DATA_STREAM    0x40    /* Co=0, D/C#=1: every following byte is GDDRAM data */
+#define SSD1306_I2C_TIMEOUT_MS      1000
+
+/* Runs in ISR context when a queued transaction completes */
+static bool ssd1306_trans_done_cb(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_data_t *evt, void *arg) {
+    SSD1306_t *dev = (SSD1306_t *)arg;
+    if (evt->event != I2C_EVENT_DONE) dev->tx_failed = true;
+    return false;
+}
+
+/* With the bus in asynchronous mode this only queues the transfer; buf must stay untouched
+ * until ssd1306_i2c_wait() returns. */
+static esp_err_t ssd1306_i2c_write(SSD1306_t *dev, const uint8_t *buf, size_t len) {
+    esp_err_t err = i2c_master_transmit(dev->i2c_dev, buf, len, SSD1306_I2C_TIMEOUT_MS);
+    if (err == ESP_OK) dev->tx_bytes += len;
+    return err;
 }
 
-static void ssd1306_write_data(SSD1306_t *dev, const uint8_t *data, size_t len) {
-    uint8_t *buffer = malloc(len + 1);
-    buffer[0] = 0x40;
-    memcpy(&buffer[1], data, len);
-    i2c_master_write_to_device(dev->i2c_port, dev->address, 
-                              buffer, len + 1, 
-                              1000 / portTICK_PERIOD_MS);
-    free(buffer);
+static esp_err_t ssd1306_i2c_wait(SSD1306_t *dev) {
+    esp_err_t err = i2c_master_bus_wait_all_done(dev->bus, SSD1306_I2C_TIMEOUT_MS);
+    if (err == ESP_OK && dev->tx_failed) err = ESP_FAIL;
+    dev->tx_failed = false;
+    return err;
 }
 
-void ssd1306_init(SSD1306_t *dev, uint8_t width, uint8_t height) {
+esp_err_t ssd1306_init(SSD1306_t *dev, i2c_master_bus_handle_t bus, uint8_t address, uint8_t width, uint8_t height) {
+    if (width > SSD1306_MAX_WIDTH) width = SSD1306_MAX_WIDTH;
+    if (height > SSD1306_MAX_PAGES * 8) height = SSD1306_MAX_PAGES * 8;
+    dev->bus = bus;
     dev->width = width;
     dev->height = height;
-    ssd1306_write_command(dev, SSD1306_SET_DISP | 0x00);
-    ssd1306_write_command(dev, SSD1306_SET_DISP_CLK_DIV);
-    ssd1306_write_command(dev, 0x80);
-    ssd1306_write_command(dev, SSD1306_SET_MUX_RATIO);
-    ssd1306_write_command(dev, height - 1);
-    ssd1306_write_command(dev, SSD1306_SET_DISP_OFFSET);
-    ssd1306_write_command(dev, 0x00);
-    ssd1306_write_command(dev, SSD1306_SET_DISP_START_LINE | 0x00);
-    ssd1306_write_command(dev, SSD1306_SET_CHARGE_PUMP);
-    ssd1306_write_command(dev, 0x14);
-    ssd1306_write_command(dev, SSD1306_SET_MEM_MODE);
-    ssd1306_write_command(dev, 0x00);
-    ssd1306_write_command(dev, SSD1306_SET_SEG_REMAP | 0x01);
-    ssd1306_write_command(dev, SSD1306_SET_COM_OUT_DIR | 0x08);
-    ssd1306_write_command(dev, SSD1306_SET_COM_PIN_CFG);
-    ssd1306_write_command(dev, 0x02);
-    ssd1306_write_command(dev, SSD1306_SET_CONTRAST);
-    ssd1306_write_command(dev, 0x8F);
-    ssd1306_write_command(dev, SSD1306_SET_PRECHARGE);
-    ssd1306_write_command(dev, 0xF1);
-    ssd1306_write_command(dev, SSD1306_SET_VCOM_DESEL);
-    ssd1306_write_command(dev, 0x40);
-    ssd1306_write_command(dev, SSD1306_SET_ENTIRE_ON);
-    ssd1306_write_command(dev, SSD1306_SET_NORM_INV);
-    ssd1306_write_command(dev, SSD1306_SET_DISP | 0x01);
+    dev->tx_bytes = 0;
+    dev->tx_failed = false;
+    memset(dev->fb, 0, sizeof(dev->fb));
+    dev->dirty_pages = 0;
+    dev->shadow_valid = false;
+
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = address,
+        .scl_speed_hz = SSD1306_I2C_FREQ_HZ,
+    };
+    esp_err_t err = i2c_master_bus_add_device(bus, &dev_cfg, &dev->i2c_dev);
+    if (err != ESP_OK) return err;
+    i2c_master_event_callbacks_t cbs = {
+        .on_trans_done = ssd1306_trans_done_cb,
+    };
+    err = i2c_master_register_event_callbacks(dev->i2c_dev, &cbs, dev);
+    if (err != ESP_OK) return err;
+
+    uint8_t *init_seq = dev->tx_buf[0];
+    size_t n = 0;
+    init_seq[n++] = SSD1306_CTRL_CMD_STREAM;
+    init_seq[n++] = SSD1306_SET_DISP | 0x00;
+    init_seq[n++] = SSD1306_SET_DISP_CLK_DIV;       init_seq[n++] = 0x80;
+    init_seq[n++] = SSD1306_SET_MUX_RATIO;          init_seq[n++] = height - 1;
+    init_seq[n++] = SSD1306_SET_DISP_OFFSET;        init_seq[n++] = 0x00;
+    init_seq[n++] = SSD1306_SET_DISP_START_LINE | 0x00;
+    init_seq[n++] = SSD1306_SET_CHARGE_PUMP;        init_seq[n++] = 0x14;
+    init_seq[n++] = SSD1306_SET_MEM_MODE;           init_seq[n++] = 0x00;
+    init_seq[n++] = SSD1306_SET_SEG_REMAP | 0x01;
+    init_seq[n++] = SSD1306_SET_COM_OUT_DIR | 0x08;
+    init_seq[n++] = SSD1306_SET_COM_PIN_CFG;        init_seq[n++] = 0x02;
+    init_seq[n++] = SSD1306_SET_CONTRAST;           init_seq[n++] = 0x8F;
+    init_seq[n++] = SSD1306_SET_PRECHARGE;          init_seq[n++] = 0xF1;
+    init_seq[n++] = SSD1306_SET_VCOM_DESEL;         init_seq[n++] = 0x40;
+    init_seq[n++] = SSD1306_SET_ENTIRE_ON;
+    init_seq[n++] = SSD1306_SET_NORM_INV;
+    init_seq[n++] = SSD1306_SET_DISP | 0x01;
+    err = ssd1306_i2c_write(dev, init_seq, n);
+    if (err == ESP_OK) err = ssd1306_i2c_wait(dev);
     vTaskDelay(100 / portTICK_PERIOD_MS);
+    return err;
+}
+
+static void ssd1306_fb_fill_page(SSD1306_t *dev, int page, uint8_t pattern) {
+    memset(dev->fb[page], pattern, dev->width);
+    dev->dirty_pages |= (1U << page);
 }
 
 void ssd1306_clear_screen(SSD1306_t *dev, bool invert) {
-    uint8_t zero_buffer[dev->width];
-    memset(zero_buffer, invert ? 0xFF : 0x00, dev->width);
     int pages = dev->height / 8;
     for (int page = 0; page < pages; page++) {
-        ssd1306_write_command(dev, SSD1306_SET_PAGE_ADDR);
-        ssd1306_write_command(dev, page);
-        ssd1306_write_command(dev, 0x07);
-        ssd1306_write_command(dev, SSD1306_SET_COL_ADDR);
-        ssd1306_write_command(dev, 0);
-        ssd1306_write_command(dev, dev->width - 1);
-        ssd1306_write_data(dev, zero_buffer, dev->width);
+        ssd1306_fb_fill_page(dev, page, invert ? 0xFF : 0x00);
     }
 }
 
-static void ssd1306_write_char(SSD1306_t *dev, uint8_t x, uint8_t y, char ch, bool invert) {
+static void ssd1306_write_char(SSD1306_t *dev, uint8_t x, uint8_t page, char ch, bool invert) {
     if (ch < 32 || ch > 126) return;
-    uint8_t char_data[5];
-    memcpy(char_data, font_5x7[ch - 32], 5);
-    if (invert) {
-        for (int i = 0; i < 5; i++) char_data[i] = ~char_data[i];
+    const uint8_t *glyph = font_5x7[ch - 32];
+    for (int i = 0; i < 5; i++) {
+        dev->fb[page][x + i] = invert ? ~glyph[i] : glyph[i];
     }
-    ssd1306_write_command(dev, SSD1306_SET_PAGE_ADDR);
-    ssd1306_write_command(dev, y);
-    ssd1306_write_command(dev, y);
-    ssd1306_write_command(dev, SSD1306_SET_COL_ADDR);
-    ssd1306_write_command(dev, x);
-    ssd1306_write_command(dev, x + 4);
-    ssd1306_write_data(dev, char_data, 5);
 }
 
 void ssd1306_display_text(SSD1306_t *dev, int page, char *text, int text_len, bool invert) {
     if (page < 0 || page >= (dev->height / 8)) return;
-    uint8_t clear_buffer[dev->width];
-    memset(clear_buffer, invert ? 0xFF : 0x00, dev->width);
-    ssd1306_write_command(dev, SSD1306_SET_PAGE_ADDR);
-    ssd1306_write_command(dev, page);
-    ssd1306_write_command(dev, page);
-    ssd1306_write_command(dev, SSD1306_SET_COL_ADDR);
-    ssd1306_write_command(dev, 0);
-    ssd1306_write_command(dev, dev->width - 1);
-    ssd1306_write_data(dev, clear_buffer, dev->width);
+    ssd1306_fb_fill_page(dev, page, invert ? 0xFF : 0x00);
     uint8_t x = 0;
     for (int i = 0; i < text_len && x < dev->width - 5; i++) {
         ssd1306_write_char(dev, x, page, text[i], invert);
         x += 6;
     }
-}
\ No newline at end of file
+}
+
+/* Sends only the columns that differ from what the panel already shows. Each changed page
+ * goes out as a single transaction: the column/page window is set with Co=1 command bytes
+ * and the GDDRAM bytes follow in the same burst. All pages are queued back to back and the
+ * CPU is free while they shift out; the call returns once the bus is idle again. */
+size_t ssd1306_flush(SSD1306_t *dev) {
+    uint32_t tx_start = dev->tx_bytes;
+    uint8_t sent = 0, retry = 0;
+    int pages = dev->height / 8;
+    for (int page = 0; page < pages; page++) {
+        if (dev->shadow_valid && !(dev->dirty_pages & (1U << page))) continue;
+        int first = 0, last = dev->width - 1;
+        if (dev->shadow_valid) {
+            while (first <= last && dev->fb[page][first] == dev->shadow[page][first]) first++;
+            while (last >= first && dev->fb[page][last] == dev->shadow[page][last]) last--;
+            if (first > last) continue;
+        }
+        size_t len = last - first + 1;
+        uint8_t *buf = dev->tx_buf[page];
+        const uint8_t hdr[SSD1306_PAGE_HDR_LEN] = {
+            SSD1306_CTRL_CMD_SINGLE, SSD1306_SET_COL_ADDR,
+            SSD1306_CTRL_CMD_SINGLE, first,
+            SSD1306_CTRL_CMD_SINGLE, last,
+            SSD1306_CTRL_CMD_SINGLE, SSD1306_SET_PAGE_ADDR,
+            SSD1306_CTRL_CMD_SINGLE, page,
+            SSD1306_CTRL_CMD_SINGLE, page,
+            SSD1306_CTRL_DATA_STREAM,
+        };
+        memcpy(buf, hdr, sizeof(hdr));
+        memcpy(&buf[sizeof(hdr)], &dev->fb[page][first], len);
+        if (ssd1306_i2c_write(dev, buf, sizeof(hdr) + len) == ESP_OK) {
+            memcpy(&dev->shadow[page][first], &dev->fb[page][first], len);
+            sent |= (1U << page);
+        } else {
+            retry |= (1U << page);  /* Resend this page on the next flush */
+        }
+    }
+    if (sent && ssd1306_i2c_wait(dev) != ESP_OK) {
+        /* We cannot tell which queued page failed, so repaint everything next time */
+        dev->shadow_valid = false;
+        return dev->tx_bytes - tx_start;
+    }
+    dev->dirty_pages = retry;
+    if (!retry) dev->shadow_valid = true;
+    return dev->tx_bytes - tx_start;
+}
@@ -1,17 +1,35 @@
 #ifndef SSD1306_H
 #define SSD1306_H
 
-#include "driver/i2c.h"
+#include <stddef.h>
+#include "driver/i2c_master.h"
+
+#define SSD1306_MAX_WIDTH       128
+#define SSD1306_MAX_PAGES       8
+#define SSD1306_PAGE_HDR_LEN    13      /* 6 addressing commands with Co=1 + data control byte */
+#define SSD1306_I2C_FREQ_HZ     400000
 
 typedef struct {
-    i2c_port_t i2c_port;
-    uint8_t address;
+    i2c_master_bus_handle_t bus;
+    i2c_master_dev_handle_t i2c_dev;
     uint8_t width;
     uint8_t height;
+    uint8_t fb[SSD1306_MAX_PAGES][SSD1306_MAX_WIDTH];       /* Frame being drawn */
+    uint8_t shadow[SSD1306_MAX_PAGES][SSD1306_MAX_WIDTH];   /* Frame last sent to the panel */
+    /* One transfer buffer per page, since queued transactions read them after flush has moved on */
+    uint8_t tx_buf[SSD1306_MAX_PAGES][SSD1306_PAGE_HDR_LEN + SSD1306_MAX_WIDTH];
+    uint8_t dirty_pages;    /* Bit per page drawn into since the last flush */
+    bool shadow_valid;      /* false until the whole panel has been written once */
+    volatile bool tx_failed;
+    uint32_t tx_bytes;      /* Total bytes written over I2C, for measuring bus traffic */
 } SSD1306_t;
 
-void ssd1306_init(SSD1306_t *dev, uint8_t width, uint8_t height);
+/* The bus must be created with trans_queue_depth >= SSD1306_MAX_PAGES so that flushes are asynchronous */
+esp_err_t ssd1306_init(SSD1306_t *dev, i2c_master_bus_handle_t bus, uint8_t address, uint8_t width, uint8_t height);
+/* Drawing only touches the framebuffer; nothing reaches the panel until ssd1306_flush() */
 void ssd1306_clear_screen(SSD1306_t *dev, bool invert);
 void ssd1306_display_text(SSD1306_t *dev, int page, char *text, int text_len, bool invert);
+/* Pushes the changed columns of each dirty page and returns the number of bytes sent */
+size_t ssd1306_flush(SSD1306_t *dev);
 
-#endif
\ No newline at end of file
+#endif